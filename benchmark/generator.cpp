@@ -0,0 +1,425 @@
+// Generates large C programs for testing how the analysis scales. Along with the source
+// the problems smacpp should find are written so that the generated programs also work as
+// regression tests. Only constructs the parser understands are generated: string literal
+// buffers, accesses with constant indices, comparisons of the function parameter against
+// constants, switches on the parameter and calls with constant arguments.
+
+#include <boost/program_options.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+
+namespace {
+
+struct GeneratorSettings {
+    int Depth = 4;
+    int Width = 8;
+    int FanOut = 3;
+    int StatementsPerFunction = 8;
+    double BranchDensity = 0.3;
+    int SwitchCases = 4;
+    int Variables = 4;
+    int Accesses = 4;
+    double OverflowRate = 0.1;
+    //! Parameters and branch limits are in [0, MaxValue)
+    int MaxValue = 16;
+    unsigned Seed = 1;
+};
+
+struct Statement {
+    enum class KIND { Access, Assign, If, Switch, Call };
+
+    Statement(KIND kind) : Kind(kind) {}
+
+    KIND Kind;
+    //! Index for Access, limit for If, variable for Assign and callee for Call
+    int Value = 0;
+    //! Call argument and the constant added in Assign
+    int Argument = 0;
+
+    std::vector<Statement> Then;
+    std::vector<Statement> Else;
+
+    std::vector<std::pair<int, std::vector<Statement>>> Cases;
+    std::vector<Statement> Default;
+
+    //! Set when writing the source
+    int Line = 0;
+    int Column = 0;
+};
+
+struct Function {
+    std::string Name;
+    int BufferSize;
+    std::vector<Statement> Body;
+};
+
+class ProgramGenerator {
+public:
+    ProgramGenerator(const GeneratorSettings& settings) :
+        Settings(settings), Random(settings.Seed)
+    {}
+
+    void Generate()
+    {
+        for(int level = 0; level < Settings.Depth; ++level) {
+            for(int index = 0; index < Settings.Width; ++index) {
+                Function function;
+                function.Name = "f" + std::to_string(level) + "_" + std::to_string(index);
+                function.BufferSize = RandomInt(4, 32);
+                function.Body = GenerateBlock(level, Settings.StatementsPerFunction, 0);
+
+                Functions.push_back(std::move(function));
+            }
+        }
+    }
+
+    //! \returns The C source of the program
+    std::string Write()
+    {
+        std::stringstream output;
+        CurrentLine = 1;
+
+        WriteLine(output, 0, "// Generated by smacpp-generate, seed " +
+                                 std::to_string(Settings.Seed));
+
+        for(const auto& function : Functions)
+            WriteLine(output, 0, "void " + function.Name + "(int p);");
+
+        for(auto& function : Functions) {
+            WrittenFunction = &function;
+
+            WriteLine(output, 0, "");
+            WriteLine(output, 0, "void " + function.Name + "(int p)");
+            WriteLine(output, 0, "{");
+            WriteLine(output, 1,
+                "char buffer[] = \"" + std::string(function.BufferSize, 'a') + "\";");
+
+            for(int i = 0; i < Settings.Variables; ++i)
+                WriteLine(output, 1, "int v" + std::to_string(i) + " = 0;");
+
+            WriteBlock(output, function.Body, 1);
+            WriteLine(output, 0, "}");
+        }
+
+        WriteLine(output, 0, "");
+        WriteLine(output, 0, "int main(int argc, char* argv[])");
+        WriteLine(output, 0, "{");
+
+        // Only the first level is called from main, everything else is reached through it
+        for(int index = 0; index < Settings.Width; ++index) {
+            for(int value = 0; value < Settings.MaxValue; value += 3) {
+                WriteLine(output, 1,
+                    Functions[index].Name + "(" + std::to_string(value) + ");");
+                EntryCalls.emplace_back(index, value);
+            }
+        }
+
+        WriteLine(output, 1, "return 0;");
+        WriteLine(output, 0, "}");
+
+        return output.str();
+    }
+
+    //! \brief Finds the problems by running the program with the same rules as the analysis
+    //! \note Must be called after Write as that sets the statement positions
+    std::set<std::string> FindExpectedProblems(const std::string& file)
+    {
+        std::set<std::string> problems;
+        std::set<std::pair<int, int>> done;
+
+        for(const auto& [function, value] : EntryCalls)
+            Run(function, value, file, problems, done);
+
+        return problems;
+    }
+
+private:
+    int RandomInt(int min, int max)
+    {
+        return std::uniform_int_distribution<int>(min, max)(Random);
+    }
+
+    bool RandomChance(double probability)
+    {
+        return std::uniform_real_distribution<double>(0, 1)(Random) < probability;
+    }
+
+    std::vector<Statement> GenerateBlock(int level, int count, int nesting)
+    {
+        std::vector<Statement> block;
+
+        for(int i = 0; i < count; ++i)
+            block.push_back(GenerateStatement(level, nesting));
+
+        // Each function calls FanOut functions of the next level
+        if(nesting == 0 && level + 1 < Settings.Depth) {
+            for(int i = 0; i < Settings.FanOut; ++i) {
+                Statement call(Statement::KIND::Call);
+                call.Value = (level + 1) * Settings.Width + RandomInt(0, Settings.Width - 1);
+                call.Argument = RandomInt(0, Settings.MaxValue - 1);
+
+                // Calls are placed in branches with the same density as the other statements
+                const auto position = RandomInt(0, static_cast<int>(block.size()));
+                block.insert(block.begin() + position, call);
+            }
+        }
+
+        return block;
+    }
+
+    Statement GenerateStatement(int level, int nesting)
+    {
+        if(nesting < 2 && RandomChance(Settings.BranchDensity)) {
+            if(Settings.SwitchCases > 0 && RandomChance(0.3)) {
+                Statement statement(Statement::KIND::Switch);
+
+                std::set<int> values;
+
+                while(static_cast<int>(values.size()) <
+                      std::min(Settings.SwitchCases, Settings.MaxValue))
+                    values.insert(RandomInt(0, Settings.MaxValue - 1));
+
+                for(const auto value : values) {
+                    statement.Cases.emplace_back(
+                        value, GenerateBlock(level, RandomInt(1, 2), nesting + 1));
+                }
+
+                statement.Default = GenerateBlock(level, 1, nesting + 1);
+                return statement;
+            }
+
+            Statement statement(Statement::KIND::If);
+            statement.Value = RandomInt(1, Settings.MaxValue - 1);
+            statement.Then = GenerateBlock(level, RandomInt(1, 3), nesting + 1);
+            statement.Else = GenerateBlock(level, RandomInt(0, 2), nesting + 1);
+            return statement;
+        }
+
+        if(Settings.Variables > 0 &&
+            RandomInt(0, Settings.Accesses + Settings.Variables) >= Settings.Accesses) {
+            Statement statement(Statement::KIND::Assign);
+            statement.Value = RandomInt(0, Settings.Variables - 1);
+            statement.Argument = RandomInt(1, 9);
+            return statement;
+        }
+
+        // The buffer size isn't known here so only a marker for overflowing is stored,
+        // the index is fixed when writing
+        Statement statement(Statement::KIND::Access);
+        statement.Value = RandomChance(Settings.OverflowRate) ? -RandomInt(1, 8) :
+                                                                RandomInt(0, 1 << 20);
+        return statement;
+    }
+
+    void WriteLine(std::ostream& output, int indent, const std::string& text)
+    {
+        output << std::string(indent * 4, ' ') << text << "\n";
+        ++CurrentLine;
+    }
+
+    void WriteBlock(std::ostream& output, std::vector<Statement>& block, int indent)
+    {
+        for(auto& statement : block)
+            WriteStatement(output, statement, indent);
+    }
+
+    void WriteStatement(std::ostream& output, Statement& statement, int indent)
+    {
+        statement.Line = CurrentLine;
+        statement.Column = indent * 4 + 1;
+
+        switch(statement.Kind) {
+        case Statement::KIND::Access: {
+            // Indices equal to the size would be the null terminator, which is fine in C
+            // but reported by the analysis, so those are never generated
+            const auto size = WrittenFunction->BufferSize;
+            statement.Value = statement.Value < 0 ? size - statement.Value :
+                                                    statement.Value % size;
+
+            WriteLine(
+                output, indent, "buffer[" + std::to_string(statement.Value) + "] = 'b';");
+            break;
+        }
+        case Statement::KIND::Assign:
+            WriteLine(output, indent,
+                "v" + std::to_string(statement.Value) + " = p + " +
+                    std::to_string(statement.Argument) + ";");
+            break;
+        case Statement::KIND::Call:
+            WriteLine(output, indent,
+                Functions[statement.Value].Name + "(" + std::to_string(statement.Argument) +
+                    ");");
+            break;
+        case Statement::KIND::If:
+            WriteLine(output, indent, "if(p < " + std::to_string(statement.Value) + ") {");
+            WriteBlock(output, statement.Then, indent + 1);
+
+            if(!statement.Else.empty()) {
+                WriteLine(output, indent, "} else {");
+                WriteBlock(output, statement.Else, indent + 1);
+            }
+
+            WriteLine(output, indent, "}");
+            break;
+        case Statement::KIND::Switch:
+            WriteLine(output, indent, "switch(p) {");
+
+            for(auto& [value, body] : statement.Cases) {
+                WriteLine(output, indent, "case " + std::to_string(value) + ":");
+                WriteBlock(output, body, indent + 1);
+                WriteLine(output, indent + 1, "break;");
+            }
+
+            WriteLine(output, indent, "default:");
+            WriteBlock(output, statement.Default, indent + 1);
+            WriteLine(output, indent, "}");
+            break;
+        }
+    }
+
+    void Run(int function, int value, const std::string& file, std::set<std::string>& problems,
+        std::set<std::pair<int, int>>& done)
+    {
+        // The analysis also runs each function only once per parameter value
+        if(!done.emplace(function, value).second)
+            return;
+
+        RunBlock(Functions[function], Functions[function].Body, value, file, problems, done);
+    }
+
+    void RunBlock(const Function& function, const std::vector<Statement>& block, int value,
+        const std::string& file, std::set<std::string>& problems,
+        std::set<std::pair<int, int>>& done)
+    {
+        for(const auto& statement : block) {
+            switch(statement.Kind) {
+            case Statement::KIND::Access:
+                if(statement.Value >= function.BufferSize) {
+                    problems.insert(file + ":" + std::to_string(statement.Line) + ":" +
+                                    std::to_string(statement.Column) +
+                                    ": error: Buffer overflow: buffer size: " +
+                                    std::to_string(function.BufferSize) +
+                                    " used index: " + std::to_string(statement.Value));
+                }
+                break;
+            case Statement::KIND::Assign: break;
+            case Statement::KIND::Call:
+                Run(statement.Value, statement.Argument, file, problems, done);
+                break;
+            case Statement::KIND::If:
+                RunBlock(function, value < statement.Value ? statement.Then : statement.Else,
+                    value, file, problems, done);
+                break;
+            case Statement::KIND::Switch: {
+                const std::vector<Statement>* matched = &statement.Default;
+
+                for(const auto& [caseValue, body] : statement.Cases) {
+                    if(caseValue == value)
+                        matched = &body;
+                }
+
+                RunBlock(function, *matched, value, file, problems, done);
+                break;
+            }
+            }
+        }
+    }
+
+private:
+    const GeneratorSettings Settings;
+    std::mt19937 Random;
+
+    std::vector<Function> Functions;
+    //! The function whose body is being written, for the buffer size
+    const Function* WrittenFunction = nullptr;
+    std::vector<std::pair<int, int>> EntryCalls;
+    int CurrentLine = 1;
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    GeneratorSettings settings;
+
+    po::options_description options("smacpp-generate options");
+    // clang-format off
+    options.add_options()
+        ("help,h", "print this help")
+        ("output,o", po::value<std::string>()->default_value("generated.c"),
+            "source file to write, the expected problems are written next to it with the "
+            ".expected extension")
+        ("seed", po::value(&settings.Seed)->default_value(settings.Seed), "random seed")
+        ("depth", po::value(&settings.Depth)->default_value(settings.Depth),
+            "number of call graph levels")
+        ("width", po::value(&settings.Width)->default_value(settings.Width),
+            "functions per call graph level")
+        ("fan-out", po::value(&settings.FanOut)->default_value(settings.FanOut),
+            "calls from each function to the next level")
+        ("statements", po::value(&settings.StatementsPerFunction)
+            ->default_value(settings.StatementsPerFunction),
+            "top level statements per function")
+        ("branch-density", po::value(&settings.BranchDensity)
+            ->default_value(settings.BranchDensity), "chance of a statement being a branch")
+        ("switch-cases", po::value(&settings.SwitchCases)->default_value(settings.SwitchCases),
+            "cases in each switch, 0 disables switches")
+        ("variables", po::value(&settings.Variables)->default_value(settings.Variables),
+            "int variables per function")
+        ("accesses", po::value(&settings.Accesses)->default_value(settings.Accesses),
+            "relative weight of array accesses to variable assignments")
+        ("overflow-rate", po::value(&settings.OverflowRate)
+            ->default_value(settings.OverflowRate), "chance of an array access overflowing")
+        ("max-value", po::value(&settings.MaxValue)->default_value(settings.MaxValue),
+            "upper limit for parameter values and branch conditions");
+    // clang-format on
+
+    po::variables_map arguments;
+
+    try {
+        po::store(po::parse_command_line(argc, argv, options), arguments);
+        po::notify(arguments);
+    } catch(const po::error& e) {
+        std::cerr << "smacpp-generate: " << e.what() << "\n" << options;
+        return 2;
+    }
+
+    if(arguments.count("help")) {
+        std::cout << "Usage: smacpp-generate [options]\n" << options;
+        return 0;
+    }
+
+    if(settings.Depth < 1 || settings.Width < 1 || settings.MaxValue < 2 ||
+        settings.FanOut < 0 || settings.StatementsPerFunction < 0 || settings.Variables < 0 ||
+        settings.Accesses < 0 || settings.SwitchCases < 0) {
+        std::cerr << "smacpp-generate: invalid program shape\n";
+        return 2;
+    }
+
+    const auto output = arguments["output"].as<std::string>();
+
+    ProgramGenerator generator(settings);
+    generator.Generate();
+
+    std::ofstream source(output);
+    source << generator.Write();
+
+    std::ofstream expected(output + ".expected");
+
+    for(const auto& problem : generator.FindExpectedProblems(output))
+        expected << problem << "\n";
+
+    if(!source.good() || !expected.good()) {
+        std::cerr << "smacpp-generate: failed to write " << output << "\n";
+        return 2;
+    }
+
+    return 0;
+}
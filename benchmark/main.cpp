@@ -0,0 +1,488 @@
+// Micro benchmarks for the separate parts of smacpp. Unlike Benchmark.rb these run in
+// process so the numbers don't include process startup or clang parsing. Results are
+// printed as JSON for tracking regressions.
+
+#include "analysis/Analyzer.h"
+#include "analysis/BlockRegistry.h"
+#include "parse/CodeBlock.h"
+#include "parse/CodeBlockBuildingVisitor.h"
+#include "parse/CompiledCondition.h"
+#include "Trace.h"
+
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef SMACPP_BENCHMARK_DATA
+#define SMACPP_BENCHMARK_DATA "test/data/JM2018TS/strings/overflow"
+#endif
+
+namespace po = boost::program_options;
+
+using namespace smacpp;
+
+namespace {
+
+struct BenchmarkResult {
+    std::string Name;
+    size_t Iterations;
+    double MinNs;
+    double MedianNs;
+    double MeanNs;
+};
+
+//! \brief Runs func until minTime has passed (and at least a few times)
+BenchmarkResult RunBenchmark(
+    const std::string& name, const std::function<void()>& func, double minTime)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Warm up caches and lazily initialized state
+    func();
+
+    std::vector<double> times;
+    const auto end = Clock::now() + std::chrono::duration<double>(minTime);
+
+    while(times.size() < 5 || Clock::now() < end) {
+        const auto start = Clock::now();
+        func();
+
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        times.push_back(elapsed.count());
+    }
+
+    std::sort(times.begin(), times.end());
+
+    double total = 0;
+
+    for(const auto time : times)
+        total += time;
+
+    return BenchmarkResult{
+        name, times.size(), times.front(), times[times.size() / 2], total / times.size()};
+}
+
+void PrintResults(llvm::raw_ostream& output, const std::vector<BenchmarkResult>& results)
+{
+    output << "{\"benchmarks\": [\n";
+
+    for(size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+
+        output << "  {\"name\": ";
+        Trace::WriteJSONString(output, result.Name);
+        output << ", \"iterations\": " << result.Iterations << ", \"min_ns\": " << result.MinNs
+               << ", \"median_ns\": " << result.MedianNs << ", \"mean_ns\": " << result.MeanNs
+               << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    output << "]}\n";
+}
+
+//! \returns The C sources in folder and its subfolders, sorted so that runs are comparable
+std::vector<std::string> FindSources(const std::string& folder)
+{
+    std::vector<std::string> sources;
+    std::error_code error;
+
+    for(std::filesystem::recursive_directory_iterator iter(folder, error), end;
+        !error && iter != end; iter.increment(error)) {
+        if(iter->is_regular_file() && iter->path().extension() == ".c")
+            sources.push_back(iter->path().string());
+    }
+
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+//! Used when no source files are given and the test data is not checked out
+constexpr auto BUILTIN_SOURCE = R"(
+void fill(int index, int value)
+{
+    char buffer[] = "12345678";
+
+    if(index < 8) {
+        buffer[4] = 1;
+    } else {
+        buffer[9] = 2;
+    }
+
+    switch(value) {
+    case 1: buffer[1] = 1; break;
+    case 2: buffer[2] = 2; break;
+    default: buffer[10] = 3;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc * 2 + 1;
+
+    for(int i = 0; i < 10; ++i)
+        fill(i, count - i);
+
+    if(count > 5 && argc != 0)
+        fill(10, 1);
+
+    return 0;
+}
+)";
+
+//! \brief Builds a call tree where each function in a level calls each function of the
+//! next level with different parameters
+void AddSyntheticProgram(BlockRegistry& registry, int depth, int width)
+{
+    const auto name = [](int level, int index) {
+        return "level" + std::to_string(level) + "_" + std::to_string(index);
+    };
+
+    CodeBlock main("main", clang::SourceLocation{});
+
+    for(int i = 0; i < width; ++i) {
+        main.AddProcessedAction(
+            Condition(), action::FunctionCall{name(0, i), {PrimitiveInfo(i)}});
+    }
+
+    registry.AddBlock(std::move(main));
+
+    for(int level = 0; level < depth; ++level) {
+        for(int index = 0; index < width; ++index) {
+
+            const VariableIdentifier param("param_" + name(level, index));
+            const VariableIdentifier buffer("buffer_" + name(level, index));
+
+            CodeBlock block(name(level, index), clang::SourceLocation{});
+            block.AddFunctionParameter(param);
+
+            block.AddProcessedAction(
+                Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(width))});
+
+            const Condition inBounds(Condition::Part(VariableValueCondition(param,
+                ValueRange(COMPARISON::LESS_THAN, VariableState(PrimitiveInfo(width))))));
+
+            block.AddProcessedAction(
+                inBounds, action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(param))});
+            // Overflows, so that problem reporting is included
+            block.AddProcessedAction(inBounds.Negate(),
+                action::ArrayIndexAccess{buffer, VariableState(PrimitiveInfo(width))});
+
+            if(level + 1 < depth) {
+                for(int child = 0; child < width; ++child) {
+                    block.AddProcessedAction(
+                        Condition(), action::FunctionCall{name(level + 1, child),
+                                         {PrimitiveInfo(child + index)}});
+                }
+            }
+
+            registry.AddBlock(std::move(block));
+        }
+    }
+}
+
+void BenchmarkLowering(const std::string& name,
+    const std::vector<std::unique_ptr<clang::ASTUnit>>& units,
+    std::vector<BenchmarkResult>& results, double minTime)
+{
+    results.push_back(RunBenchmark("lowering/" + name,
+        [&]() {
+            for(const auto& unit : units) {
+                auto& context = unit->getASTContext();
+
+                BlockRegistry registry;
+                const VariableNameTable::Scope names(registry.GetNames());
+                CodeBlockBuildingVisitor visitor(context, registry);
+                visitor.TraverseDecl(context.getTranslationUnitDecl());
+            }
+        },
+        minTime));
+}
+
+void BenchmarkConditions(std::vector<BenchmarkResult>& results, double minTime)
+{
+    constexpr int variableCount = 16;
+
+    ProgramState values;
+    std::unique_ptr<Condition::Part> combined;
+
+    for(int i = 0; i < variableCount; ++i) {
+        const VariableIdentifier variable("condition_var" + std::to_string(i));
+        values.Assign(variable, VariableState(PrimitiveInfo(i)));
+
+        Condition::Part part(VariableValueCondition(
+            variable, ValueRange(COMPARISON::LESS_THAN, VariableState(PrimitiveInfo(100)))));
+
+        if(!combined) {
+            combined = std::make_unique<Condition::Part>(part);
+        } else {
+            combined = std::make_unique<Condition::Part>(
+                std::make_shared<Condition::Part>(*combined), COMBINE_OPERATOR::And,
+                std::make_shared<Condition::Part>(part));
+        }
+    }
+
+    const Condition condition(*combined);
+    const CompiledCondition compiled(condition);
+
+    int matches = 0;
+
+    results.push_back(RunBenchmark("conditions/tree_and_16",
+        [&]() {
+            for(int i = 0; i < 1000; ++i)
+                matches += condition.Evaluate(values) ? 1 : 0;
+        },
+        minTime));
+
+    results.push_back(RunBenchmark("conditions/compiled_and_16",
+        [&]() {
+            for(int i = 0; i < 1000; ++i)
+                matches += compiled.Evaluate(values) == TRI_BOOL::True ? 1 : 0;
+        },
+        minTime));
+
+    if(matches == 0)
+        std::cerr << "conditions never matched\n";
+}
+
+void BenchmarkDoneRegistry(std::vector<BenchmarkResult>& results, double minTime)
+{
+    constexpr int blockCount = 100;
+    constexpr int paramCount = 100;
+
+    std::vector<CodeBlock> blocks;
+
+    for(int i = 0; i < blockCount; ++i)
+        blocks.emplace_back("func" + std::to_string(i), clang::SourceLocation{});
+
+    DoneAnalysisRegistry registry;
+    std::list<AnalysisOperation> woken;
+
+    for(const auto& block : blocks) {
+        for(int param = 0; param < paramCount; ++param) {
+            const std::vector<VariableState> params{VariableState(PrimitiveInfo(param))};
+
+            registry.Add(&block, params);
+            registry.AddSummary(&block, params, FunctionSummary{}, woken);
+        }
+    }
+
+    size_t found = 0;
+
+    results.push_back(RunBenchmark("done_registry/find_summary",
+        [&]() {
+            for(const auto& block : blocks) {
+                for(int param = 0; param < paramCount; param += 7) {
+                    if(registry.FindSummary(
+                           &block, std::vector<VariableState>{PrimitiveInfo(param)}))
+                        ++found;
+                }
+            }
+        },
+        minTime));
+
+    if(found == 0)
+        std::cerr << "no summaries were found\n";
+}
+
+void BenchmarkAnalysis(std::vector<BenchmarkResult>& results, double minTime, int depth,
+    int width, unsigned threads)
+{
+    BlockRegistry registry;
+    const VariableNameTable::Scope names(registry.GetNames());
+    AddSyntheticProgram(registry, depth, width);
+
+    AnalysisSettings settings;
+    settings.Threads = threads;
+
+    std::stringstream name;
+    name << "analysis/depth" << depth << "_width" << width << "_threads" << threads;
+
+    size_t problems = 0;
+
+    results.push_back(RunBenchmark(name.str(),
+        [&]() { problems += registry.PerformAnalysis(settings).size(); }, minTime));
+
+    if(problems == 0)
+        std::cerr << "synthetic program had no problems\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    po::options_description options("smacpp-benchmark options");
+    // clang-format off
+    options.add_options()
+        ("help,h", "print this help")
+        ("min-time", po::value<double>()->default_value(0.5),
+            "minimum seconds to run each benchmark for")
+        ("filter", po::value<std::string>()->default_value(""),
+            "only run benchmarks whose name contains this")
+        ("output,o", po::value<std::string>(), "write the JSON results to this file")
+        ("depth", po::value<int>()->default_value(6), "call depth of the synthetic program")
+        ("width", po::value<int>()->default_value(4), "functions per call level")
+        ("clang-arg", po::value<std::vector<std::string>>(),
+            "extra argument for parsing the sources, for example -I")
+        ("data", po::value<std::string>()->default_value(SMACPP_BENCHMARK_DATA),
+            "folder of C sources lowered together when no inputs are given")
+        ("input", po::value<std::vector<std::string>>(), "C or C++ sources to lower");
+    // clang-format on
+
+    po::positional_options_description positional;
+    positional.add("input", -1);
+
+    po::variables_map arguments;
+
+    try {
+        po::store(po::command_line_parser(argc, argv)
+                      .options(options)
+                      .positional(positional)
+                      .run(),
+            arguments);
+        po::notify(arguments);
+    } catch(const po::error& e) {
+        std::cerr << "smacpp-benchmark: " << e.what() << "\n" << options;
+        return 2;
+    }
+
+    if(arguments.count("help")) {
+        std::cout << "Usage: smacpp-benchmark [options] [file.c...]\n" << options;
+        return 0;
+    }
+
+    const auto minTime = arguments["min-time"].as<double>();
+    const auto filter = arguments["filter"].as<std::string>();
+
+    const auto enabled = [&](const std::string& group) {
+        return filter.empty() || group.find(filter) != std::string::npos ||
+               filter.find(group) != std::string::npos;
+    };
+
+    std::vector<BenchmarkResult> results;
+
+    if(enabled("lowering")) {
+        std::vector<std::string> clangArgs{"-fsyntax-only"};
+
+        if(arguments.count("clang-arg")) {
+            for(const auto& arg : arguments["clang-arg"].as<std::vector<std::string>>())
+                clangArgs.push_back(arg);
+        }
+
+        std::vector<std::string> inputs;
+        std::string dataName;
+
+        if(arguments.count("input")) {
+            inputs = arguments["input"].as<std::vector<std::string>>();
+        } else {
+            const auto data = arguments["data"].as<std::string>();
+            inputs = FindSources(data);
+            dataName = std::filesystem::path(data).filename().string();
+
+            // The test sources include headers from the folder
+            clangArgs.push_back("-I" + data);
+
+            if(inputs.empty()) {
+                std::cerr << "smacpp-benchmark: no sources in " << data
+                          << ", lowering a builtin program instead\n";
+            }
+        }
+
+        std::vector<std::pair<std::string, std::unique_ptr<clang::ASTUnit>>> units;
+
+        const auto parse = [&](const std::string& path, const std::string& code) {
+            auto unit = clang::tooling::buildASTFromCodeWithArgs(code, clangArgs, path);
+
+            if(!unit) {
+                std::cerr << "smacpp-benchmark: failed to parse " << path << "\n";
+                return false;
+            }
+
+            units.emplace_back(path, std::move(unit));
+            return true;
+        };
+
+        for(const auto& input : inputs) {
+            std::ifstream file(input);
+            std::stringstream content;
+            content << file.rdbuf();
+
+            if(!file.good() && !file.eof()) {
+                std::cerr << "smacpp-benchmark: failed to read " << input << "\n";
+                return 2;
+            }
+
+            if(!parse(input, content.str()))
+                return 2;
+        }
+
+        if(inputs.empty() && !parse("builtin.c", BUILTIN_SOURCE))
+            return 2;
+
+        if(!dataName.empty() && !inputs.empty()) {
+            // The test files are small so they are timed as one
+            std::vector<std::unique_ptr<clang::ASTUnit>> all;
+
+            for(auto& unit : units)
+                all.push_back(std::move(unit.second));
+
+            BenchmarkLowering(dataName, all, results, minTime);
+        } else {
+            for(auto& [path, unit] : units) {
+                std::vector<std::unique_ptr<clang::ASTUnit>> single;
+                single.push_back(std::move(unit));
+                BenchmarkLowering(path, single, results, minTime);
+            }
+        }
+    }
+
+    if(enabled("conditions"))
+        BenchmarkConditions(results, minTime);
+
+    if(enabled("done_registry"))
+        BenchmarkDoneRegistry(results, minTime);
+
+    if(enabled("analysis")) {
+        const auto depth = arguments["depth"].as<int>();
+        const auto width = arguments["width"].as<int>();
+
+        BenchmarkAnalysis(results, minTime, depth, width, 1);
+        BenchmarkAnalysis(
+            results, minTime, depth, width, std::max(2u, std::thread::hardware_concurrency()));
+    }
+
+    if(arguments.count("output")) {
+        const auto output = arguments["output"].as<std::string>();
+
+        std::error_code error;
+        llvm::raw_fd_ostream file(output, error);
+
+        if(!error) {
+            PrintResults(file, results);
+            file.close();
+            error = file.error();
+        }
+
+        if(error) {
+            std::cerr << "smacpp-benchmark: failed to write " << output << ": "
+                      << error.message() << "\n";
+            return 2;
+        }
+    } else {
+        PrintResults(llvm::outs(), results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+// ------------------------------------ //
+#include "Logging.h"
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+
+using namespace smacpp;
+// ------------------------------------ //
+namespace {
+
+std::atomic<int> CurrentLevel{static_cast<int>(LOG_LEVEL::Warning)};
+std::atomic<uint32_t> EnabledCategories{static_cast<uint32_t>(LOG_CATEGORY::All)};
+
+std::mutex OutputMutex;
+
+std::optional<LOG_CATEGORY> ParseCategory(const std::string& name)
+{
+    if(name == "parse")
+        return LOG_CATEGORY::Parse;
+    if(name == "analysis")
+        return LOG_CATEGORY::Analysis;
+    if(name == "serialization")
+        return LOG_CATEGORY::Serialization;
+    if(name == "checker")
+        return LOG_CATEGORY::Checker;
+    if(name == "all")
+        return LOG_CATEGORY::All;
+
+    return {};
+}
+
+} // namespace
+// ------------------------------------ //
+// Logger
+bool Logger::IsEnabled(LOG_LEVEL level, LOG_CATEGORY category)
+{
+    if(static_cast<int>(level) > CurrentLevel.load(std::memory_order_relaxed))
+        return false;
+
+    // Errors, warnings and info are always printed, the categories only select the debug
+    // output
+    if(level != LOG_LEVEL::Debug)
+        return true;
+
+    return (static_cast<uint32_t>(category) &
+               EnabledCategories.load(std::memory_order_relaxed)) != 0;
+}
+
+void Logger::SetLevel(LOG_LEVEL level)
+{
+    CurrentLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void Logger::SetCategories(uint32_t categories)
+{
+    EnabledCategories.store(categories, std::memory_order_relaxed);
+}
+
+bool Logger::EnableDebugCategories(const std::string& categories)
+{
+    uint32_t mask = 0;
+
+    std::stringstream stream(categories);
+    std::string name;
+
+    while(std::getline(stream, name, ',')) {
+        const auto category = ParseCategory(name);
+
+        if(!category)
+            return false;
+
+        mask |= static_cast<uint32_t>(*category);
+    }
+
+    SetCategories(mask);
+    SetLevel(LOG_LEVEL::Debug);
+    return true;
+}
+
+std::optional<LOG_LEVEL> Logger::ParseLevel(const std::string& name)
+{
+    for(auto level :
+        {LOG_LEVEL::Error, LOG_LEVEL::Warning, LOG_LEVEL::Info, LOG_LEVEL::Debug}) {
+        if(name == LevelToString(level))
+            return level;
+    }
+
+    return {};
+}
+
+const char* Logger::LevelToString(LOG_LEVEL level)
+{
+    switch(level) {
+    case LOG_LEVEL::Error: return "error";
+    case LOG_LEVEL::Warning: return "warning";
+    case LOG_LEVEL::Info: return "info";
+    case LOG_LEVEL::Debug: return "debug";
+    }
+    return "invalid";
+}
+
+const char* Logger::CategoryToString(LOG_CATEGORY category)
+{
+    switch(category) {
+    case LOG_CATEGORY::Parse: return "parse";
+    case LOG_CATEGORY::Analysis: return "analysis";
+    case LOG_CATEGORY::Serialization: return "serialization";
+    case LOG_CATEGORY::Checker: return "checker";
+    case LOG_CATEGORY::All: return "all";
+    }
+    return "invalid";
+}
+// ------------------------------------ //
+// LogMessage
+LogMessage::LogMessage(LOG_LEVEL level, LOG_CATEGORY category) : Out(Buffer)
+{
+    Out << "smacpp[" << Logger::CategoryToString(category) << "] "
+        << Logger::LevelToString(level) << ": ";
+}
+
+LogMessage::~LogMessage()
+{
+    Out.flush();
+
+    // Multi line messages already end with a newline
+    if(Buffer.empty() || Buffer.back() != '\n')
+        Buffer.push_back('\n');
+
+    std::lock_guard<std::mutex> lock(OutputMutex);
+    llvm::errs() << Buffer;
+}
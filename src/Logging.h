@@ -0,0 +1,106 @@
+#pragma once
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+//! Set to 0 (with the SMACPP_ENABLE_LOGGING cmake option) to compile out all logging
+#ifndef SMACPP_ENABLE_LOGGING
+#define SMACPP_ENABLE_LOGGING 1
+#endif
+
+namespace smacpp {
+
+enum class LOG_LEVEL { Error = 0, Warning, Info, Debug };
+
+//! Values are bit flags so that multiple categories can be enabled at once
+enum class LOG_CATEGORY : uint32_t {
+    Parse = 1 << 0,
+    Analysis = 1 << 1,
+    Serialization = 1 << 2,
+    Checker = 1 << 3,
+
+    All = Parse | Analysis | Serialization | Checker
+};
+
+//! \brief Runtime configuration of the log output
+//!
+//! By default warnings and errors are printed from all categories. The enabled categories
+//! only filter the debug level, other messages are never hidden by them. The checks are just
+//! loads from atomics so disabled messages don't cost anything more than a branch
+class Logger {
+public:
+    static bool IsEnabled(LOG_LEVEL level, LOG_CATEGORY category);
+
+    static void SetLevel(LOG_LEVEL level);
+    static void SetCategories(uint32_t categories);
+
+    //! \brief Enables debug level logging for the named categories
+    //!
+    //! Messages of the other levels keep being printed from every category
+    //! \param categories Comma separated category names (parse, analysis, serialization,
+    //! checker or all)
+    //! \returns False if there was an unknown name, nothing is changed in that case
+    static bool EnableDebugCategories(const std::string& categories);
+
+    static std::optional<LOG_LEVEL> ParseLevel(const std::string& name);
+    static const char* LevelToString(LOG_LEVEL level);
+    static const char* CategoryToString(LOG_CATEGORY category);
+};
+
+//! \brief A single log line, written out as a whole when destroyed
+//!
+//! Buffering the line keeps messages from multiple analysis threads from interleaving
+class LogMessage {
+public:
+    LogMessage(LOG_LEVEL level, LOG_CATEGORY category);
+    ~LogMessage();
+
+    LogMessage(const LogMessage& other) = delete;
+    LogMessage& operator=(const LogMessage& other) = delete;
+
+    llvm::raw_ostream& Stream()
+    {
+        return Out;
+    }
+
+private:
+    std::string Buffer;
+    llvm::raw_string_ostream Out;
+};
+
+} // namespace smacpp
+
+#if SMACPP_ENABLE_LOGGING
+
+//! \brief True when messages of level in category would be printed
+//!
+//! Use this to guard expensive output like AST dumps:
+//! `if(SMACPP_LOG_ENABLED(Debug, Parse)) stmt->dump();`
+#define SMACPP_LOG_ENABLED(level, category) \
+    ::smacpp::Logger::IsEnabled(::smacpp::LOG_LEVEL::level, ::smacpp::LOG_CATEGORY::category)
+
+//! \brief Prints a line, message is only evaluated if the level and category are enabled
+//!
+//! message is anything that can be streamed to a raw_ostream and can contain more <<, for
+//! example: `SMACPP_LOG(Debug, Analysis, "value: " << value.Dump());`
+#define SMACPP_LOG(level, category, message)                                   \
+    do {                                                                       \
+        if(SMACPP_LOG_ENABLED(level, category)) {                              \
+            ::smacpp::LogMessage smacppLogMessage(                             \
+                ::smacpp::LOG_LEVEL::level, ::smacpp::LOG_CATEGORY::category); \
+            smacppLogMessage.Stream() << message;                              \
+        }                                                                      \
+    } while(false)
+
+#else
+
+#define SMACPP_LOG_ENABLED(level, category) false
+
+#define SMACPP_LOG(level, category, message) \
+    do {                                     \
+    } while(false)
+
+#endif
@@ -0,0 +1,168 @@
+// ------------------------------------ //
+#include "Statistics.h"
+
+#include "llvm/Support/Format.h"
+
+#include <array>
+#include <atomic>
+
+using namespace smacpp;
+// ------------------------------------ //
+namespace {
+
+constexpr auto COUNTER_COUNT = static_cast<size_t>(STAT_COUNTER::Count);
+constexpr auto PHASE_COUNT = static_cast<size_t>(STAT_PHASE::Count);
+
+std::atomic<bool> StatisticsEnabled{false};
+
+std::array<std::atomic<uint64_t>, COUNTER_COUNT> Counters{};
+//! In nanoseconds
+std::array<std::atomic<uint64_t>, PHASE_COUNT> PhaseTimes{};
+
+double ToMilliseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+// ------------------------------------ //
+void Statistics::Enable(bool enabled)
+{
+    StatisticsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Statistics::IsEnabled()
+{
+    return StatisticsEnabled.load(std::memory_order_relaxed);
+}
+
+void Statistics::Reset()
+{
+    for(auto& counter : Counters)
+        counter.store(0, std::memory_order_relaxed);
+
+    for(auto& time : PhaseTimes)
+        time.store(0, std::memory_order_relaxed);
+}
+// ------------------------------------ //
+void Statistics::Add(STAT_COUNTER counter, uint64_t amount)
+{
+    if(!IsEnabled())
+        return;
+
+    Counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void Statistics::SetMax(STAT_COUNTER counter, uint64_t value)
+{
+    if(!IsEnabled())
+        return;
+
+    auto& stored = Counters[static_cast<size_t>(counter)];
+    auto current = stored.load(std::memory_order_relaxed);
+
+    while(current < value &&
+          !stored.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Statistics::AddTime(STAT_PHASE phase, std::chrono::nanoseconds duration)
+{
+    if(!IsEnabled())
+        return;
+
+    PhaseTimes[static_cast<size_t>(phase)].fetch_add(
+        duration.count(), std::memory_order_relaxed);
+}
+// ------------------------------------ //
+uint64_t Statistics::Get(STAT_COUNTER counter)
+{
+    return Counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds Statistics::GetTime(STAT_PHASE phase)
+{
+    return std::chrono::nanoseconds(
+        PhaseTimes[static_cast<size_t>(phase)].load(std::memory_order_relaxed));
+}
+// ------------------------------------ //
+void Statistics::Print(llvm::raw_ostream& output)
+{
+    output << "smacpp statistics:\n";
+
+    for(size_t i = 0; i < PHASE_COUNT; ++i) {
+        const auto phase = static_cast<STAT_PHASE>(i);
+
+        output << "  " << PhaseToString(phase) << " time: "
+               << llvm::format("%.3f", ToMilliseconds(GetTime(phase))) << " ms\n";
+    }
+
+    for(size_t i = 0; i < COUNTER_COUNT; ++i) {
+        const auto counter = static_cast<STAT_COUNTER>(i);
+
+        output << "  " << CounterToString(counter) << ": " << Get(counter) << "\n";
+    }
+}
+
+void Statistics::PrintJSON(llvm::raw_ostream& output)
+{
+    // All keys are fixed identifiers so no escaping is needed
+    output << "{\"phases_ms\": {";
+
+    for(size_t i = 0; i < PHASE_COUNT; ++i) {
+        const auto phase = static_cast<STAT_PHASE>(i);
+
+        output << (i > 0 ? ", " : "") << "\"" << PhaseToString(phase)
+               << "\": " << llvm::format("%.3f", ToMilliseconds(GetTime(phase)));
+    }
+
+    output << "}, \"counters\": {";
+
+    for(size_t i = 0; i < COUNTER_COUNT; ++i) {
+        const auto counter = static_cast<STAT_COUNTER>(i);
+
+        output << (i > 0 ? ", " : "") << "\"" << CounterToString(counter)
+               << "\": " << Get(counter);
+    }
+
+    output << "}}\n";
+}
+// ------------------------------------ //
+const char* Statistics::CounterToString(STAT_COUNTER counter)
+{
+    switch(counter) {
+    case STAT_COUNTER::FunctionsLowered: return "functions_lowered";
+    case STAT_COUNTER::ActionsLowered: return "actions_lowered";
+    case STAT_COUNTER::ConditionsEvaluated: return "conditions_evaluated";
+    case STAT_COUNTER::OperationsEnqueued: return "operations_enqueued";
+    case STAT_COUNTER::OperationsRecycled: return "operations_recycled";
+    case STAT_COUNTER::RegistryHits: return "registry_hits";
+    case STAT_COUNTER::RegistryMisses: return "registry_misses";
+    case STAT_COUNTER::SummaryHits: return "summary_hits";
+    case STAT_COUNTER::SummaryWaits: return "summary_waits";
+    case STAT_COUNTER::SummariesPrecomputed: return "summaries_precomputed";
+    case STAT_COUNTER::RecursiveCalls: return "recursive_calls";
+    case STAT_COUNTER::WidenedCalls: return "widened_calls";
+    case STAT_COUNTER::FixpointRounds: return "fixpoint_rounds";
+    case STAT_COUNTER::PeakProgramStateSize: return "peak_program_state_size";
+    case STAT_COUNTER::PathsSplit: return "paths_split";
+    case STAT_COUNTER::PathsJoined: return "paths_joined";
+    case STAT_COUNTER::PathLimitHits: return "path_limit_hits";
+    case STAT_COUNTER::BudgetsExhausted: return "budgets_exhausted";
+    case STAT_COUNTER::Count: break;
+    }
+    return "invalid";
+}
+
+const char* Statistics::PhaseToString(STAT_PHASE phase)
+{
+    switch(phase) {
+    case STAT_PHASE::Lowering: return "lowering";
+    case STAT_PHASE::SummaryWriting: return "summary_writing";
+    case STAT_PHASE::SummaryLoading: return "summary_loading";
+    case STAT_PHASE::Analysis: return "analysis";
+    case STAT_PHASE::Diagnostics: return "diagnostics";
+    case STAT_PHASE::Count: break;
+    }
+    return "invalid";
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Trace.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace smacpp {
+
+enum class STAT_COUNTER {
+    FunctionsLowered = 0,
+    ActionsLowered,
+    ConditionsEvaluated,
+    OperationsEnqueued,
+    //! Operations (for calls and paths) that reused a finished one from an OperationPool
+    OperationsRecycled,
+    //! BlockRegistry::FindFunction lookups that found (or didn't find) a function
+    RegistryHits,
+    RegistryMisses,
+    //! Calls that were not analysed again as a summary for the parameters existed
+    SummaryHits,
+    //! Operations that stopped at a call to wait for its summary
+    SummaryWaits,
+    //! Function summaries computed bottom-up before the analysis from the entry point
+    SummariesPrecomputed,
+    //! Calls that can lead back to the caller, whose parameters were widened
+    RecursiveCalls,
+    //! Calls whose parameters were widened as the caller already made too many different
+    //! calls to the same function
+    WidenedCalls,
+    //! Extra rounds operations calling themselves were analysed to reach a fixpoint
+    FixpointRounds,
+    //! Largest number of variable slots a single ProgramState had allocated
+    PeakProgramStateSize,
+    //! Paths created because a condition could not be determined
+    PathsSplit,
+    //! Paths joined back as they reached the same state
+    PathsJoined,
+    //! Undeterminable conditions that were skipped as the path limit was reached
+    PathLimitHits,
+    //! Analysis budgets of entry points or functions that ran out
+    BudgetsExhausted,
+
+    Count
+};
+
+enum class STAT_PHASE {
+    Lowering = 0,
+    SummaryWriting,
+    SummaryLoading,
+    Analysis,
+    Diagnostics,
+
+    Count
+};
+
+//! \brief Process wide performance counters and phase timers
+//!
+//! Nothing is recorded unless Enable has been called, so the disabled cost is a single
+//! relaxed atomic load. All methods are thread safe.
+class Statistics {
+public:
+    static void Enable(bool enabled);
+    static bool IsEnabled();
+
+    //! \brief Sets all counters and timers to zero
+    static void Reset();
+
+    static void Add(STAT_COUNTER counter, uint64_t amount = 1);
+
+    //! \brief Raises counter to value if it is currently lower
+    static void SetMax(STAT_COUNTER counter, uint64_t value);
+
+    static void AddTime(STAT_PHASE phase, std::chrono::nanoseconds duration);
+
+    static uint64_t Get(STAT_COUNTER counter);
+    static std::chrono::nanoseconds GetTime(STAT_PHASE phase);
+
+    //! \brief Prints a human readable table of all values
+    static void Print(llvm::raw_ostream& output);
+
+    //! \brief Prints all values as a single JSON object. Times are in milliseconds
+    static void PrintJSON(llvm::raw_ostream& output);
+
+    static const char* CounterToString(STAT_COUNTER counter);
+    static const char* PhaseToString(STAT_PHASE phase);
+};
+
+//! \brief Adds the time from construction to destruction to a phase
+//!
+//! The phase is also recorded in the Trace when tracing is enabled
+class PhaseTimer {
+public:
+    PhaseTimer(STAT_PHASE phase) :
+        Phase(phase), Enabled(Statistics::IsEnabled()),
+        Scope("phase", Statistics::PhaseToString(phase))
+    {
+        if(Enabled)
+            Start = std::chrono::steady_clock::now();
+    }
+
+    ~PhaseTimer()
+    {
+        if(Enabled)
+            Statistics::AddTime(Phase, std::chrono::steady_clock::now() - Start);
+    }
+
+    PhaseTimer(const PhaseTimer& other) = delete;
+    PhaseTimer& operator=(const PhaseTimer& other) = delete;
+
+private:
+    STAT_PHASE Phase;
+    bool Enabled;
+    std::chrono::steady_clock::time_point Start;
+    TraceScope Scope;
+};
+
+} // namespace smacpp
@@ -0,0 +1,157 @@
+// ------------------------------------ //
+#include "Trace.h"
+
+#include "llvm/Support/Format.h"
+
+#include <atomic>
+#include <mutex>
+
+using namespace smacpp;
+// ------------------------------------ //
+namespace {
+
+std::atomic<bool> TraceEnabled{false};
+std::atomic<uint32_t> NextThreadId{1};
+
+std::mutex EventsMutex;
+std::vector<TraceEvent> Events;
+std::chrono::steady_clock::time_point TraceStart;
+bool TraceStartSet = false;
+
+double ToMicroseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // namespace
+// ------------------------------------ //
+// Trace
+void Trace::Enable(bool enabled)
+{
+    if(enabled) {
+        std::lock_guard<std::mutex> lock(EventsMutex);
+
+        if(!TraceStartSet) {
+            TraceStart = std::chrono::steady_clock::now();
+            TraceStartSet = true;
+        }
+    }
+
+    TraceEnabled.store(enabled, std::memory_order_release);
+}
+
+bool Trace::IsEnabled()
+{
+    return TraceEnabled.load(std::memory_order_relaxed);
+}
+
+void Trace::Clear()
+{
+    std::lock_guard<std::mutex> lock(EventsMutex);
+    Events.clear();
+}
+
+void Trace::AddEvent(TraceEvent&& event)
+{
+    std::lock_guard<std::mutex> lock(EventsMutex);
+    Events.push_back(std::move(event));
+}
+
+uint32_t Trace::GetThreadId()
+{
+    thread_local const uint32_t id = NextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+// ------------------------------------ //
+void Trace::Write(llvm::raw_ostream& output)
+{
+    std::lock_guard<std::mutex> lock(EventsMutex);
+
+    output << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+    for(size_t i = 0; i < Events.size(); ++i) {
+        const auto& event = Events[i];
+
+        output << "{\"name\": ";
+        WriteJSONString(output, event.Name);
+        output << ", \"cat\": \"" << event.Category << "\", \"ph\": \"X\", \"ts\": "
+               << llvm::format("%.3f", ToMicroseconds(event.Start - TraceStart))
+               << ", \"dur\": " << llvm::format("%.3f", ToMicroseconds(event.Duration))
+               << ", \"pid\": 1, \"tid\": " << event.Thread;
+
+        if(!event.Args.empty()) {
+            output << ", \"args\": {";
+
+            for(size_t argIndex = 0; argIndex < event.Args.size(); ++argIndex) {
+                if(argIndex > 0)
+                    output << ", ";
+
+                WriteJSONString(output, event.Args[argIndex].first);
+                output << ": ";
+                WriteJSONString(output, event.Args[argIndex].second);
+            }
+
+            output << "}";
+        }
+
+        output << (i + 1 < Events.size() ? "},\n" : "}\n");
+    }
+
+    output << "]}\n";
+}
+
+bool Trace::WriteFile(const std::string& path)
+{
+    std::error_code error;
+    llvm::raw_fd_ostream file(path, error);
+
+    if(error)
+        return false;
+
+    Write(file);
+    return true;
+}
+
+void Trace::WriteJSONString(llvm::raw_ostream& output, const std::string& value)
+{
+    output << '"';
+
+    for(const char c : value) {
+        switch(c) {
+        case '"': output << "\\\""; break;
+        case '\\': output << "\\\\"; break;
+        case '\n': output << "\\n"; break;
+        case '\t': output << "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20) {
+                output << llvm::format("\\u%04x", static_cast<unsigned>(c));
+            } else {
+                output << c;
+            }
+        }
+    }
+
+    output << '"';
+}
+// ------------------------------------ //
+// TraceScope
+TraceScope::TraceScope(const char* category, const std::string& name) :
+    Active(Trace::IsEnabled())
+{
+    if(!Active)
+        return;
+
+    Event.Name = name;
+    Event.Category = category;
+    Event.Thread = Trace::GetThreadId();
+    Event.Start = std::chrono::steady_clock::now();
+}
+
+TraceScope::~TraceScope()
+{
+    if(!Active)
+        return;
+
+    Event.Duration = std::chrono::steady_clock::now() - Event.Start;
+    Trace::AddEvent(std::move(Event));
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace smacpp {
+
+//! \brief A single complete ("X") event in the Chrome trace event format
+struct TraceEvent {
+    std::string Name;
+    const char* Category = "";
+    std::chrono::steady_clock::time_point Start;
+    std::chrono::nanoseconds Duration{0};
+    uint32_t Thread = 0;
+    std::vector<std::pair<std::string, std::string>> Args;
+};
+
+//! \brief Records a timeline of what the parsing and analysis did
+//!
+//! The output can be opened in chrome://tracing or Perfetto. Like Statistics this is
+//! process wide, thread safe and does nothing until enabled.
+class Trace {
+public:
+    //! \brief Enables recording, timestamps are relative to the first time this is enabled
+    static void Enable(bool enabled);
+    static bool IsEnabled();
+
+    static void Clear();
+
+    static void AddEvent(TraceEvent&& event);
+
+    //! \returns A small number identifying the calling thread
+    static uint32_t GetThreadId();
+
+    //! \brief Writes the recorded events as trace event JSON
+    static void Write(llvm::raw_ostream& output);
+
+    //! \returns False if the file can't be written
+    static bool WriteFile(const std::string& path);
+
+    //! \brief Writes value as a quoted JSON string, escaping what JSON requires
+    static void WriteJSONString(llvm::raw_ostream& output, const std::string& value);
+};
+
+//! \brief Records an event from construction to destruction if tracing is enabled
+class TraceScope {
+public:
+    TraceScope(const char* category, const std::string& name);
+    ~TraceScope();
+
+    TraceScope(const TraceScope& other) = delete;
+    TraceScope& operator=(const TraceScope& other) = delete;
+
+    //! \brief True when this is recording. Check this before building expensive arguments
+    bool IsActive() const
+    {
+        return Active;
+    }
+
+    void AddArg(const std::string& name, std::string value)
+    {
+        if(Active)
+            Event.Args.emplace_back(name, std::move(value));
+    }
+
+private:
+    bool Active;
+    TraceEvent Event;
+};
+
+} // namespace smacpp
@@ -0,0 +1,54 @@
+// ------------------------------------ //
+#include "AnalysisBudget.h"
+
+#include "Statistics.h"
+
+using namespace smacpp;
+// ------------------------------------ //
+BudgetTracker::BudgetTracker(const AnalysisBudget& budget, const std::atomic<bool>* cancel) :
+    Budget(budget), Cancel(cancel), Start(std::chrono::steady_clock::now())
+{}
+// ------------------------------------ //
+bool BudgetTracker::Use(size_t operations, size_t memory)
+{
+    if(!Check())
+        return false;
+
+    const auto used =
+        UsedOperations.fetch_add(operations, std::memory_order_relaxed) + operations;
+
+    if(Budget.MaxOperations != 0 && used > Budget.MaxOperations)
+        return Exhaust(BUDGET_EXHAUSTION::Operations);
+
+    if(Budget.MaxMemory != 0 && memory > Budget.MaxMemory)
+        return Exhaust(BUDGET_EXHAUSTION::Memory);
+
+    return true;
+}
+
+bool BudgetTracker::Check()
+{
+    if(IsExhausted())
+        return false;
+
+    if(Cancel && Cancel->load(std::memory_order_relaxed))
+        return Exhaust(BUDGET_EXHAUSTION::Cancelled);
+
+    if(Budget.TimeLimit != 0 &&
+        std::chrono::steady_clock::now() - Start >
+            std::chrono::milliseconds(Budget.TimeLimit))
+        return Exhaust(BUDGET_EXHAUSTION::Time);
+
+    return true;
+}
+// ------------------------------------ //
+bool BudgetTracker::Exhaust(BUDGET_EXHAUSTION reason)
+{
+    // Only the first reason is kept when multiple threads run out at the same time
+    auto expected = BUDGET_EXHAUSTION::None;
+
+    if(Exhaustion.compare_exchange_strong(expected, reason))
+        Statistics::Add(STAT_COUNTER::BudgetsExhausted);
+
+    return false;
+}
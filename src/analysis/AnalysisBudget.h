@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace smacpp {
+
+//! \brief Limits for a part of the analysis, 0 disables a limit
+struct AnalysisBudget {
+    //! Wall-clock time in milliseconds
+    unsigned TimeLimit = 0;
+
+    //! For an entry point this is the number of analysed function calls, for a single
+    //! function call the number of actions run with each path counted separately
+    size_t MaxOperations = 0;
+
+    //! Bytes of program state kept at once. This is an estimate as forked states share
+    //! their storage
+    size_t MaxMemory = 0;
+};
+
+//! Why the analysis was stopped before it was done
+enum class BUDGET_EXHAUSTION : uint8_t { None, Time, Operations, Memory, Cancelled };
+
+inline const char* Dump(BUDGET_EXHAUSTION exhaustion)
+{
+    switch(exhaustion) {
+    case BUDGET_EXHAUSTION::None: return "none";
+    case BUDGET_EXHAUSTION::Time: return "time budget exhausted";
+    case BUDGET_EXHAUSTION::Operations: return "operation budget exhausted";
+    case BUDGET_EXHAUSTION::Memory: return "memory budget exhausted";
+    case BUDGET_EXHAUSTION::Cancelled: return "cancelled";
+    }
+
+    return "unknown";
+}
+
+//! \brief Tracks how much of an AnalysisBudget has been used
+//!
+//! Once any limit is reached the tracker stays exhausted, the analysis checks it between
+//! steps so stopping is cooperative
+//! \note This is thread safe
+class BudgetTracker {
+public:
+    //! \param cancel If not null the budget is exhausted as soon as this is set to true
+    BudgetTracker(const AnalysisBudget& budget, const std::atomic<bool>* cancel = nullptr);
+
+    //! \brief Counts operations and checks all the limits
+    //! \param memory The memory currently in use
+    //! \returns True if the budget is not exhausted
+    bool Use(size_t operations, size_t memory);
+
+    //! \brief Checks the limits that don't depend on the caller, time and cancellation
+    //! \returns True if the budget is not exhausted
+    bool Check();
+
+    BUDGET_EXHAUSTION GetExhaustion() const
+    {
+        return Exhaustion.load(std::memory_order_relaxed);
+    }
+
+    bool IsExhausted() const
+    {
+        return GetExhaustion() != BUDGET_EXHAUSTION::None;
+    }
+
+    size_t GetUsedOperations() const
+    {
+        return UsedOperations.load(std::memory_order_relaxed);
+    }
+
+private:
+    //! \returns False to make returning from the checks shorter
+    bool Exhaust(BUDGET_EXHAUSTION reason);
+
+private:
+    const AnalysisBudget Budget;
+    const std::atomic<bool>* const Cancel;
+    const std::chrono::steady_clock::time_point Start;
+
+    std::atomic<size_t> UsedOperations{0};
+    std::atomic<BUDGET_EXHAUSTION> Exhaustion{BUDGET_EXHAUSTION::None};
+};
+
+} // namespace smacpp
@@ -2,27 +2,39 @@
 #include "Analyzer.h"
 
 #include "BlockRegistry.h"
+#include "Logging.h"
+#include "Statistics.h"
+#include "Trace.h"
+#include "WorkStealingQueue.h"
 #include "parse/CodeBlock.h"
 #include "parse/ProcessedAction.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
 #include <sstream>
-
-// DEBUGGING CODE
-#include <iostream>
+#include <thread>
 
 using namespace smacpp;
 // ------------------------------------ //
 // FoundProblem
-FoundProblem::FoundProblem(
-    SEVERITY severity, const std::string& message, clang::SourceLocation loc) :
+FoundProblem::FoundProblem(SEVERITY severity, const std::string& message,
+    clang::SourceLocation loc, const SourcePosition& position) :
     Severity(severity),
-    Message(message), Location(loc)
+    Message(message), Location(loc), Position(position)
 {}
 // ------------------------------------ //
 std::string FoundProblem::FormatAsString() const
 {
     std::stringstream sstream;
 
+    if(Position.IsValid())
+        sstream << Position.Dump() << ": ";
+
     switch(Severity) {
     case SEVERITY::Info: sstream << "info:"; break;
     case SEVERITY::Warning: sstream << "warning:"; break;
@@ -38,12 +50,12 @@ std::string FoundProblem::FormatAsString() const
 void ProgramState::CreateLocal(VariableIdentifier identifier, VariableState initialState)
 {
     // TODO: allow shadowing globals and locals defined in upper scope
-    Variables[identifier] = initialState;
+    Assign(identifier, initialState);
 }
 
 void ProgramState::Assign(VariableIdentifier identifier, VariableState state)
 {
-    Variables[identifier] = state;
+    Variables.Set(identifier.ID, std::move(state));
 }
 // ------------------------------------ //
 bool ProgramState::MatchesCondition(const Condition& condition) const
@@ -53,37 +65,276 @@ bool ProgramState::MatchesCondition(const Condition& condition) const
 
 VariableState ProgramState::GetVariableValue(const VariableIdentifier& variable) const
 {
-    const auto found = Variables.find(variable);
+    const auto* found = Variables.TryGet(variable.ID);
 
-    if(found == Variables.end()) {
+    if(!found) {
         return VariableState();
     }
 
     try {
-        return found->second.Resolve(*this);
+        return found->Resolve(*this);
     } catch(const UnknownVariableStateException& e) {
-        // if(Debug)
-        std::cout << "Variable could not be fully resolved: " << variable.Dump()
-                  << " exception: " << e.what() << "\n";
+        SMACPP_LOG(Debug, Analysis,
+            "Variable could not be fully resolved: " << variable.Dump()
+                                                     << " exception: " << e.what());
         return VariableState();
     }
 }
 
 VariableState ProgramState::GetVariableValueRaw(const VariableIdentifier& variable) const
 {
-    const auto found = Variables.find(variable);
+    const auto* found = Variables.TryGet(variable.ID);
 
-    if(found == Variables.end()) {
+    if(!found) {
         return VariableState();
     }
-    return found->second;
+
+    return *found;
+}
+// ------------------------------------ //
+bool ProgramState::HasSameValues(const ProgramState& other) const
+{
+    if(Variables.SharesStorage(other.Variables))
+        return true;
+
+    bool same = true;
+
+    // Values missing from one of the states are unknown, which a default VariableState is
+    const auto compare = [&same](const CopyOnWriteVector<VariableState>& values,
+                             const CopyOnWriteVector<VariableState>& otherValues) {
+        values.ForEach([&](size_t id, const VariableState& value) {
+            if(!same)
+                return;
+
+            const auto* otherValue = otherValues.TryGet(id);
+
+            if(otherValue ? !(*otherValue == value) :
+                            value.State != VariableState::STATE::Unknown)
+                same = false;
+        });
+    };
+
+    compare(Variables, other.Variables);
+    compare(other.Variables, Variables);
+
+    return same;
+}
+
+void ProgramState::Join(const ProgramState& other)
+{
+    if(Variables.SharesStorage(other.Variables))
+        return;
+
+    std::vector<std::tuple<size_t, VariableState>> joined;
+
+    // Variables missing from the other state are unknown there so they become unknown
+    Variables.ForEach([&](size_t id, const VariableState& value) {
+        const auto* otherValue = other.Variables.TryGet(id);
+
+        if(value.State == VariableState::STATE::Unknown ||
+            (otherValue && *otherValue == value))
+            return;
+
+        joined.emplace_back(id, otherValue ? value.Join(*otherValue) : VariableState());
+    });
+
+    other.Variables.ForEach([&](size_t id, const VariableState& value) {
+        if(value.State != VariableState::STATE::Unknown && !Variables.TryGet(id))
+            joined.emplace_back(id, VariableState());
+    });
+
+    for(auto& [id, value] : joined)
+        Variables.Set(id, std::move(value));
 }
 // ------------------------------------ //
 // DoneAnalysisRegistry
 bool DoneAnalysisRegistry::HasBeenDone(
     const CodeBlock* func, const std::vector<VariableState>& params)
 {
-    const auto found = RecordedFunctionCalls.find(func->GetName());
+    std::lock_guard<std::mutex> lock(Mutex);
+    return HasBeenDoneUnlocked(func, params);
+}
+
+void DoneAnalysisRegistry::Add(const CodeBlock* func, const std::vector<VariableState>& params)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    AddUnlocked(func, params);
+}
+
+bool DoneAnalysisRegistry::CheckAndAdd(
+    const CodeBlock* func, const std::vector<VariableState>& params)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    if(HasBeenDoneUnlocked(func, params))
+        return false;
+
+    AddUnlocked(func, params);
+    return true;
+}
+
+void DoneAnalysisRegistry::AddSummary(const CodeBlock* func,
+    const std::vector<VariableState>& params, FunctionSummary&& summary,
+    std::list<AnalysisOperation>& woken)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    RecordedFunctionCalls[func][params] =
+        std::make_shared<const FunctionSummary>(std::move(summary));
+
+    const auto waiters = Waiters.find(func);
+
+    if(waiters == Waiters.end())
+        return;
+
+    // The operations waiting for other calls of func, or for more calls, are added back
+    const auto operations = std::move(waiters->second);
+    Waiters.erase(waiters);
+
+    for(const auto operation : operations) {
+        if(!WaitUnlocked(operation))
+            woken.splice(woken.end(), WaitingOperations, operation);
+    }
+}
+
+bool DoneAnalysisRegistry::WaitForSummary(
+    std::list<AnalysisOperation>& list, std::list<AnalysisOperation>::iterator operation)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    if(!WaitUnlocked(operation))
+        return false;
+
+    WaitingOperations.splice(WaitingOperations.end(), list, operation);
+    return true;
+}
+
+void DoneAnalysisRegistry::AbandonUnfinished(std::list<AnalysisOperation>& waiting)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    Waiters.clear();
+    waiting.splice(waiting.end(), WaitingOperations);
+
+    // Lets a later analysis queue the calls again instead of waiting for them forever
+    for(auto& [func, calls] : RecordedFunctionCalls) {
+        for(auto call = calls.begin(); call != calls.end();) {
+            if(call->second) {
+                ++call;
+            } else {
+                call = calls.erase(call);
+            }
+        }
+    }
+}
+
+std::shared_ptr<const FunctionSummary> DoneAnalysisRegistry::FindSummary(
+    const CodeBlock* func, const std::vector<VariableState>& params)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    const auto found = RecordedFunctionCalls.find(func);
+
+    if(found == RecordedFunctionCalls.end())
+        return nullptr;
+
+    const auto call = found->second.find(params);
+
+    if(call == found->second.end())
+        return nullptr;
+
+    return call->second;
+}
+
+std::shared_ptr<const FunctionSummary> DoneAnalysisRegistry::StartPrecomputed(
+    const CodeBlock* func, const std::vector<VariableState>& params, bool& started)
+{
+    std::unique_lock<std::mutex> lock(Mutex);
+
+    // The computing thread only waits for calls in earlier call graph components so this
+    // can't deadlock
+    while(true) {
+        const auto [call, added] = PrecomputedCalls[func].emplace(params, nullptr);
+
+        if(added || call->second) {
+            started = added;
+            return call->second;
+        }
+
+        PrecomputedDone.wait(lock);
+    }
+}
+
+std::shared_ptr<const FunctionSummary> DoneAnalysisRegistry::AddPrecomputed(
+    const CodeBlock* func, const std::vector<VariableState>& params, FunctionSummary&& summary)
+{
+    auto stored = std::make_shared<const FunctionSummary>(std::move(summary));
+
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        PrecomputedCalls[func][params] = stored;
+    }
+
+    PrecomputedDone.notify_all();
+    return stored;
+}
+
+void DoneAnalysisRegistry::AbandonPrecomputed(
+    const CodeBlock* func, const std::vector<VariableState>& params)
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        PrecomputedCalls[func].erase(params);
+    }
+
+    PrecomputedDone.notify_all();
+}
+
+std::shared_ptr<const FunctionSummary> DoneAnalysisRegistry::FindPrecomputed(
+    const CodeBlock* func, const std::vector<VariableState>& params)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    const auto found = PrecomputedCalls.find(func);
+
+    if(found == PrecomputedCalls.end())
+        return nullptr;
+
+    const auto call = found->second.find(params);
+
+    if(call == found->second.end())
+        return nullptr;
+
+    return call->second;
+}
+
+std::shared_ptr<const FunctionSummary> DoneAnalysisRegistry::ClaimPrecomputed(
+    const CodeBlock* func, const std::vector<VariableState>& params)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    const auto found = PrecomputedCalls.find(func);
+
+    if(found == PrecomputedCalls.end() || HasBeenDoneUnlocked(func, params))
+        return nullptr;
+
+    const auto call = found->second.find(params);
+
+    // Summaries that are still being computed can't be claimed
+    if(call == found->second.end() || !call->second)
+        return nullptr;
+
+    auto summary = std::move(call->second);
+    found->second.erase(call);
+
+    RecordedFunctionCalls[func][params] = summary;
+    return summary;
+}
+
+bool DoneAnalysisRegistry::HasBeenDoneUnlocked(
+    const CodeBlock* func, const std::vector<VariableState>& params)
+{
+    const auto found = RecordedFunctionCalls.find(func);
 
     if(found == RecordedFunctionCalls.end()) {
         return false;
@@ -92,74 +343,245 @@ bool DoneAnalysisRegistry::HasBeenDone(
     return found->second.find(params) != found->second.end();
 }
 
-void DoneAnalysisRegistry::Add(const CodeBlock* func, const std::vector<VariableState>& params)
+bool DoneAnalysisRegistry::WaitUnlocked(std::list<AnalysisOperation>::iterator operation)
 {
-    const auto existing = RecordedFunctionCalls.find(func->GetName());
+    const auto isDone = [&](const AnalysisOperation& path) {
+        if(!path.WaitFunction)
+            return true;
 
-    if(existing == RecordedFunctionCalls.end()) {
-        RecordedFunctionCalls[func->GetName()] = {params};
-    } else {
-        existing->second.insert(params);
+        const auto found = RecordedFunctionCalls.find(path.WaitFunction);
+
+        // A call that isn't recorded is not going to get a summary
+        if(found == RecordedFunctionCalls.end())
+            return true;
+
+        const auto call = found->second.find(path.WaitParams);
+        return call == found->second.end() || call->second != nullptr;
+    };
+
+    const AnalysisOperation* waiting = isDone(*operation) ? nullptr : &*operation;
+
+    for(auto path = operation->Paused->Paths.begin();
+        !waiting && path != operation->Paused->Paths.end(); ++path) {
+        if(!isDone(*path))
+            waiting = &*path;
     }
+
+    if(!waiting)
+        return false;
+
+    Waiters[waiting->WaitFunction].push_back(operation);
+    return true;
 }
 
-bool DoneAnalysisRegistry::CheckAndAdd(
+void DoneAnalysisRegistry::AddUnlocked(
     const CodeBlock* func, const std::vector<VariableState>& params)
 {
-    if(HasBeenDone(func, params))
+    // emplace doesn't overwrite an existing summary
+    RecordedFunctionCalls[func].emplace(params, nullptr);
+}
+// ------------------------------------ //
+// CallContextLimit
+bool CallContextLimit::Limit(const CodeBlock* function, std::vector<VariableState>& params)
+{
+    if(MaxContexts == 0)
+        return false;
+
+    auto& contexts = Functions[function];
+
+    if(std::find(contexts.Used.begin(), contexts.Used.end(), params) != contexts.Used.end())
         return false;
 
-    Add(func, params);
+    if(contexts.Used.size() < MaxContexts) {
+        contexts.Used.push_back(params);
+        return false;
+    }
+
+    if(!contexts.Full) {
+        // The first widened call covers all the earlier ones
+        contexts.Widened = params;
+
+        for(const auto& used : contexts.Used) {
+            if(used.size() != params.size())
+                continue;
+
+            for(size_t i = 0; i < params.size(); ++i)
+                contexts.Widened[i] = contexts.Widened[i].Join(used[i]);
+        }
+
+        contexts.Full = true;
+    } else {
+        // Calls with a different parameter count (through a mismatched declaration) are
+        // left alone
+        if(contexts.Widened.size() != params.size())
+            return false;
+
+        for(size_t i = 0; i < params.size(); ++i)
+            contexts.Widened[i] = contexts.Widened[i].Widen(params[i]);
+    }
+
+    params = contexts.Widened;
     return true;
 }
-
 // ------------------------------------ //
 // AnalysisOperation
-void AnalysisOperation::HandleAction(const action::FunctionCall* call)
+void AnalysisOperation::HandleAction(const action::FunctionCall& call, size_t actionIndex)
 {
-    const CodeBlock* calledFunction = AvailableFunctions->FindFunction(call->Function);
+    const CodeBlock* calledFunction = AvailableFunctions->FindFunction(call.Function);
+
+    if(!calledFunction)
+        return;
 
-    if(calledFunction) {
+    auto& newOp = Pool->Acquire(FoundCalls, *calledFunction);
 
-        // if(calledFunction == CurrentFunction) {
-        //     // TODO: add proper handling for recursion
-        //     return;
-        // }
+    // Resolved with the caller state to not mix up calls that pass different values in the
+    // same variable
+    auto& params = newOp.CallParameters;
 
-        AnalysisOperation newOp(
-            calledFunction->GetActions(), AvailableFunctions, Problems, DoneOperations);
-        newOp.CurrentFunction = calledFunction;
+    for(const auto& param : call.Params)
+        params.push_back(param.Resolve(*State));
 
-        if(Analyzer::ResolveCallParameters(newOp, *calledFunction, call->Params)) {
+    const bool recursive = IsRecursiveCall(calledFunction);
 
-            // TODO: this should be moved to use the resolved parameters
-            if(DoneOperations.CheckAndAdd(calledFunction, call->Params)) {
-                FoundCalls.push_back(std::move(newOp));
-            }
+    if(recursive) {
+        // Recursion that changes the parameters each round, like f(n - 1), would otherwise
+        // create new calls forever. Widening against the parameters of this call only grows
+        // them a few times before they stop changing. Going around a cycle through other
+        // functions can change the parameters in any way so those calls get unknown ones
+        if(calledFunction == CurrentFunction && params.size() == CallParameters.size()) {
+            for(size_t i = 0; i < params.size(); ++i)
+                params[i] = CallParameters[i].Widen(params[i]);
+        } else {
+            for(auto& param : params)
+                param = VariableState();
+        }
+
+        Statistics::Add(STAT_COUNTER::RecursiveCalls);
+    }
+
+    if(CallContexts && CallContexts->Limit(calledFunction, params))
+        Statistics::Add(STAT_COUNTER::WidenedCalls);
+
+    if(recursive) {
+        if(calledFunction == CurrentFunction && params == CallParameters) {
+            CallsItself = true;
+
+            if(RecursionSummary)
+                ApplyGlobalEffects(*RecursionSummary);
+
+            Pool->Release(FoundCalls, std::prev(FoundCalls.end()));
+            return;
+        }
+
+        // The summary of a function in the same component can depend on this one so it
+        // can't be waited for. Its effects are not applied even if it happens to be done to
+        // get the same results no matter in which order the operations run. Instead all the
+        // globals the call could write are forgotten. When run bottom-up the call is kept
+        // in FoundCalls to be recorded in the summary of this function.
+        if(Graph)
+            ForgetGlobals(Graph->GetWrittenGlobals(Graph->GetComponent(calledFunction)));
+
+        if(BottomUp)
+            return;
+
+        if(Analyzer::ResolveCallParameters(newOp, *calledFunction, params) &&
+            DoneOperations.CheckAndAdd(calledFunction, params)) {
+
+            Statistics::Add(STAT_COUNTER::OperationsEnqueued);
+            return;
         }
+
+        Pool->Release(FoundCalls, std::prev(FoundCalls.end()));
+        return;
+    }
+
+    if(const auto summary = DoneOperations.FindSummary(calledFunction, params); summary) {
+
+        // Already analysed with these parameters, so only the effects need to be applied
+        ApplyGlobalEffects(*summary);
+
+        Pool->Release(FoundCalls, std::prev(FoundCalls.end()));
+        Statistics::Add(STAT_COUNTER::SummaryHits);
+        return;
+    }
+
+    if(BottomUp) {
+        // The callees are done first so their summaries are ready, or computed now for these
+        // parameters. The call is kept in FoundCalls to be recorded in the summary of this
+        auto summary = DoneOperations.FindPrecomputed(calledFunction, params);
+
+        if(!summary)
+            summary = BottomUp->PrecomputeCall(*this, *calledFunction, params);
+
+        if(summary)
+            ApplyGlobalEffects(*summary);
+
+        return;
+    }
+
+    if(auto summary = DoneOperations.ClaimPrecomputed(calledFunction, params); summary) {
+
+        ApplyGlobalEffects(*summary);
+
+        Pool->Release(FoundCalls, std::prev(FoundCalls.end()));
+        UsePrecomputed(std::move(summary));
+        Statistics::Add(STAT_COUNTER::SummaryHits);
+        return;
+    }
+
+    // A call with the wrong number of parameters can't be analysed
+    if(!Analyzer::ResolveCallParameters(newOp, *calledFunction, params)) {
+        Pool->Release(FoundCalls, std::prev(FoundCalls.end()));
+        return;
+    }
+
+    // The rest of this depends on the effects of the call so this is stopped and run again
+    // once its summary is done
+    if(!WaitFunction) {
+        WaitFunction = calledFunction;
+        WaitParams = params;
     }
+
+    if(DoneOperations.CheckAndAdd(calledFunction, params)) {
+        Statistics::Add(STAT_COUNTER::OperationsEnqueued);
+    } else {
+        Pool->Release(FoundCalls, std::prev(FoundCalls.end()));
+    }
+}
+
+bool AnalysisOperation::IsRecursiveCall(const CodeBlock* function) const
+{
+    // Without the graph no call is known to be safe to wait for
+    if(!Graph)
+        return true;
+
+    return Graph->GetComponent(function) == Graph->GetComponent(CurrentFunction);
 }
 
-void AnalysisOperation::HandleAction(const action::VarDeclared* var)
+void AnalysisOperation::HandleAction(const action::VarDeclared& var, size_t actionIndex)
 {
     // TODO: should resolve happen here?
-    State->CreateLocal(var->Variable, var->State.Resolve(*State));
+    State->CreateLocal(var.Variable, var.State.Resolve(*State));
+    Assumptions.Forget(var.Variable);
+    RecordWrite(var.Variable);
 }
 
-void AnalysisOperation::HandleAction(const action::VarAssigned* var)
+void AnalysisOperation::HandleAction(const action::VarAssigned& var, size_t actionIndex)
 {
     // TODO: should resolve happen here?
-    State->Assign(var->Variable, var->State.Resolve(*State));
+    State->Assign(var.Variable, var.State.Resolve(*State));
+    Assumptions.Forget(var.Variable);
+    RecordWrite(var.Variable);
 }
 
-void AnalysisOperation::HandleAction(const action::ArrayIndexAccess* index)
+void AnalysisOperation::HandleAction(const action::ArrayIndexAccess& index, size_t actionIndex)
 {
-    const auto array = State->GetVariableValue(index->Array).Resolve(*State);
+    const auto array = State->GetVariableValue(index.Array).Resolve(*State);
 
     if(array.State == VariableState::STATE::Unknown)
         return;
 
-    const auto indexVar = index->Index.Resolve(*State);
+    const auto indexVar = index.Index.Resolve(*State);
 
     if(indexVar.State == VariableState::STATE::Unknown)
         return;
@@ -168,116 +590,1184 @@ void AnalysisOperation::HandleAction(const action::ArrayIndexAccess* index)
 
         // TODO: emit line numbers
         if(buf->NullPtr) {
-            Problems.push_back(FoundProblem(
-                FoundProblem::SEVERITY::Error, "Write to nullptr array", index->Location));
+            ReportProblem("Write to nullptr array", actionIndex);
         } else {
 
+            const auto bufferSize = "buffer size: " + std::to_string(buf->AllocatedSize);
+
             if(auto indexNumber = std::get_if<PrimitiveInfo>(&indexVar.Value); indexNumber) {
-                if(buf->AllocatedSize <= indexNumber->AsInteger()) {
 
-                    Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
-                        "Buffer overflow: buffer size: " + std::to_string(buf->AllocatedSize) +
-                            " used index: " + std::to_string(indexNumber->AsInteger()),
-                        index->Location));
+                const auto value = indexNumber->AsInteger();
+                const auto usedIndex = " used index: " + std::to_string(value);
+
+                if(value < 0) {
+                    ReportProblem("Buffer underflow: " + bufferSize + usedIndex, actionIndex);
+                } else if(buf->AllocatedSize <= static_cast<size_t>(value)) {
+                    ReportProblem("Buffer overflow: " + bufferSize + usedIndex, actionIndex);
+                }
+            } else if(auto indexRange = std::get_if<IntervalInfo>(&indexVar.Value);
+                      indexRange) {
+                // The whole range is checked at once instead of each value separately. Only
+                // ranges that are entirely out of bounds are certain to be errors, as the
+                // range can include values that the code never uses
+                const auto usedRange = " used index range: " + indexRange->Dump();
+                const auto outOfBounds = [&](IntervalInfo::Integer value) {
+                    return value >= 0 && buf->AllocatedSize <= static_cast<size_t>(value);
+                };
+
+                if(outOfBounds(indexRange->Min)) {
+                    ReportProblem("Buffer overflow: " + bufferSize + usedRange, actionIndex);
+                } else if(indexRange->Max < 0) {
+                    ReportProblem("Buffer underflow: " + bufferSize + usedRange, actionIndex);
+                } else {
+                    if(outOfBounds(indexRange->Max)) {
+                        ReportProblem("Possible buffer overflow: " + bufferSize + usedRange,
+                            actionIndex, FoundProblem::SEVERITY::Warning);
+                    }
+
+                    if(indexRange->Min < 0) {
+                        ReportProblem("Possible buffer underflow: " + bufferSize + usedRange,
+                            actionIndex, FoundProblem::SEVERITY::Warning);
+                    }
                 }
             }
         }
     }
 }
-// ------------------------------------ //
-// Analyzer
-Analyzer::Analyzer(std::vector<FoundProblem>& reportProblems) : Problems(reportProblems) {}
-// ------------------------------------ //
-bool Analyzer::BeginAnalysis(const CodeBlock& entryPoint,
-    const BlockRegistry* availableFunctions, const std::vector<VariableState>& callParameters)
+
+void AnalysisOperation::ReportProblem(
+    const std::string& message, size_t actionIndex, FoundProblem::SEVERITY severity)
 {
-    std::list<AnalysisOperation> toCheck;
+    Problems.push_back(FoundProblem(severity, message,
+        CurrentFunction->GetActions()[actionIndex].Location,
+        CurrentFunction->GetActionPosition(actionIndex)));
+}
 
-    {
-        AnalysisOperation entryAnalysis(
-            entryPoint.GetActions(), availableFunctions, Problems, AlreadyQueuedOps);
-        entryAnalysis.CurrentFunction = &entryPoint;
+void AnalysisOperation::ApplyWaitedSummary()
+{
+    if(!WaitFunction)
+        return;
 
-        if(!ResolveCallParameters(entryAnalysis, entryPoint, callParameters)) {
-            Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
-                "given parameters count mismatches analysis entrypoint parameter count",
-                entryPoint.GetLocation()));
-            return false;
-        }
+    if(const auto summary = DoneOperations.FindSummary(WaitFunction, WaitParams); summary) {
+        ApplyGlobalEffects(*summary);
+        Statistics::Add(STAT_COUNTER::SummaryHits);
+    }
 
-        toCheck.push_back(std::move(entryAnalysis));
-        // TODO: this should be moved to use the resolved parameters
-        AlreadyQueuedOps.Add(&entryPoint, callParameters);
+    WaitFunction = nullptr;
+    WaitParams.clear();
+}
+
+void AnalysisOperation::ApplyGlobalEffects(const FunctionSummary& summary)
+{
+    for(const auto& [variable, value] : summary.GlobalEffects) {
+        State->Assign(variable, value);
+        Assumptions.Forget(variable);
+        RecordWrite(variable);
     }
+}
 
-    while(!toCheck.empty()) {
+void AnalysisOperation::ForgetGlobals(const std::vector<size_t>& globals)
+{
+    for(const auto id : globals) {
+        const auto variable = VariableIdentifier::FromID(id);
+        State->Assign(variable, VariableState());
+        Assumptions.Forget(variable);
+        RecordWrite(variable);
+    }
+}
 
-        const auto result = PerformAnalysisOperation(toCheck.front());
+void AnalysisOperation::RecordWrite(const VariableIdentifier& variable)
+{
+    if(!VariableNameTable::Get().IsGlobal(variable.ID))
+        return;
 
-        if(!std::get<0>(result)) {
-            Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
-                "an analysis step failed", clang::SourceLocation{}));
-            return false;
-        }
+    const auto position =
+        std::lower_bound(WrittenGlobals.begin(), WrittenGlobals.end(), variable.ID);
+
+    if(position == WrittenGlobals.end() || *position != variable.ID)
+        WrittenGlobals.insert(position, variable.ID);
+}
 
-        const auto& newOps = std::get<1>(result);
+void AnalysisOperation::UsePrecomputed(std::shared_ptr<const FunctionSummary> summary)
+{
+    // The problems of the precomputed summary haven't been reported as it wasn't known
+    // whether anything actually makes the call
+    std::vector<std::shared_ptr<const FunctionSummary>> claimed{std::move(summary)};
 
-        if(!newOps.empty()) {
+    while(!claimed.empty()) {
+        const auto current = std::move(claimed.back());
+        claimed.pop_back();
+        ++ClaimedSummaries;
 
-            for(auto&& op : newOps)
-                toCheck.push_back(std::move(op));
-        }
+        CalleeProblems.insert(
+            CalleeProblems.end(), current->Problems.begin(), current->Problems.end());
 
-        toCheck.pop_front();
-    }
+        for(const auto& [function, params] : current->Calls) {
 
-    return true;
+            if(DoneOperations.HasBeenDone(function, params))
+                continue;
+
+            if(auto callee = DoneOperations.ClaimPrecomputed(function, params); callee) {
+                claimed.push_back(std::move(callee));
+                continue;
+            }
+
+            auto& newOp = Pool->Acquire(FoundCalls, *function);
+            newOp.CallParameters = params;
+
+            if(Analyzer::ResolveCallParameters(newOp, *function, params) &&
+                DoneOperations.CheckAndAdd(function, params)) {
+
+                Statistics::Add(STAT_COUNTER::OperationsEnqueued);
+                continue;
+            }
+
+            Pool->Release(FoundCalls, std::prev(FoundCalls.end()));
+        }
+    }
 }
 // ------------------------------------ //
-bool Analyzer::ResolveCallParameters(AnalysisOperation& operation, const CodeBlock& function,
-    const std::vector<VariableState>& callParameters)
+FunctionSummary AnalysisOperation::CreateSummary() const
 {
-    if(callParameters.size() != function.GetParameters().size()) {
-        return false;
-    }
-
-    for(size_t i = 0; i < callParameters.size(); ++i) {
+    FunctionSummary summary;
+    summary.Problems = Problems;
 
-        const auto resolved = callParameters[i].Resolve(*operation.State);
-
-        operation.State->CreateLocal(function.GetParameters()[i], resolved);
+    // Globals with an unknown value are included so that the callers forget the value they
+    // had before the call
+    for(const auto id : WrittenGlobals) {
+        const auto variable = VariableIdentifier::FromID(id);
+        summary.GlobalEffects.emplace_back(variable, State->GetVariableValue(variable));
     }
 
-    return true;
+    return summary;
 }
 // ------------------------------------ //
-std::tuple<bool, std::list<AnalysisOperation>> Analyzer::PerformAnalysisOperation(
-    AnalysisOperation& operation)
+AnalysisOperation& AnalysisOperation::Split(std::list<AnalysisOperation>& paths) const
 {
-    // TODO: when a conditional is uncertain the check needs to be split into two here to
-    // independently check both uncertain outcomes
+    auto& path = Pool->Acquire(paths, *CurrentFunction);
 
-    for(auto iter = operation.Actions.begin(); iter != operation.Actions.end(); ++iter) {
+    // Shares the variable storage until one of the paths writes to it
+    *path.State = *State;
+    path.CallParameters = CallParameters;
+    path.Assumptions = Assumptions;
+    path.WrittenGlobals = WrittenGlobals;
+    path.BottomUp = BottomUp;
+    path.Graph = Graph;
+    path.RecursionSummary = RecursionSummary;
+    path.CallContexts = CallContexts;
 
-        const ProcessedAction& action = **iter;
+    return path;
+}
 
-        try {
-            if(operation.State->MatchesCondition(action.If)) {
+void AnalysisOperation::Join(AnalysisOperation&& path)
+{
+    State->Join(*path.State);
 
-                if(Debug)
-                    std::cout << "analysis at step: " << action.Dump() << "\n";
-                action.Dispatch(operation);
+    // Only the assumptions both paths made still hold
+    Assumptions.Intersect(path.Assumptions);
 
-            } else {
-                // If the failure was due to unknown variable states execution should split
-                // here, see the TODO above
-            }
-        } catch(const UnknownVariableStateException& e) {
-            if(Debug)
-                std::cout << "Unknown variable state at step: " << action.Dump() << ": "
-                          << action.Dump() << "\n";
+    // A global written by only one of the paths is part of the effects as well
+    if(path.WrittenGlobals != WrittenGlobals) {
+        std::vector<size_t> written;
+        std::set_union(WrittenGlobals.begin(), WrittenGlobals.end(),
+            path.WrittenGlobals.begin(), path.WrittenGlobals.end(),
+            std::back_inserter(written));
+        WrittenGlobals = std::move(written);
+    }
+
+    CallsItself = CallsItself || path.CallsItself;
+    ClaimedSummaries += path.ClaimedSummaries;
+
+    if(!WaitFunction && path.WaitFunction) {
+        WaitFunction = path.WaitFunction;
+        WaitParams = std::move(path.WaitParams);
+    }
+
+    CalleeProblems.insert(CalleeProblems.end(),
+        std::make_move_iterator(path.CalleeProblems.begin()),
+        std::make_move_iterator(path.CalleeProblems.end()));
+
+    FoundCalls.splice(FoundCalls.end(), path.FoundCalls);
+
+    // Actions that ran before the paths diverged or that don't depend on the assumptions
+    // find the same problems in both paths
+    for(auto& problem : path.Problems) {
+        const bool duplicate =
+            std::any_of(Problems.begin(), Problems.end(), [&](const FoundProblem& existing) {
+                return existing.Location == problem.Location &&
+                       existing.Position == problem.Position &&
+                       existing.Message == problem.Message;
+            });
+
+        if(!duplicate)
+            Problems.push_back(std::move(problem));
+    }
+}
+
+void AnalysisOperation::Assume(const CompiledCondition::Test& test, bool outcome)
+{
+    Assumptions.Add(test, outcome);
+
+    if(!test.Variable)
+        return;
+
+    const auto current = State->GetVariableValue(*test.Variable);
+
+    // Only existing intervals are narrowed, unknown values are left for the assumptions
+    const auto* interval = std::get_if<IntervalInfo>(&current.Value);
+
+    if(!interval)
+        return;
+
+    const auto range = outcome ? test.Range : test.Range.Negate();
+    std::optional<IntervalInfo> narrowed;
+
+    switch(range.Type) {
+    case ValueRange::RANGE_CLASS::NotZero:
+        narrowed = interval->Restrict(COMPARISON::NOT_EQUAL, 0);
+        break;
+    case ValueRange::RANGE_CLASS::Zero:
+        narrowed = interval->Restrict(COMPARISON::EQUAL, 0);
+        break;
+    case ValueRange::RANGE_CLASS::Constant:
+        if(const auto constant = IntervalInfo::FromState(*range.ComparedConstant);
+            constant && constant->IsSingleValue())
+            narrowed = interval->Restrict(range.Comparison, constant->Min);
+        break;
+    case ValueRange::RANGE_CLASS::Comparison: break;
+    }
+
+    if(narrowed)
+        State->Assign(*test.Variable, VariableState::FromInterval(*narrowed));
+}
+
+void AnalysisOperation::Clear()
+{
+    // A state that is shared with another operation can't be reused
+    if(State && State.use_count() == 1) {
+        State->Clear();
+    } else {
+        State.reset();
+    }
+
+    CallParameters.clear();
+    Assumptions.Clear();
+    WrittenGlobals.clear();
+    Problems.clear();
+    FoundCalls.clear();
+    BottomUp = nullptr;
+    Graph = nullptr;
+    CallsItself = false;
+    RecursionSummary.reset();
+    CallContexts = nullptr;
+    ClaimedSummaries = 0;
+    CalleeProblems.clear();
+    WaitFunction = nullptr;
+    WaitParams.clear();
+    Paused.reset();
+    FixpointRound = 1;
+}
+// ------------------------------------ //
+// OperationPool
+AnalysisOperation& OperationPool::Acquire(
+    std::list<AnalysisOperation>& list, const CodeBlock& function)
+{
+    if(Free.empty()) {
+        list.emplace_back(function, AvailableFunctions, DoneOperations);
+    } else {
+        list.splice(list.end(), Free, Free.begin());
+        Statistics::Add(STAT_COUNTER::OperationsRecycled);
+    }
+
+    auto& operation = list.back();
+    operation.CurrentFunction = &function;
+    operation.Pool = this;
+
+    if(!operation.State)
+        operation.State = std::make_shared<ProgramState>();
+
+    return operation;
+}
+
+void OperationPool::Release(
+    std::list<AnalysisOperation>& list, std::list<AnalysisOperation>::iterator operation)
+{
+    ReleaseAll(operation->FoundCalls);
+    operation->Clear();
+
+    Free.splice(Free.end(), list, operation);
+}
+
+void OperationPool::ReleaseAll(std::list<AnalysisOperation>& list)
+{
+    while(!list.empty())
+        Release(list, list.begin());
+}
+// ------------------------------------ //
+// Analyzer
+Analyzer::Analyzer(std::vector<FoundProblem>& reportProblems) : Problems(reportProblems) {}
+// ------------------------------------ //
+bool Analyzer::BeginAnalysis(const CodeBlock& entryPoint,
+    const BlockRegistry* availableFunctions, const std::vector<VariableState>& callParameters)
+{
+    TraceScope trace("analysis", "BeginAnalysis");
+    trace.AddArg("entry", entryPoint.GetName());
+
+    std::list<AnalysisOperation> toCheck;
+    auto& entryAnalysis =
+        toCheck.emplace_back(entryPoint, availableFunctions, AlreadyQueuedOps);
+
+    if(!ResolveCallParameters(entryAnalysis, entryPoint, callParameters)) {
+        Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
+            "given parameters count mismatches analysis entrypoint parameter count",
+            entryPoint.GetLocation(), entryPoint.GetPosition()));
+        return false;
+    }
+
+    AlreadyQueuedOps.Add(&entryPoint, callParameters);
+    entryAnalysis.CallParameters = callParameters;
+    Statistics::Add(STAT_COUNTER::OperationsEnqueued);
+
+    EntryPointUsage = std::make_unique<BudgetTracker>(EntryPointBudget, Cancel);
+    Incomplete = false;
+    QueuedMemory = EstimateMemory(entryAnalysis, nullptr);
+
+    // Tells the callers which calls they can wait for
+    if(availableFunctions) {
+        Graph = std::make_unique<CallGraph>(availableFunctions->BuildCallGraph(entryPoint));
+    } else {
+        Graph.reset();
+    }
+
+    bool success = false;
+
+    try {
+        if(BottomUpSummaries && availableFunctions)
+            ComputeBottomUpSummaries(entryPoint, *availableFunctions);
+
+        success = Threads > 1 ? RunParallelAnalysis(toCheck) : RunSerialAnalysis(toCheck);
+    } catch(...) {
+        AlreadyQueuedOps.AbandonUnfinished(toCheck);
+        Graph.reset();
+        throw;
+    }
+
+    Graph.reset();
+
+    ReportIncompleteEntryPoint(entryPoint);
+    return success;
+}
+
+void Analyzer::ComputeBottomUpSummaries(
+    const CodeBlock& entryPoint, const BlockRegistry& availableFunctions)
+{
+    TraceScope trace("analysis", "ComputeBottomUpSummaries");
+
+    const auto& components = Graph->GetComponents();
+
+    // Each level only calls the levels before it
+    std::vector<std::vector<size_t>> levels;
+
+    for(size_t i = 0; i < components.size(); ++i) {
+        const auto level = Graph->GetLevel(i);
+
+        if(levels.size() <= level)
+            levels.resize(level + 1);
+
+        levels[level].push_back(i);
+    }
+
+    std::vector<OperationPool> pools;
+    pools.reserve(Threads);
+
+    for(unsigned i = 0; i < Threads; ++i)
+        pools.emplace_back(&availableFunctions, AlreadyQueuedOps);
+
+    const auto computeComponent = [&](size_t component, OperationPool& pool) {
+        for(const auto* function : components[component]) {
+            // The entry point is analysed with its own parameters. Other summaries depend on
+            // the values the callers pass, so only calls that pass nothing known can use
+            // these. Calls with known values are computed when they are found
+            if(function != &entryPoint) {
+                PrecomputeSummary(*function,
+                    std::vector<VariableState>(function->GetParameters().size()), pool);
+            }
         }
+    };
+
+    for(const auto& level : levels) {
+
+        if(EntryPointUsage->IsExhausted())
+            break;
+
+        const auto threadCount = std::min<size_t>(Threads, level.size());
+
+        if(threadCount <= 1) {
+            for(const auto component : level)
+                computeComponent(component, pools[0]);
+
+            continue;
+        }
+
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr exception;
+        std::mutex exceptionMutex;
+
+        // The workers use the variable names of the thread that started the analysis
+        auto& names = VariableNameTable::Get();
+
+        const auto worker = [&](unsigned id) {
+            const VariableNameTable::Scope nameScope(names);
+
+            for(auto i = next++; i < level.size() && !failed; i = next++) {
+                try {
+                    computeComponent(level[i], pools[id]);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(exceptionMutex);
+
+                    if(!exception)
+                        exception = std::current_exception();
+
+                    failed = true;
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        for(unsigned i = 1; i < threadCount; ++i)
+            threads.emplace_back(worker, i);
+
+        worker(0);
+
+        for(auto& thread : threads)
+            thread.join();
+
+        if(exception)
+            std::rethrow_exception(exception);
     }
 
-    return std::make_tuple(true, operation.FoundCalls);
+    if(trace.IsActive()) {
+        trace.AddArg("functions", std::to_string(Graph->GetFunctionCount()));
+        trace.AddArg("components", std::to_string(components.size()));
+    }
+}
+
+std::shared_ptr<const FunctionSummary> Analyzer::PrecomputeCall(
+    const AnalysisOperation& caller, const CodeBlock& function,
+    const std::vector<VariableState>& params)
+{
+    // Components are ordered callees first, so each nested call goes to an earlier
+    // component and this can't recurse forever
+    if(!Graph ||
+        Graph->GetComponent(&function) >= Graph->GetComponent(caller.CurrentFunction))
+        return nullptr;
+
+    return PrecomputeSummary(function, params, *caller.Pool);
+}
+
+std::shared_ptr<const FunctionSummary> Analyzer::PrecomputeSummary(
+    const CodeBlock& function, const std::vector<VariableState>& params, OperationPool& pool)
+{
+    // Only the limits are checked here. The operation is charged once a call claims the
+    // summary, as summaries that nothing uses don't take anything away from the entry point
+    if(!EntryPointUsage->Use(0, QueuedMemory))
+        return nullptr;
+
+    bool started = false;
+
+    if(auto existing = AlreadyQueuedOps.StartPrecomputed(&function, params, started);
+        !started)
+        return existing;
+
+    std::list<AnalysisOperation> operations;
+
+    auto& operation = pool.Acquire(operations, function);
+    operation.BottomUp = this;
+    operation.Graph = Graph.get();
+    operation.CallParameters = params;
+
+    std::shared_ptr<const FunctionSummary> result;
+    FunctionSummary summary;
+
+    try {
+        if(ResolveCallParameters(operation, function, params) &&
+            PerformToFixpoint(operation, summary)) {
+
+            for(auto& call : operation.FoundCalls) {
+                summary.Calls.emplace_back(
+                    call.CurrentFunction, std::move(call.CallParameters));
+            }
+
+            result = AlreadyQueuedOps.AddPrecomputed(&function, params, std::move(summary));
+            Statistics::Add(STAT_COUNTER::SummariesPrecomputed);
+        }
+    } catch(...) {
+        // The threads waiting for this would otherwise never wake up
+        AlreadyQueuedOps.AbandonPrecomputed(&function, params);
+        throw;
+    }
+
+    if(!result)
+        AlreadyQueuedOps.AbandonPrecomputed(&function, params);
+
+    pool.Release(operations, operations.begin());
+    return result;
+}
+
+void Analyzer::ReportIncompleteEntryPoint(const CodeBlock& entryPoint)
+{
+    if(!EntryPointUsage->IsExhausted())
+        return;
+
+    Incomplete = true;
+
+    Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Warning,
+        std::string("analysis incomplete: ") + Dump(EntryPointUsage->GetExhaustion()) +
+            ", the problems found so far are reported",
+        entryPoint.GetLocation(), entryPoint.GetPosition()));
+}
+// ------------------------------------ //
+bool Analyzer::RunSerialAnalysis(std::list<AnalysisOperation>& toCheck)
+{
+    OperationPool pool(toCheck.front().AvailableFunctions, AlreadyQueuedOps);
+    std::list<AnalysisOperation> woken;
+    bool failed = false;
+
+    while(!toCheck.empty()) {
+
+        auto& operation = toCheck.front();
+        operation.Pool = &pool;
+        operation.Graph = Graph.get();
+
+        QueuedMemory -= EstimateMemory(operation, nullptr);
+
+        // The problems found so far are kept, the rest of the queue is not analysed. An
+        // operation that waited for a summary was charged for its first run
+        if(!EntryPointUsage->Use(operation.Paused ? 0 : 1, QueuedMemory))
+            break;
+
+        FunctionSummary summary;
+        const auto success = PerformToFixpoint(operation, summary);
+
+        // The claimed summaries replace analysing those calls
+        EntryPointUsage->Use(operation.ClaimedSummaries, QueuedMemory);
+        operation.ClaimedSummaries = 0;
+
+        for(auto& problem : operation.CalleeProblems)
+            Problems.push_back(std::move(problem));
+
+        operation.CalleeProblems.clear();
+
+        if(!success) {
+            for(auto& problem : operation.Problems)
+                Problems.push_back(std::move(problem));
+
+            Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
+                "an analysis step failed", clang::SourceLocation{}));
+            failed = true;
+            break;
+        }
+
+        for(const auto& call : operation.FoundCalls)
+            QueuedMemory += EstimateMemory(call, nullptr);
+
+        toCheck.splice(toCheck.end(), operation.FoundCalls);
+
+        if(operation.Paused) {
+            if(!WaitForCallSummary(toCheck, toCheck.begin())) {
+                QueuedMemory += EstimateMemory(operation, nullptr);
+                toCheck.splice(toCheck.end(), toCheck, toCheck.begin());
+            }
+
+            continue;
+        }
+
+        for(auto& problem : operation.Problems)
+            Problems.push_back(std::move(problem));
+
+        AlreadyQueuedOps.AddSummary(
+            operation.CurrentFunction, operation.CallParameters, std::move(summary), woken);
+
+        toCheck.splice(toCheck.end(), woken);
+        pool.Release(toCheck, toCheck.begin());
+    }
+
+    for(auto& problem : TakeUnfinishedProblems(toCheck))
+        Problems.push_back(std::move(problem));
+
+    return !failed;
+}
+
+bool Analyzer::RunParallelAnalysis(std::list<AnalysisOperation>& entryAnalysis)
+{
+    std::vector<WorkStealingQueue<AnalysisOperation>> queues(Threads);
+    std::vector<std::vector<FoundProblem>> workerProblems(Threads);
+    std::vector<OperationPool> pools;
+    pools.reserve(Threads);
+
+    for(unsigned i = 0; i < Threads; ++i)
+        pools.emplace_back(entryAnalysis.front().AvailableFunctions, AlreadyQueuedOps);
+
+    // Counts queued and currently running operations, when this hits 0 all work is done
+    std::atomic<size_t> pending{1};
+    std::atomic<bool> failed{false};
+
+    // Exceptions (for example from decoding a malformed summary) are rethrown on the calling
+    // thread once all the workers have stopped
+    std::exception_ptr exception;
+    std::mutex exceptionMutex;
+
+    // Idle workers sleep until work is pushed, all work is done or a worker stops. They wake
+    // up periodically to check the time limit and cancellation
+    const auto idleCheckInterval = std::chrono::milliseconds(10);
+    std::mutex idleMutex;
+    std::condition_variable idleCondition;
+    std::atomic<size_t> workSignals{0};
+
+    const auto signalWork = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            ++workSignals;
+        }
+
+        idleCondition.notify_all();
+    };
+
+    queues[0].Push(entryAnalysis);
+
+    const auto takeWork = [&](unsigned id, std::list<AnalysisOperation>& target) {
+        if(queues[id].Pop(target))
+            return true;
+
+        for(unsigned i = 1; i < Threads; ++i) {
+            if(queues[(id + i) % Threads].Steal(target))
+                return true;
+        }
+
+        return false;
+    };
+
+    // The workers use the variable names of the thread that started the analysis
+    auto& names = VariableNameTable::Get();
+
+    const auto worker = [&](unsigned id) {
+        const VariableNameTable::Scope nameScope(names);
+
+        // Holds the operation being run
+        std::list<AnalysisOperation> current;
+        std::list<AnalysisOperation> woken;
+
+        // Once the budget is exhausted the queued work is abandoned
+        while(!failed && !EntryPointUsage->IsExhausted()) {
+
+            // Read before looking for work so that a push after that is never missed
+            const size_t seenSignals = workSignals;
+
+            if(!takeWork(id, current)) {
+                if(pending == 0 || !EntryPointUsage->Check())
+                    break;
+
+                std::unique_lock<std::mutex> lock(idleMutex);
+                idleCondition.wait_for(
+                    lock, idleCheckInterval, [&]() { return workSignals != seenSignals; });
+                continue;
+            }
+
+            auto& operation = current.front();
+            operation.Pool = &pools[id];
+            operation.Graph = Graph.get();
+
+            QueuedMemory -= EstimateMemory(operation, nullptr);
+
+            // Kept for reporting the problems a paused operation found so far
+            if(!EntryPointUsage->Use(operation.Paused ? 0 : 1, QueuedMemory)) {
+                queues[id].Push(current);
+                break;
+            }
+
+            bool success = false;
+            FunctionSummary summary;
+
+            try {
+                success = PerformToFixpoint(operation, summary);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+
+                if(!exception)
+                    exception = std::current_exception();
+
+                failed = true;
+                break;
+            }
+
+            // The claimed summaries replace analysing those calls
+            EntryPointUsage->Use(operation.ClaimedSummaries, QueuedMemory);
+            operation.ClaimedSummaries = 0;
+
+            for(auto& problem : operation.CalleeProblems)
+                workerProblems[id].push_back(std::move(problem));
+
+            operation.CalleeProblems.clear();
+
+            if(!success) {
+                for(auto& problem : operation.Problems)
+                    workerProblems[id].push_back(std::move(problem));
+
+                failed = true;
+                break;
+            }
+
+            // Must be increased before this operation is marked done to not let the other
+            // workers quit early
+            pending += operation.FoundCalls.size();
+
+            for(const auto& call : operation.FoundCalls)
+                QueuedMemory += EstimateMemory(call, nullptr);
+
+            const bool foundWork = !operation.FoundCalls.empty();
+            queues[id].Push(operation.FoundCalls);
+
+            // A waiting operation stays pending until it is woken up and finishes
+            if(operation.Paused) {
+                if(!WaitForCallSummary(current, current.begin())) {
+                    QueuedMemory += EstimateMemory(operation, nullptr);
+                    queues[id].Push(current);
+                    signalWork();
+                } else if(foundWork) {
+                    signalWork();
+                }
+
+                continue;
+            }
+
+            for(auto& problem : operation.Problems)
+                workerProblems[id].push_back(std::move(problem));
+
+            // The woken operations are already counted in pending
+            AlreadyQueuedOps.AddSummary(operation.CurrentFunction, operation.CallParameters,
+                std::move(summary), woken);
+
+            const bool wokeWork = !woken.empty();
+            queues[id].Push(woken);
+            pools[id].Release(current, current.begin());
+
+            if(--pending == 0 || foundWork || wokeWork)
+                signalWork();
+        }
+
+        // The other workers need to notice when this stopped because of a failure or the
+        // budget
+        signalWork();
+    };
+
+    std::vector<std::thread> threads;
+
+    for(unsigned i = 1; i < Threads; ++i)
+        threads.emplace_back(worker, i);
+
+    worker(0);
+
+    for(auto& thread : threads)
+        thread.join();
+
+    if(exception)
+        std::rethrow_exception(exception);
+
+    for(auto& queue : queues) {
+        while(queue.Pop(entryAnalysis)) {}
+    }
+
+    // The workers find the problems in a nondeterministic order so they are sorted here
+    auto merged = TakeUnfinishedProblems(entryAnalysis);
+
+    for(auto& problems : workerProblems) {
+        for(auto& problem : problems)
+            merged.push_back(std::move(problem));
+    }
+
+    const auto sortKey = [](const FoundProblem& problem) {
+        return std::make_tuple(problem.Position.File, problem.Position.Line,
+            problem.Position.Column, problem.Location.getRawEncoding(), problem.Severity,
+            problem.Message);
+    };
+
+    std::stable_sort(merged.begin(), merged.end(), [&](const auto& lhs, const auto& rhs) {
+        return sortKey(lhs) < sortKey(rhs);
+    });
+
+    for(auto& problem : merged)
+        Problems.push_back(std::move(problem));
+
+    if(failed) {
+        Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
+            "an analysis step failed", clang::SourceLocation{}));
+        return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+bool Analyzer::ResolveCallParameters(AnalysisOperation& operation, const CodeBlock& function,
+    const std::vector<VariableState>& callParameters)
+{
+    if(callParameters.size() != function.GetParameters().size()) {
+        return false;
+    }
+
+    for(size_t i = 0; i < callParameters.size(); ++i) {
+
+        const auto resolved = callParameters[i].Resolve(*operation.State);
+
+        operation.State->CreateLocal(function.GetParameters()[i], resolved);
+    }
+
+    return true;
+}
+// ------------------------------------ //
+bool Analyzer::PerformAnalysisOperation(AnalysisOperation& operation)
+{
+    TraceScope trace("operation", operation.CurrentFunction->GetName());
+
+    const auto& actions = operation.CurrentFunction->GetActions();
+    const auto& conditions = operation.CurrentFunction->GetCompiledConditions();
+
+    // When a condition can't be determined the operation is split into paths assuming each
+    // outcome. operation is the first path. All paths go through the actions in lockstep so
+    // that the paths that end up in the same state can be joined again
+    std::list<AnalysisOperation> paths;
+
+    CallContextLimit callContexts(MaxCallContexts);
+    operation.CallContexts = &callContexts;
+
+    BudgetTracker functionUsage(FunctionBudget, Cancel);
+    size_t firstAction = 0;
+
+    // A paused run continues after the call it stopped at with the effects of the call
+    // applied, which gives the same results as running straight through
+    if(const auto paused = std::move(operation.Paused); paused) {
+        paths.splice(paths.end(), paused->Paths);
+        callContexts = std::move(paused->CallContexts);
+        functionUsage.Use(paused->UsedOperations, 0);
+        firstAction = paused->NextAction;
+
+        operation.ApplyWaitedSummary();
+
+        for(auto& path : paths) {
+            path.Pool = operation.Pool;
+            path.Graph = operation.Graph;
+            path.CallContexts = &callContexts;
+            path.ApplyWaitedSummary();
+        }
+    }
+
+    for(size_t i = firstAction; i < actions.size(); ++i) {
+
+        // Each path runs the action so they all use the budget
+        const auto memory = EstimateMemory(operation, &paths);
+
+        if(!functionUsage.Use(paths.size() + 1, memory) ||
+            !EntryPointUsage->Use(0, QueuedMemory + memory)) {
+
+            Incomplete = true;
+
+            // The entry point reports its own exhaustion
+            if(functionUsage.IsExhausted()) {
+                operation.Problems.push_back(FoundProblem(FoundProblem::SEVERITY::Warning,
+                    "analysis of " + operation.CurrentFunction->GetName() +
+                        " incomplete: " + Dump(functionUsage.GetExhaustion()),
+                    operation.CurrentFunction->GetLocation(),
+                    operation.CurrentFunction->GetPosition()));
+            }
+
+            break;
+        }
+
+        // Every path runs an unconditional action so this is where branches converge
+        if(!paths.empty() && conditions[actions[i].If].IsAlwaysTrue())
+            JoinConvergedPaths(operation, paths);
+
+        RunAction(operation, i, paths);
+
+        // Paths split off here are also visited and run the action if their assumptions make
+        // its condition true
+        for(auto path = paths.begin(); path != paths.end(); ++path)
+            RunAction(*path, i, paths);
+
+        // The rest of the actions depend on the effects of a call that isn't done yet. The
+        // calls found so far are handed out to be analysed meanwhile
+        if(operation.WaitFunction ||
+            std::any_of(paths.begin(), paths.end(),
+                [](const AnalysisOperation& path) { return path.WaitFunction != nullptr; })) {
+
+            for(auto& path : paths)
+                operation.FoundCalls.splice(operation.FoundCalls.end(), path.FoundCalls);
+
+            operation.Paused = std::make_unique<PausedRun>(PausedRun{std::move(paths), i + 1,
+                std::move(callContexts), functionUsage.GetUsedOperations()});
+            operation.CallContexts = nullptr;
+            return true;
+        }
+    }
+
+    const auto pathCount = paths.size() + 1;
+    operation.CallContexts = nullptr;
+
+    // The results of all paths are reported together and only values that all paths agree
+    // on are kept for the summary
+    while(!paths.empty()) {
+        operation.Join(std::move(paths.front()));
+        operation.Pool->Release(paths, paths.begin());
+    }
+
+    if(trace.IsActive()) {
+        std::string params;
+        std::string enqueued;
+
+        for(const auto& param : operation.CallParameters)
+            params += (params.empty() ? "" : ", ") + param.Dump();
+
+        for(const auto& call : operation.FoundCalls)
+            enqueued += (enqueued.empty() ? "" : ", ") + call.CurrentFunction->GetName();
+
+        trace.AddArg("params", std::move(params));
+        trace.AddArg("actions", std::to_string(actions.size()));
+        trace.AddArg("paths", std::to_string(pathCount));
+        trace.AddArg("enqueued", std::move(enqueued));
+    }
+
+    Statistics::SetMax(
+        STAT_COUNTER::PeakProgramStateSize, operation.State->Variables.GetAllocatedSize());
+
+    return true;
+}
+
+bool Analyzer::PerformToFixpoint(AnalysisOperation& operation, FunctionSummary& summary)
+{
+    // The calls found in the earlier rounds are already queued so they are all kept
+    std::list<AnalysisOperation> foundCalls;
+    bool success = true;
+
+    for(;; ++operation.FixpointRound) {
+
+        success = PerformAnalysisOperation(operation);
+
+        // The round continues once the summaries it waits for are done
+        if(!success || operation.Paused)
+            break;
+
+        summary = operation.CreateSummary();
+
+        if(!operation.CallsItself)
+            break;
+
+        if(const auto& previous = operation.RecursionSummary; previous) {
+            summary.GlobalEffects = WidenEffects(previous->GlobalEffects,
+                summary.GlobalEffects, operation.FixpointRound > MaxFixpointRounds);
+
+            if(summary.GlobalEffects == previous->GlobalEffects)
+                break;
+        }
+
+        // Problems are reported from the last round, which has the effects of the recursion
+        operation.RecursionSummary = std::make_shared<const FunctionSummary>(summary);
+        operation.CallsItself = false;
+        operation.Problems.clear();
+        operation.Assumptions.Clear();
+        operation.WrittenGlobals.clear();
+        foundCalls.splice(foundCalls.end(), operation.FoundCalls);
+
+        if(operation.State.use_count() == 1) {
+            operation.State->Clear();
+        } else {
+            operation.State = std::make_shared<ProgramState>();
+        }
+
+        ResolveCallParameters(operation, *operation.CurrentFunction, operation.CallParameters);
+
+        Statistics::Add(STAT_COUNTER::FixpointRounds);
+    }
+
+    operation.FoundCalls.splice(operation.FoundCalls.begin(), foundCalls);
+    return success;
+}
+
+bool Analyzer::WaitForCallSummary(
+    std::list<AnalysisOperation>& list, std::list<AnalysisOperation>::iterator operation)
+{
+    // Added before the operation is handed over as it can be woken up right away
+    const auto memory = EstimateMemory(*operation, nullptr);
+    QueuedMemory += memory;
+
+    if(AlreadyQueuedOps.WaitForSummary(list, operation)) {
+        Statistics::Add(STAT_COUNTER::SummaryWaits);
+        return true;
+    }
+
+    QueuedMemory -= memory;
+    return false;
+}
+
+std::vector<FoundProblem> Analyzer::TakeUnfinishedProblems(
+    std::list<AnalysisOperation>& operations)
+{
+    AlreadyQueuedOps.AbandonUnfinished(operations);
+
+    std::vector<FoundProblem> problems;
+
+    for(auto& operation : operations) {
+        if(!operation.Paused)
+            continue;
+
+        auto& paths = operation.Paused->Paths;
+
+        while(!paths.empty()) {
+            operation.Join(std::move(paths.front()));
+            paths.pop_front();
+        }
+
+        for(auto& problem : operation.CalleeProblems)
+            problems.push_back(std::move(problem));
+
+        for(auto& problem : operation.Problems)
+            problems.push_back(std::move(problem));
+    }
+
+    operations.clear();
+    return problems;
+}
+
+std::vector<std::tuple<VariableIdentifier, VariableState>> Analyzer::WidenEffects(
+    const std::vector<std::tuple<VariableIdentifier, VariableState>>& previous,
+    const std::vector<std::tuple<VariableIdentifier, VariableState>>& next, bool giveUp)
+{
+    std::vector<std::tuple<VariableIdentifier, VariableState>> widened;
+
+    // Both lists are sorted by the variable. A variable written in only one of the rounds
+    // may keep the value it had before the call, so it is unknown
+    auto old = previous.begin();
+    auto current = next.begin();
+
+    while(old != previous.end() || current != next.end()) {
+        if(current == next.end() ||
+            (old != previous.end() && std::get<0>(*old).ID < std::get<0>(*current).ID)) {
+            widened.emplace_back(std::get<0>(*old), VariableState());
+            ++old;
+        } else if(old == previous.end() || std::get<0>(*current).ID < std::get<0>(*old).ID) {
+            widened.emplace_back(std::get<0>(*current), VariableState());
+            ++current;
+        } else {
+            widened.emplace_back(std::get<0>(*current),
+                giveUp ? VariableState() : std::get<1>(*old).Widen(std::get<1>(*current)));
+            ++old;
+            ++current;
+        }
+    }
+
+    return widened;
+}
+
+void Analyzer::RunAction(
+    AnalysisOperation& path, size_t actionIndex, std::list<AnalysisOperation>& paths)
+{
+    const ProcessedAction& action = path.CurrentFunction->GetActions()[actionIndex];
+
+    const auto& condition = path.CurrentFunction->GetCompiledConditions()[action.If];
+
+    auto matches = path.State->EvaluateCondition(condition, &path.Assumptions);
+    Statistics::Add(STAT_COUNTER::ConditionsEvaluated);
+
+    // Each split decides one more test so this repeats until the condition is known. Both
+    // outcomes of the test are recorded so that later conditions agree with them
+    while(matches == TRI_BOOL::Unknown && paths.size() + 1 < MaxPaths) {
+        const auto* test = condition.FindUnknownTest(*path.State, &path.Assumptions);
+
+        if(!test)
+            break;
+
+        SMACPP_LOG(Debug, Analysis,
+            "splitting on undetermined condition at step: "
+                << path.CurrentFunction->GetCondition(action).Dump() << " " << action.Dump());
+
+        path.Split(paths).Assume(*test, false);
+
+        path.Assume(*test, true);
+        matches = path.State->EvaluateCondition(condition, &path.Assumptions);
+
+        Statistics::Add(STAT_COUNTER::PathsSplit);
+    }
+
+    if(matches == TRI_BOOL::Unknown) {
+        SMACPP_LOG(Debug, Analysis,
+            "path limit reached, skipping step: "
+                << path.CurrentFunction->GetCondition(action).Dump() << " " << action.Dump());
+
+        Statistics::Add(STAT_COUNTER::PathLimitHits);
+    }
+
+    if(matches != TRI_BOOL::True)
+        return;
+
+    try {
+        SMACPP_LOG(Debug, Analysis,
+            "analysis at step: " << path.CurrentFunction->GetCondition(action).Dump() << " "
+                                 << action.Dump());
+
+        std::visit([&](const auto& data) { path.HandleAction(data, actionIndex); },
+            action.Value);
+
+    } catch(const UnknownVariableStateException& e) {
+        SMACPP_LOG(Debug, Analysis,
+            "Unknown variable state at step: " << action.Dump() << ": " << e.what());
+    }
+}
+
+size_t Analyzer::EstimateMemory(
+    const AnalysisOperation& operation, const std::list<AnalysisOperation>* paths) const
+{
+    if(EntryPointBudget.MaxMemory == 0 && FunctionBudget.MaxMemory == 0)
+        return 0;
+
+    size_t slots = operation.State->Variables.GetAllocatedSize();
+
+    if(paths) {
+        for(const auto& path : *paths)
+            slots += path.State->Variables.GetAllocatedSize();
+    }
+
+    if(operation.Paused) {
+        for(const auto& path : operation.Paused->Paths)
+            slots += path.State->Variables.GetAllocatedSize();
+    }
+
+    return slots * sizeof(VariableState);
+}
+
+void Analyzer::JoinConvergedPaths(
+    AnalysisOperation& operation, std::list<AnalysisOperation>& paths)
+{
+    for(auto path = paths.begin(); path != paths.end();) {
+
+        AnalysisOperation* same =
+            operation.State->HasSameValues(*path->State) ? &operation : nullptr;
+
+        for(auto other = paths.begin(); !same && other != path; ++other) {
+            if(other->State->HasSameValues(*path->State))
+                same = &*other;
+        }
+
+        if(!same) {
+            ++path;
+            continue;
+        }
+
+        same->Join(std::move(*path));
+
+        const auto joined = path++;
+        operation.Pool->Release(paths, joined);
+
+        Statistics::Add(STAT_COUNTER::PathsJoined);
+    }
 }
@@ -1,10 +1,18 @@
 #pragma once
 
+#include "AnalysisBudget.h"
+#include "CallGraph.h"
+#include "CopyOnWriteVector.h"
+#include "parse/CompiledCondition.h"
 #include "parse/ProcessedAction.h"
 
 #include <clang/Basic/SourceLocation.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -14,23 +22,79 @@ namespace smacpp {
 
 class CodeBlock;
 class BlockRegistry;
+class OperationPool;
+class AnalysisOperation;
+class Analyzer;
 
 struct FoundProblem {
     enum class SEVERITY { Info, Warning, Error };
 
     //! Basic message with no location info
-    FoundProblem(SEVERITY severity, const std::string& message, clang::SourceLocation loc);
+    FoundProblem(SEVERITY severity, const std::string& message, clang::SourceLocation loc,
+        const SourcePosition& position = SourcePosition{});
 
     std::string FormatAsString() const;
 
     clang::SourceLocation Location;
+    //! Used instead of Location when the problem is in code loaded from a summary file
+    SourcePosition Position;
     std::string Message;
     SEVERITY Severity;
 };
 
+//! Options for running the analysis
+struct AnalysisSettings {
+    //! Number of threads to process analysis operations with. 1 runs everything on the
+    //! calling thread
+    unsigned Threads = 1;
+
+    //! If not empty the found problems are stored in this file and reused on the next run
+    //! if none of the analysed functions have changed
+    std::string ResultCacheFile;
+
+    //! Identifies the analysed program in ResultCacheFile so that programs sharing a cache
+    //! don't replace each other's results
+    std::string ProgramName;
+
+    //! Most paths the analysis of a single function call is split into when conditions
+    //! can't be determined. Once reached, actions behind such conditions are skipped. 1
+    //! disables splitting
+    unsigned MaxPaths = 8;
+
+    //! Limits for analysing everything reachable from an entry point. When one runs out the
+    //! problems found so far are returned with an "analysis incomplete" warning
+    AnalysisBudget EntryPointBudget;
+
+    //! Limits for analysing a single function call. The rest of the function is skipped
+    //! when one runs out
+    AnalysisBudget FunctionBudget;
+
+    //! If set, setting this to true from another thread stops the analysis early like an
+    //! exhausted budget
+    const std::atomic<bool>* Cancel = nullptr;
+
+    //! Most different parameters one function call calls the same function with. The
+    //! parameters of the calls after that are widened so that the callee isn't analysed
+    //! separately for every value. 0 disables the limit
+    unsigned MaxCallContexts = 16;
+
+    //! Analyse each function once with unknown parameters, callees first, before the
+    //! analysis from the entry point. These summaries are then ready for all callers that
+    //! don't pass known values, which includes all calls to functions without parameters
+    bool BottomUpSummaries = true;
+};
+
 //! Program state in analysis
+//!
+//! Copying a ProgramState is cheap as the variable storage is shared until it is modified
 class ProgramState : public VariableValueProvider {
 public:
+    //! \brief Creates a copy of this state for following a separate execution path
+    std::shared_ptr<ProgramState> Fork() const
+    {
+        return std::make_shared<ProgramState>(*this);
+    }
+
     void CreateLocal(VariableIdentifier identifier, VariableState initialState);
     void Assign(VariableIdentifier identifier, VariableState state);
 
@@ -38,13 +102,83 @@ public:
     //! have the wrong value
     bool MatchesCondition(const Condition& condition) const;
 
+    //! \brief Evaluates a compiled condition with the current variable values
+    TRI_BOOL EvaluateCondition(const CompiledCondition& condition,
+        const TestAssumptions* assumptions = nullptr) const
+    {
+        return condition.Evaluate(*this, assumptions);
+    }
+
     VariableState GetVariableValue(const VariableIdentifier& variable) const override;
     VariableState GetVariableValueRaw(const VariableIdentifier& variable) const override;
 
-    std::unordered_map<VariableIdentifier, VariableState> Variables;
+    //! \returns True if all variables have the same (unresolved) values in both states
+    bool HasSameValues(const ProgramState& other) const;
+
+    //! \brief Makes the variables that have a different value in other unknown
+    void Join(const ProgramState& other);
+
+    //! \brief Makes all variables unknown, keeping the storage if it isn't shared
+    void Clear()
+    {
+        Variables.Clear();
+    }
+
+    //! Indexed by VariableIdentifier::ID. Variables that haven't been set are unknown
+    CopyOnWriteVector<VariableState> Variables;
+};
+
+//! Result of analysing a single function with specific (resolved) parameters
+struct FunctionSummary {
+    //! Problems found in the function itself. Problems in called functions are in their own
+    //! summaries
+    std::vector<FoundProblem> Problems;
+
+    //! Resolved values the global variables written on any path had when the function
+    //! ended, sorted by the variable. Unknown values are included as the callers need to
+    //! forget the earlier value
+    std::vector<std::tuple<VariableIdentifier, VariableState>> GlobalEffects;
+
+    //! Functions and resolved parameters the function called. Only kept for summaries
+    //! computed bottom-up, where the calls are analysed once the summary is used
+    std::vector<std::tuple<const CodeBlock*, std::vector<VariableState>>> Calls;
+};
+
+//! \brief Limits how many different parameters one operation calls each function with
+//!
+//! Instead of analysing a function separately for every value its callers pass, like each
+//! constant from the paths of a split caller, the calls after MaxContexts different
+//! parameters use parameters widened over the earlier ones. Those stop changing after a few
+//! calls so the rest of the calls find the same analysis.
+//! \note Shared by the paths of an operation, which run on the same thread in a fixed order
+//! so the same calls are widened on each run
+class CallContextLimit {
+public:
+    //! \param maxContexts 0 disables the limit
+    explicit CallContextLimit(unsigned maxContexts) : MaxContexts(maxContexts) {}
+
+    //! \brief Widens params if function has already been called with MaxContexts different
+    //! parameters
+    //! \returns True if params were widened
+    bool Limit(const CodeBlock* function, std::vector<VariableState>& params);
+
+private:
+    struct Contexts {
+        //! The different parameters used, up to MaxContexts
+        std::vector<std::vector<VariableState>> Used;
+
+        //! The parameters of the last widened call
+        std::vector<VariableState> Widened;
+        bool Full = false;
+    };
+
+    unsigned MaxContexts;
+    std::unordered_map<const CodeBlock*, Contexts> Functions;
 };
 
-//! Makes sure each codeblock is not analysed multiple times
+//! Makes sure each codeblock is not analysed multiple times with the same parameters and
+//! stores the summaries of the finished analyses
+//! \note This is thread safe
 class DoneAnalysisRegistry {
 public:
     bool HasBeenDone(const CodeBlock* func, const std::vector<VariableState>& params);
@@ -54,42 +188,261 @@ public:
     //! \returns True if the func call was not in the registry and was added
     bool CheckAndAdd(const CodeBlock* func, const std::vector<VariableState>& params);
 
+    //! \brief Stores the result of analysing a call that was added before
+    //! \param woken The operations that were waiting for the summary are moved here
+    void AddSummary(const CodeBlock* func, const std::vector<VariableState>& params,
+        FunctionSummary&& summary, std::list<AnalysisOperation>& woken);
+
+    //! \brief Moves a paused operation from list to wait until the summaries of the calls in
+    //! AnalysisOperation::WaitFunction of it and its paths are added
+    //! \returns False if the summaries are already done, operation is then left in list
+    bool WaitForSummary(
+        std::list<AnalysisOperation>& list, std::list<AnalysisOperation>::iterator operation);
+
+    //! \brief Forgets the calls that were added but whose summaries are not done
+    //!
+    //! Used at the end of an analysis as a budget running out can leave calls unfinished
+    //! \param waiting The operations still waiting for a summary are moved here
+    void AbandonUnfinished(std::list<AnalysisOperation>& waiting);
+
+    //! \returns The summary of a finished call or null if the call hasn't been added or its
+    //! analysis is not done yet
+    std::shared_ptr<const FunctionSummary> FindSummary(
+        const CodeBlock* func, const std::vector<VariableState>& params);
+
+    //! \brief Finds a precomputed summary or reserves computing it for the calling thread
+    //!
+    //! Waits while another thread is computing the same call so it is only computed once
+    //! \param started Set to true if the caller needs to compute the summary and then call
+    //! AddPrecomputed or AbandonPrecomputed
+    //! \returns The summary if it was already computed
+    std::shared_ptr<const FunctionSummary> StartPrecomputed(
+        const CodeBlock* func, const std::vector<VariableState>& params, bool& started);
+
+    //! \brief Stores a summary computed bottom-up before the call was found
+    //!
+    //! The summary is not used as a normal summary until ClaimPrecomputed takes it
+    //! \returns The stored summary
+    std::shared_ptr<const FunctionSummary> AddPrecomputed(const CodeBlock* func,
+        const std::vector<VariableState>& params, FunctionSummary&& summary);
+
+    //! \brief Releases a call reserved with StartPrecomputed that couldn't be computed
+    void AbandonPrecomputed(const CodeBlock* func, const std::vector<VariableState>& params);
+
+    //! \returns The precomputed summary for the call without claiming it
+    std::shared_ptr<const FunctionSummary> FindPrecomputed(
+        const CodeBlock* func, const std::vector<VariableState>& params);
+
+    //! \brief Turns a precomputed summary into the summary of a finished call
+    //! \returns The summary if this is the first claim and the call hasn't been added
+    //! otherwise. The caller must report the problems and analyse the calls of the summary
+    std::shared_ptr<const FunctionSummary> ClaimPrecomputed(
+        const CodeBlock* func, const std::vector<VariableState>& params);
+
+protected:
+    bool HasBeenDoneUnlocked(const CodeBlock* func, const std::vector<VariableState>& params);
+
+    //! \brief Adds operation to Waiters for the first call it waits for that isn't done
+    //! \returns False if all the calls are done
+    bool WaitUnlocked(std::list<AnalysisOperation>::iterator operation);
+
+    void AddUnlocked(const CodeBlock* func, const std::vector<VariableState>& params);
+
 protected:
-    std::unordered_map<std::string, std::unordered_set<std::vector<VariableState>>>
+    std::mutex Mutex;
+
+    //! Summaries are null while the call is queued for analysis
+    std::unordered_map<const CodeBlock*,
+        std::unordered_map<std::vector<VariableState>, std::shared_ptr<const FunctionSummary>>>
         RecordedFunctionCalls;
+
+    //! Summaries computed bottom-up that no call has used yet. Null while a thread is
+    //! computing the summary
+    std::unordered_map<const CodeBlock*,
+        std::unordered_map<std::vector<VariableState>, std::shared_ptr<const FunctionSummary>>>
+        PrecomputedCalls;
+
+    //! Notified when a precomputation started with StartPrecomputed ends
+    std::condition_variable PrecomputedDone;
+
+    //! Operations waiting for a summary, and where they are by the function they wait for
+    std::list<AnalysisOperation> WaitingOperations;
+    std::unordered_map<const CodeBlock*, std::vector<std::list<AnalysisOperation>::iterator>>
+        Waiters;
+};
+
+//! \brief The rest of an AnalysisOperation run that stopped to wait for a summary
+struct PausedRun {
+    //! The paths split from the operation, not joined yet
+    std::list<AnalysisOperation> Paths;
+
+    //! The action after the call the operation stopped at
+    size_t NextAction = 0;
+
+    CallContextLimit CallContexts;
+
+    //! How much of the function budget the run has used
+    size_t UsedOperations = 0;
 };
 
 //! A single operation the analysis is split into
 class AnalysisOperation {
 public:
-    AnalysisOperation(const std::vector<std::unique_ptr<ProcessedAction>>& actions,
-        const BlockRegistry* availableFunctions, std::vector<FoundProblem>& reportProblems,
+    AnalysisOperation(const CodeBlock& function, const BlockRegistry* availableFunctions,
         DoneAnalysisRegistry& doneOps) :
-        Actions(actions),
-        State(std::make_shared<ProgramState>()), AvailableFunctions(availableFunctions),
-        Problems(reportProblems), DoneOperations(doneOps)
+        State(std::make_shared<ProgramState>()),
+        CurrentFunction(&function), AvailableFunctions(availableFunctions),
+        DoneOperations(doneOps)
     {}
 
-    // Double dispatch
-    void HandleAction(const action::FunctionCall* call);
-    void HandleAction(const action::VarDeclared* var);
-    void HandleAction(const action::VarAssigned* var);
-    void HandleAction(const action::ArrayIndexAccess* index);
+    //! \brief Called with the action data of each action whose condition matches
+    //! \param actionIndex Index of the action in CurrentFunction
+    void HandleAction(const action::FunctionCall& call, size_t actionIndex);
+    void HandleAction(const action::VarDeclared& var, size_t actionIndex);
+    void HandleAction(const action::VarAssigned& var, size_t actionIndex);
+    void HandleAction(const action::ArrayIndexAccess& index, size_t actionIndex);
+
+    //! \brief Creates a summary from the current results, called once all actions are done
+    FunctionSummary CreateSummary() const;
+
+    //! \brief Creates a path that continues from the current state with different
+    //! assumptions. The results of the path need to be joined back to this with Join
+    //! \returns The path, which is added to the end of paths
+    AnalysisOperation& Split(std::list<AnalysisOperation>& paths) const;
+
+    //! \brief Merges the state and results of path (created with Split) into this
+    void Join(AnalysisOperation&& path);
+
+    //! \brief Assumes test has outcome and narrows the interval of the tested variable to
+    //! the values that give that outcome
+    void Assume(const CompiledCondition::Test& test, bool outcome);
+
+    //! \brief Applies the effects of the call in WaitFunction once its summary is done
+    void ApplyWaitedSummary();
+
+    //! \brief Resets this to not have any results or state, but keeps the allocated storage
+    //! so that OperationPool can reuse this
+    void Clear();
+
+private:
+    //! \returns True if function is in the same call graph component as this, so calls to it
+    //! can lead back here
+    bool IsRecursiveCall(const CodeBlock* function) const;
+
+    void ReportProblem(const std::string& message, size_t actionIndex,
+        FoundProblem::SEVERITY severity = FoundProblem::SEVERITY::Error);
+
+    void ApplyGlobalEffects(const FunctionSummary& summary);
 
-    //! Base action with no action
-    void HandleAction(const ProcessedAction* action) {}
+    //! \brief Makes the globals unknown, for calls whose effects are not known
+    void ForgetGlobals(const std::vector<size_t>& globals);
+
+    //! \brief Adds variable to WrittenGlobals if it is a global
+    void RecordWrite(const VariableIdentifier& variable);
+
+    //! \brief Reports the problems of a claimed precomputed summary and enqueues its calls,
+    //! claiming the precomputed summaries of them as well
+    void UsePrecomputed(std::shared_ptr<const FunctionSummary> summary);
 
 public:
-    const std::vector<std::unique_ptr<ProcessedAction>>& Actions;
     std::shared_ptr<ProgramState> State;
 
     std::list<AnalysisOperation> FoundCalls;
 
-    //! Used for recursion detection
+    //! The function whose actions this operation goes through
     const CodeBlock* CurrentFunction = nullptr;
+
+    //! Set by the Analyzer before this is run. Calls to earlier components wait for the
+    //! summary of the callee, calls within the component of CurrentFunction don't
+    const CallGraph* Graph = nullptr;
+
+    //! The resolved parameters this operation was started with, used to store the summary
+    std::vector<VariableState> CallParameters;
+
+    //! Outcomes this path has assumed for the tests that could not be determined
+    TestAssumptions Assumptions;
+
+    //! Sorted ids of the global variables this path has written, these are the effects in
+    //! the summary
+    std::vector<size_t> WrittenGlobals;
+
+    //! Set when a call back into this same function and parameters was found. Such a call
+    //! can't be analysed before this finishes, so this is run again until the summary
+    //! stops changing
+    bool CallsItself = false;
+
+    //! Summary from the previous round for the calls back into this
+    std::shared_ptr<const FunctionSummary> RecursionSummary;
+
+    //! The round PerformToFixpoint is on, kept while this waits for a summary
+    unsigned FixpointRound = 1;
+
+    //! \brief Call of this path whose summary isn't done but is needed to continue
+    //!
+    //! The operation pauses after the action that made the call and continues once the
+    //! summary is done, so the effects of all calls outside the component of this are
+    //! applied no matter in which order the operations run
+    const CodeBlock* WaitFunction = nullptr;
+    std::vector<VariableState> WaitParams;
+
+    //! Set while this waits for a summary. The entry point budget is only charged for the
+    //! first run
+    std::unique_ptr<PausedRun> Paused;
+
+    //! Set by the Analyzer while this (and the paths split from this) runs
+    CallContextLimit* CallContexts = nullptr;
+
+    //! Precomputed summaries this has claimed. Each one is charged to the entry point budget
+    //! like the operation it replaces
+    size_t ClaimedSummaries = 0;
+
+    //! Problems of the claimed precomputed summaries. These are kept separate from Problems
+    //! as they are not part of the summary of this
+    std::vector<FoundProblem> CalleeProblems;
+
+    //! Set to the analyzer computing the summary when this is run bottom-up. The found calls
+    //! are then only recorded for the summary instead of being analysed
+    Analyzer* BottomUp = nullptr;
+
     const BlockRegistry* AvailableFunctions = nullptr;
-    std::vector<FoundProblem>& Problems;
+
+    //! Problems found by this operation. These are local to make running operations in
+    //! parallel possible
+    std::vector<FoundProblem> Problems;
+    DoneAnalysisRegistry& DoneOperations;
+
+    //! Where the found calls and paths are taken from, set by the Analyzer before this is
+    //! run. Belongs to the thread running this
+    OperationPool* Pool = nullptr;
+};
+
+//! \brief Recycles finished AnalysisOperations so that their list nodes and state storage
+//! are reused by new operations
+//!
+//! Operations are only moved between lists with splice so once the pool has warmed up
+//! taking an operation from it doesn't allocate.
+//! \note Not thread safe, each analysis thread has its own pool. The operations can still be
+//! released to a different pool than they were taken from
+class OperationPool {
+public:
+    OperationPool(const BlockRegistry* availableFunctions, DoneAnalysisRegistry& doneOps) :
+        AvailableFunctions(availableFunctions), DoneOperations(doneOps)
+    {}
+
+    //! \brief Appends an empty operation for function to the end of list
+    AnalysisOperation& Acquire(std::list<AnalysisOperation>& list, const CodeBlock& function);
+
+    //! \brief Clears operation and moves it from list to the pool
+    void Release(
+        std::list<AnalysisOperation>& list, std::list<AnalysisOperation>::iterator operation);
+
+    void ReleaseAll(std::list<AnalysisOperation>& list);
+
+private:
+    const BlockRegistry* AvailableFunctions;
     DoneAnalysisRegistry& DoneOperations;
+
+    std::list<AnalysisOperation> Free;
 };
 
 //! Main class implementing the actual static analysis checks
@@ -105,22 +458,160 @@ public:
     bool BeginAnalysis(const CodeBlock& entryPoint, const BlockRegistry* availableFunctions,
         const std::vector<VariableState>& callParameters);
 
-    void SetDebug(bool debug)
+    //! \brief Sets the number of threads used by BeginAnalysis
+    void SetThreadCount(unsigned threads)
+    {
+        Threads = threads > 0 ? threads : 1;
+    }
+
+    //! \brief Sets AnalysisSettings::MaxPaths
+    void SetMaxPaths(unsigned paths)
     {
-        Debug = debug;
+        MaxPaths = paths > 0 ? paths : 1;
+    }
+
+    //! \brief Sets AnalysisSettings::MaxCallContexts
+    void SetMaxCallContexts(unsigned contexts)
+    {
+        MaxCallContexts = contexts;
+    }
+
+    //! \brief Sets AnalysisSettings::BottomUpSummaries
+    void SetBottomUpSummaries(bool enabled)
+    {
+        BottomUpSummaries = enabled;
+    }
+
+    //! \brief Sets the budgets and cancel flag from AnalysisSettings
+    void SetBudgets(const AnalysisBudget& entryPoint, const AnalysisBudget& function,
+        const std::atomic<bool>* cancel = nullptr)
+    {
+        EntryPointBudget = entryPoint;
+        FunctionBudget = function;
+        Cancel = cancel;
+    }
+
+    //! \returns False if a budget ran out or the analysis was cancelled during BeginAnalysis
+    bool IsComplete() const
+    {
+        return !Incomplete;
     }
 
     static bool ResolveCallParameters(AnalysisOperation& operation, const CodeBlock& function,
         const std::vector<VariableState>& callParameters);
 
+    //! \brief Computes the summary of a call found while computing the summary of caller
+    //! bottom-up
+    //! \returns The summary or null if function is not in a call graph component that is
+    //! done before the one of caller, as then the call could recurse
+    std::shared_ptr<const FunctionSummary> PrecomputeCall(const AnalysisOperation& caller,
+        const CodeBlock& function, const std::vector<VariableState>& params);
+
 private:
-    std::tuple<bool, std::list<AnalysisOperation>> PerformAnalysisOperation(
-        AnalysisOperation& operation);
+    //! \brief Runs all actions of operation, or continues them if it was paused. The calls to
+    //! analyse next are left in operation.FoundCalls
+    //!
+    //! Pauses after an action that made a call whose summary isn't done yet
+    //! \returns False if a fatal error was encountered
+    bool PerformAnalysisOperation(AnalysisOperation& operation);
+
+    //! \brief Runs operation with PerformAnalysisOperation, repeating it while its summary
+    //! changes if it calls itself
+    //!
+    //! The global effects of the rounds are widened so this ends after a few rounds, or at
+    //! the latest after MaxFixpointRounds when the effects are dropped.
+    //! \param summary Set to the summary of the last round. Not valid if the operation
+    //! paused to wait for a summary, which leaves AnalysisOperation::Paused set
+    //! \returns False if a fatal error was encountered
+    bool PerformToFixpoint(AnalysisOperation& operation, FunctionSummary& summary);
+
+    //! \brief Parks an operation that paused at calls whose summaries aren't done
+    //!
+    //! The operation is moved to AlreadyQueuedOps, which gives it back once the summaries
+    //! are added
+    //! \returns False if the summaries got done in the meantime, the operation is then left
+    //! in list and needs to be queued again
+    bool WaitForCallSummary(
+        std::list<AnalysisOperation>& list, std::list<AnalysisOperation>::iterator operation);
+
+    //! \brief Ends operations that were left when the analysis stopped, along with the ones
+    //! still waiting for a summary
+    //! \returns The problems the paused operations found before they stopped
+    std::vector<FoundProblem> TakeUnfinishedProblems(std::list<AnalysisOperation>& operations);
+
+    //! \brief Widens the effects of a round against the previous round
+    //! \param giveUp If true all the effects are made unknown to force the fixpoint
+    static std::vector<std::tuple<VariableIdentifier, VariableState>> WidenEffects(
+        const std::vector<std::tuple<VariableIdentifier, VariableState>>& previous,
+        const std::vector<std::tuple<VariableIdentifier, VariableState>>& next, bool giveUp);
+
+    //! \brief Runs a single action on path, splitting it into paths if the condition can't
+    //! be determined
+    void RunAction(
+        AnalysisOperation& path, size_t actionIndex, std::list<AnalysisOperation>& paths);
+
+    //! \brief Computes the summaries of the functions reachable from entryPoint for calls
+    //! with unknown parameters, which don't depend on the caller, callees first
+    //!
+    //! The call graph components on the same level are processed in parallel. The results
+    //! are stored as precomputed summaries in AlreadyQueuedOps
+    //! \exception Anything PerformAnalysisOperation throws
+    void ComputeBottomUpSummaries(
+        const CodeBlock& entryPoint, const BlockRegistry& availableFunctions);
+
+    //! \brief Analyses a call to function and stores the result as precomputed
+    //! \returns The summary or null if the budget ran out
+    std::shared_ptr<const FunctionSummary> PrecomputeSummary(const CodeBlock& function,
+        const std::vector<VariableState>& params, OperationPool& pool);
+
+    //! \brief Adds the "analysis incomplete" warning if the entry point budget ran out
+    void ReportIncompleteEntryPoint(const CodeBlock& entryPoint);
+
+    //! \returns The estimated bytes used by the states of operation and paths, 0 if there is
+    //! no memory limit to not waste time calculating this
+    size_t EstimateMemory(
+        const AnalysisOperation& operation, const std::list<AnalysisOperation>* paths) const;
+
+    //! \brief Joins paths that have reached the same state with an earlier path
+    static void JoinConvergedPaths(
+        AnalysisOperation& operation, std::list<AnalysisOperation>& paths);
+
+    //! \brief Processes the operations starting from entryAnalysis with multiple threads
+    //!
+    //! Each worker has its own queue that other workers steal from once they run out of
+    //! work. Found problems are buffered per worker and sorted when merged to keep the output
+    //! the same between runs
+    bool RunParallelAnalysis(std::list<AnalysisOperation>& entryAnalysis);
+
+    //! \brief Processes the operations in toCheck and the ones they find on this thread
+    bool RunSerialAnalysis(std::list<AnalysisOperation>& toCheck);
+
+public:
+    //! Rounds after which the effects of a function calling itself are given up on
+    static constexpr unsigned MaxFixpointRounds = 8;
 
 private:
     std::vector<FoundProblem>& Problems;
     DoneAnalysisRegistry AlreadyQueuedOps;
-    bool Debug = false;
+    unsigned Threads = 1;
+    unsigned MaxPaths = AnalysisSettings{}.MaxPaths;
+    unsigned MaxCallContexts = AnalysisSettings{}.MaxCallContexts;
+    bool BottomUpSummaries = AnalysisSettings{}.BottomUpSummaries;
+
+    AnalysisBudget EntryPointBudget;
+    AnalysisBudget FunctionBudget;
+    const std::atomic<bool>* Cancel = nullptr;
+
+    //! Created by BeginAnalysis
+    std::unique_ptr<BudgetTracker> EntryPointUsage;
+
+    //! Call graph of the entry point, only exists while BeginAnalysis runs
+    std::unique_ptr<CallGraph> Graph;
+
+    //! Estimated memory of the states of the queued operations
+    std::atomic<size_t> QueuedMemory{0};
+
+    std::atomic<bool> Incomplete{false};
 };
 
 } // namespace smacpp
@@ -1,8 +1,16 @@
 // ------------------------------------ //
 #include "BlockRegistry.h"
 
+#include "Statistics.h"
+#include "serialization/CodeBlockSerializer.h"
+#include "serialization/ResultCache.h"
+
 using namespace smacpp;
 // ------------------------------------ //
+BlockRegistry::BlockRegistry() = default;
+
+BlockRegistry::~BlockRegistry() = default;
+// ------------------------------------ //
 void BlockRegistry::AddBlock(CodeBlock&& block)
 {
     if(FunctionBlocks.find(block.GetName()) != FunctionBlocks.end()) {
@@ -12,51 +20,159 @@ void BlockRegistry::AddBlock(CodeBlock&& block)
 
     FunctionBlocks.insert_or_assign(block.GetName(), std::move(block));
 }
+
+void BlockRegistry::AddSummary(std::unique_ptr<MappedSummary> summary)
+{
+    std::lock_guard<std::mutex> lock(DecodedBlocksMutex);
+
+    // Only the names the new summary has are looked up again
+    for(auto iter = DecodedBlocks.begin(); iter != DecodedBlocks.end();) {
+        if(summary->FindBlock(iter->first)) {
+            ReplacedBlocks.push_back(std::move(iter->second));
+            iter = DecodedBlocks.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    Summaries.push_back(std::move(summary));
+}
 // ------------------------------------ //
-std::vector<FoundProblem> BlockRegistry::PerformAnalysis(bool debug) const
+std::vector<FoundProblem> BlockRegistry::PerformAnalysis(
+    const AnalysisSettings& settings, const PositionResolver& resolver) const
 {
-    std::vector<FoundProblem> problems;
+    PhaseTimer timer(STAT_PHASE::Analysis);
 
-    const auto mainIter = FunctionBlocks.find("main");
+    const auto* mainBlock = FindFunction("main");
 
-    if(mainIter != FunctionBlocks.end()) {
+    if(!mainBlock) {
+        // TODO: this should only be a warning / info if some other function that could be
+        // started from is found
+        return {FoundProblem(FoundProblem::SEVERITY::Error, "'main' function was not found",
+            clang::SourceLocation{})};
+    }
 
-        Analyzer analyzer(problems);
-        analyzer.SetDebug(debug);
+    bool complete = true;
 
-        std::vector<VariableState> params;
+    if(settings.ResultCacheFile.empty())
+        return AnalyzeEntryPoint(*mainBlock, settings, complete);
 
-        if(mainIter->second.GetParameters().size() == 2 ||
-            mainIter->second.GetParameters().size() == 3) {
+    AnalysisResultCache cache;
+    cache.Load(settings.ResultCacheFile);
 
-            // TODO: these could be more intelligently done
-            while(mainIter->second.GetParameters().size() != params.size()) {
-                params.push_back(VariableState{});
-            }
+    const auto key = AnalysisResultCache::MakeKey(settings.ProgramName, mainBlock->GetName());
+    const auto reachableHash = HashReachableBlocks(*this, *mainBlock, resolver);
+    const auto settingsHash = HashAnalysisSettings(settings);
+
+    if(const auto* cached = cache.Find(key, reachableHash, settingsHash); cached)
+        return *cached;
+
+    auto problems = AnalyzeEntryPoint(*mainBlock, settings, complete);
+
+    // Partial results depend on timing and the budgets so they are not reused
+    if(!complete)
+        return problems;
+
+    // Only the positions are stored in the cache
+    if(resolver) {
+        for(auto& problem : problems) {
+            if(!problem.Position.IsValid() && problem.Location.isValid())
+                problem.Position = resolver(problem.Location);
         }
+    }
 
-        if(!analyzer.BeginAnalysis(mainIter->second, this, params)) {
+    if(!cache.Update(settings.ResultCacheFile, key, reachableHash, settingsHash, problems)) {
+        problems.push_back(FoundProblem(FoundProblem::SEVERITY::Warning,
+            "failed to write result cache: " + settings.ResultCacheFile,
+            clang::SourceLocation{}));
+    }
+
+    return problems;
+}
+
+std::vector<FoundProblem> BlockRegistry::AnalyzeEntryPoint(
+    const CodeBlock& entryPoint, const AnalysisSettings& settings, bool& complete) const
+{
+    std::vector<FoundProblem> problems;
 
-            problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
-                "Analysis encountered a fatal error", mainIter->second.GetLocation()));
+    Analyzer analyzer(problems);
+    analyzer.SetThreadCount(settings.Threads);
+    analyzer.SetMaxPaths(settings.MaxPaths);
+    analyzer.SetMaxCallContexts(settings.MaxCallContexts);
+    analyzer.SetBottomUpSummaries(settings.BottomUpSummaries);
+    analyzer.SetBudgets(settings.EntryPointBudget, settings.FunctionBudget, settings.Cancel);
+
+    std::vector<VariableState> params;
+
+    if(entryPoint.GetParameters().size() == 2 || entryPoint.GetParameters().size() == 3) {
+
+        // TODO: these could be more intelligently done
+        while(entryPoint.GetParameters().size() != params.size()) {
+            params.push_back(VariableState{});
         }
+    }
+
+    if(!analyzer.BeginAnalysis(entryPoint, this, params)) {
 
-    } else {
-        // TODO: this should only be a warning / info if some other function that could be
-        // started from is found
         problems.push_back(FoundProblem(FoundProblem::SEVERITY::Error,
-            "'main' function was not found", clang::SourceLocation{}));
+            "Analysis encountered a fatal error", entryPoint.GetLocation(),
+            entryPoint.GetPosition()));
     }
 
+    complete = analyzer.IsComplete();
     return problems;
 }
 // ------------------------------------ //
+CallGraph BlockRegistry::BuildCallGraph(const CodeBlock& entryPoint) const
+{
+    // Not counted in the statistics as these aren't lookups by the analysis
+    return CallGraph(
+        entryPoint, [this](const std::string& name) { return LookupFunction(name); });
+}
+// ------------------------------------ //
 const CodeBlock* BlockRegistry::FindFunction(const std::string& name) const
+{
+    const auto* block = LookupFunction(name);
+
+    Statistics::Add(block ? STAT_COUNTER::RegistryHits : STAT_COUNTER::RegistryMisses);
+    return block;
+}
+
+const CodeBlock* BlockRegistry::LookupFunction(const std::string& name) const
 {
     const auto found = FunctionBlocks.find(name);
 
-    if(found == FunctionBlocks.end())
+    if(found != FunctionBlocks.end())
+        return &found->second;
+
+    if(Summaries.empty())
         return nullptr;
 
-    return &found->second;
+    DecodedBlock* decoded;
+
+    {
+        std::lock_guard<std::mutex> lock(DecodedBlocksMutex);
+
+        auto& entry = DecodedBlocks[name];
+
+        if(!entry)
+            entry = std::make_unique<DecodedBlock>();
+
+        decoded = entry.get();
+    }
+
+    // If this throws the next lookup tries again
+    std::call_once(decoded->Decoded, [&]() {
+        for(auto iter = Summaries.rbegin(); iter != Summaries.rend(); ++iter) {
+
+            const auto index = (*iter)->FindBlock(name);
+
+            if(index) {
+                decoded->Block = std::make_unique<CodeBlock>((*iter)->DecodeBlock(*index));
+                break;
+            }
+        }
+    });
+
+    return decoded->Block.get();
 }
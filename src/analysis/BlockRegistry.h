@@ -1,27 +1,113 @@
 #pragma once
 
 #include "Analyzer.h"
+#include "CallGraph.h"
 #include "parse/CodeBlock.h"
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 namespace smacpp {
 
+class MappedSummary;
+
 //! \brief Storage for all parsed CodeBlocks and running analysis on them
 class BlockRegistry {
 public:
+    BlockRegistry();
+    ~BlockRegistry();
+
     //! \brief Adds a block to this registry
+    //!
+    //! If the block is allocated from an arena it must be the one from GetArena
     void AddBlock(CodeBlock&& block);
 
+    //! \brief The arena for the blocks that are given to AddBlock
+    //!
+    //! All memory in it is released at once when this is destroyed instead of freeing each
+    //! action and condition separately
+    llvm::BumpPtrAllocator& GetArena()
+    {
+        return Arena;
+    }
+
+    //! \brief The table for the variables of the blocks in this registry
+    //!
+    //! Needs to be made current with VariableNameTable::Scope while blocks are built for
+    //! this and while this is used
+    VariableNameTable& GetNames()
+    {
+        return Names;
+    }
+
+    //! \brief Makes the blocks in a summary available without decoding them
+    //!
+    //! Each block is decoded into a CodeBlock the first time FindFunction looks it up, so
+    //! only the functions the analysis reaches are ever decoded. Blocks added with
+    //! AddBlock and later added summaries take precedence over the earlier summaries.
+    //! Blocks already returned by FindFunction stay valid even if summary replaces them
+    //! \note Must not be called while an analysis is running
+    void AddSummary(std::unique_ptr<MappedSummary> summary);
+
+    //! \note Safe to call concurrently from multiple analysis threads
+    //! \exception SerializationError if the block is in a summary that is malformed
     const CodeBlock* FindFunction(const std::string& name) const;
 
+    //! \returns The blocks that were added with AddBlock, doesn't include blocks from
+    //! summaries
+    const auto& GetBlocks() const
+    {
+        return FunctionBlocks;
+    }
+
+    //! \brief Builds the call graph of the functions reachable from entryPoint, including
+    //! the ones in summaries
+    CallGraph BuildCallGraph(const CodeBlock& entryPoint) const;
+
     //! \brief Performs the static analysis starting from "main" and other good candidate
     //! functions
-    std::vector<FoundProblem> PerformAnalysis(bool debug) const;
+    //! \param resolver Used to give the found problems positions that can be stored in
+    //! AnalysisSettings::ResultCacheFile
+    std::vector<FoundProblem> PerformAnalysis(
+        const AnalysisSettings& settings, const PositionResolver& resolver = nullptr) const;
+
+private:
+    //! \param complete Set to false if a budget ran out
+    std::vector<FoundProblem> AnalyzeEntryPoint(const CodeBlock& entryPoint,
+        const AnalysisSettings& settings, bool& complete) const;
+
+    //! \brief FindFunction without updating the statistics
+    const CodeBlock* LookupFunction(const std::string& name) const;
 
 private:
+    //! This needs to be first so that it is destroyed after all the blocks using it
+    llvm::BumpPtrAllocator Arena;
+
+    VariableNameTable Names;
+
     std::unordered_map<std::string, CodeBlock> FunctionBlocks;
+
+    std::vector<std::unique_ptr<MappedSummary>> Summaries;
+
+    //! \brief A block from Summaries, decoded by the first thread that looks it up while
+    //! the others wait for it
+    struct DecodedBlock {
+        std::once_flag Decoded;
+
+        //! Null if no summary has a block with the name
+        std::unique_ptr<CodeBlock> Block;
+    };
+
+    mutable std::unordered_map<std::string, std::unique_ptr<DecodedBlock>> DecodedBlocks;
+
+    //! Only protects the DecodedBlocks map, the decoding is done without holding this
+    mutable std::mutex DecodedBlocksMutex;
+
+    //! Decoded blocks that a later summary replaced. They are kept as earlier lookups can
+    //! still point to them
+    std::vector<std::unique_ptr<DecodedBlock>> ReplacedBlocks;
 };
 
 } // namespace smacpp
@@ -0,0 +1,196 @@
+// ------------------------------------ //
+#include "CallGraph.h"
+
+#include "parse/CodeBlock.h"
+#include "parse/Variable.h"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace smacpp;
+// ------------------------------------ //
+CallGraph::CallGraph(const CodeBlock& entryPoint, const FunctionLookup& lookup)
+{
+    Functions.push_back(&entryPoint);
+    FunctionIndices[&entryPoint] = 0;
+
+    const auto& names = VariableNameTable::Get();
+
+    // Functions are appended as they are found so this visits everything reachable
+    for(size_t i = 0; i < Functions.size(); ++i) {
+
+        std::vector<size_t> callees;
+        std::vector<size_t> written;
+
+        for(const auto& action : Functions[i]->GetActions()) {
+
+            const auto* call = std::get_if<action::FunctionCall>(&action.Value);
+
+            if(!call) {
+                const VariableIdentifier* variable = nullptr;
+
+                if(const auto* assigned = std::get_if<action::VarAssigned>(&action.Value)) {
+                    variable = &assigned->Variable;
+                } else if(const auto* declared =
+                              std::get_if<action::VarDeclared>(&action.Value)) {
+                    variable = &declared->Variable;
+                }
+
+                if(variable && names.IsGlobal(variable->ID))
+                    written.push_back(variable->ID);
+
+                continue;
+            }
+
+            const auto* callee = lookup(call->Function);
+
+            if(!callee)
+                continue;
+
+            const auto [found, added] = FunctionIndices.emplace(callee, Functions.size());
+
+            if(added)
+                Functions.push_back(callee);
+
+            callees.push_back(found->second);
+        }
+
+        std::sort(callees.begin(), callees.end());
+        callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+
+        SelfCalls.push_back(std::binary_search(callees.begin(), callees.end(), i));
+        Callees.push_back(std::move(callees));
+
+        std::sort(written.begin(), written.end());
+        written.erase(std::unique(written.begin(), written.end()), written.end());
+        WrittenGlobals.push_back(std::move(written));
+    }
+
+    FindComponents();
+}
+// ------------------------------------ //
+size_t CallGraph::GetComponent(const CodeBlock* function) const
+{
+    const auto found = FunctionIndices.find(function);
+
+    if(found == FunctionIndices.end())
+        return -1;
+
+    return FunctionComponents[found->second];
+}
+
+bool CallGraph::IsRecursive(const CodeBlock* function) const
+{
+    const auto found = FunctionIndices.find(function);
+
+    if(found == FunctionIndices.end())
+        return false;
+
+    return SelfCalls[found->second] ||
+           Components[FunctionComponents[found->second]].size() > 1;
+}
+// ------------------------------------ //
+void CallGraph::FindComponents()
+{
+    const size_t unvisited = -1;
+
+    std::vector<size_t> indices(Functions.size(), unvisited);
+    std::vector<size_t> lowLinks(Functions.size());
+    std::vector<bool> onStack(Functions.size());
+    std::vector<size_t> stack;
+    size_t nextIndex = 0;
+
+    // The functions being visited and the position of the next callee to visit in each
+    std::vector<std::tuple<size_t, size_t>> visiting;
+
+    FunctionComponents.assign(Functions.size(), unvisited);
+
+    const auto visit = [&](size_t function) {
+        indices[function] = lowLinks[function] = nextIndex++;
+        stack.push_back(function);
+        onStack[function] = true;
+        visiting.emplace_back(function, 0);
+    };
+
+    for(size_t root = 0; root < Functions.size(); ++root) {
+
+        if(indices[root] != unvisited)
+            continue;
+
+        visit(root);
+
+        while(!visiting.empty()) {
+
+            const auto function = std::get<0>(visiting.back());
+            auto& next = std::get<1>(visiting.back());
+
+            if(next < Callees[function].size()) {
+                const auto callee = Callees[function][next++];
+
+                if(indices[callee] == unvisited) {
+                    visit(callee);
+                } else if(onStack[callee]) {
+                    lowLinks[function] = std::min(lowLinks[function], indices[callee]);
+                }
+
+                continue;
+            }
+
+            visiting.pop_back();
+
+            if(!visiting.empty()) {
+                const auto caller = std::get<0>(visiting.back());
+                lowLinks[caller] = std::min(lowLinks[caller], lowLinks[function]);
+            }
+
+            if(lowLinks[function] != indices[function])
+                continue;
+
+            // function is the root of a component, which is everything above it on the stack.
+            // Components are completed callees first
+            std::vector<const CodeBlock*> component;
+            size_t member;
+
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+
+                FunctionComponents[member] = Components.size();
+                component.push_back(Functions[member]);
+            } while(member != function);
+
+            Components.push_back(std::move(component));
+        }
+    }
+
+    // The callee components are before the caller so their levels and writes are already
+    // known
+    Levels.assign(Components.size(), 0);
+    ComponentWrites.assign(Components.size(), {});
+
+    for(size_t component = 0; component < Components.size(); ++component) {
+        auto& writes = ComponentWrites[component];
+
+        for(const auto* member : Components[component]) {
+            const auto index = FunctionIndices[member];
+            writes.insert(
+                writes.end(), WrittenGlobals[index].begin(), WrittenGlobals[index].end());
+
+            for(const auto callee : Callees[index]) {
+                const auto calleeComponent = FunctionComponents[callee];
+
+                if(calleeComponent != component) {
+                    Levels[component] =
+                        std::max(Levels[component], Levels[calleeComponent] + 1);
+
+                    writes.insert(writes.end(), ComponentWrites[calleeComponent].begin(),
+                        ComponentWrites[calleeComponent].end());
+                }
+            }
+        }
+
+        std::sort(writes.begin(), writes.end());
+        writes.erase(std::unique(writes.begin(), writes.end()), writes.end());
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace smacpp {
+
+class CodeBlock;
+
+//! \brief The functions reachable from an entry point through the action::FunctionCall
+//! actions, condensed into strongly connected components
+//!
+//! Each component is either a single non-recursive function or a group of functions that
+//! (mutually) recurse. The components are ordered callees first, so analysing them in order
+//! has the summaries of all called functions outside the component ready.
+class CallGraph {
+public:
+    using FunctionLookup = std::function<const CodeBlock*(const std::string&)>;
+
+    //! \param lookup Finds the called functions by name, calls to functions it doesn't find
+    //! are not part of the graph
+    CallGraph(const CodeBlock& entryPoint, const FunctionLookup& lookup);
+
+    //! \returns The components in reverse topological order, callees before callers
+    const auto& GetComponents() const
+    {
+        return Components;
+    }
+
+    //! \returns The length of the longest call chain from the component to a component
+    //! that calls nothing outside itself. Components with the same level don't call each
+    //! other so they can be analysed at the same time
+    unsigned GetLevel(size_t component) const
+    {
+        return Levels[component];
+    }
+
+    //! \returns The index of the component function belongs to or -1 if the function is
+    //! not reachable from the entry point
+    size_t GetComponent(const CodeBlock* function) const;
+
+    //! \returns True if function can call itself, directly or through other functions
+    bool IsRecursive(const CodeBlock* function) const;
+
+    //! \returns The sorted ids of the global variables the functions of the component, or
+    //! the functions they call, assign or declare
+    const std::vector<size_t>& GetWrittenGlobals(size_t component) const
+    {
+        return ComponentWrites[component];
+    }
+
+    size_t GetFunctionCount() const
+    {
+        return Functions.size();
+    }
+
+private:
+    //! \brief Finds the components with Tarjan's algorithm
+    //!
+    //! This doesn't recurse so deep call chains can't overflow the stack
+    void FindComponents();
+
+private:
+    std::vector<const CodeBlock*> Functions;
+    std::unordered_map<const CodeBlock*, size_t> FunctionIndices;
+
+    //! Indices of the called functions, duplicates removed
+    std::vector<std::vector<size_t>> Callees;
+
+    std::vector<std::vector<const CodeBlock*>> Components;
+    std::vector<unsigned> Levels;
+
+    //! Component of each function, same indices as Functions
+    std::vector<size_t> FunctionComponents;
+
+    //! Set for functions that call themselves directly
+    std::vector<bool> SelfCalls;
+
+    //! Globals written directly by each function, same indices as Functions
+    std::vector<std::vector<size_t>> WrittenGlobals;
+
+    //! Globals written by each component and everything it calls
+    std::vector<std::vector<size_t>> ComponentWrites;
+};
+
+} // namespace smacpp
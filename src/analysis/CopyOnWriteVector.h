@@ -0,0 +1,287 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace smacpp {
+
+//! \brief Sparse vector that shares its storage between copies
+//!
+//! Values are stored in fixed size chunks which are the leaves of a tree with Fanout
+//! children per node. Copying only copies a pointer to the root and a write copies the
+//! nodes on the path to the modified chunk (and the chunk) if they are shared with another
+//! vector. So the first write after a fork costs O(log(size)) instead of copying a table of
+//! all the chunks, at the price of reads going through a few more pointers. Chunks that
+//! were never written to aren't allocated and read as default constructed values.
+template<class T, size_t ChunkSize = 16, size_t Fanout = 16>
+class CopyOnWriteVector {
+    using Chunk = std::array<T, ChunkSize>;
+
+    //! \brief Common base of the node types, nodes at height 1 are Leaves and higher ones
+    //! Interiors
+    struct Node {};
+
+    struct Interior : Node {
+        std::array<std::shared_ptr<Node>, Fanout> Children;
+    };
+
+    struct Leaf : Node {
+        std::array<std::shared_ptr<Chunk>, Fanout> Chunks;
+    };
+
+public:
+    //! \returns The value at index or nullptr if nothing has been set in that area
+    const T* TryGet(size_t index) const
+    {
+        const auto chunkIndex = index / ChunkSize;
+
+        if(!Root || chunkIndex >= GetChunkCapacity())
+            return nullptr;
+
+        const Node* node = Root.get();
+
+        for(auto height = Height; height > 1; --height) {
+            node = AsInterior(*node).Children[GetChildIndex(chunkIndex, height)].get();
+
+            if(!node)
+                return nullptr;
+        }
+
+        const auto& chunk = AsLeaf(*node).Chunks[chunkIndex % Fanout];
+
+        if(!chunk)
+            return nullptr;
+
+        return &(*chunk)[index % ChunkSize];
+    }
+
+    void Set(size_t index, T value)
+    {
+        const auto chunkIndex = index / ChunkSize;
+
+        if(!Root)
+            Height = 1;
+
+        MakeUniqueNode(Root, Height);
+
+        // Grows from the top so the existing nodes keep their place (and stay shared)
+        while(chunkIndex >= GetChunkCapacity()) {
+            auto newRoot = std::make_shared<Interior>();
+            newRoot->Children[0] = std::move(Root);
+            Root = std::move(newRoot);
+            ++Height;
+        }
+
+        Node* node = Root.get();
+
+        for(auto height = Height; height > 1; --height) {
+            auto& child = AsInterior(*node).Children[GetChildIndex(chunkIndex, height)];
+            MakeUniqueNode(child, height - 1);
+            node = child.get();
+        }
+
+        auto& chunk = AsLeaf(*node).Chunks[chunkIndex % Fanout];
+        MakeUnique<Chunk>(chunk);
+
+        (*chunk)[index % ChunkSize] = std::move(value);
+    }
+
+    //! \brief Makes all values default constructed again
+    //!
+    //! Nodes and chunks that are not shared with another vector are kept allocated for
+    //! reuse
+    void Clear()
+    {
+        if(!Root)
+            return;
+
+        if(Root.use_count() != 1) {
+            Root.reset();
+            Height = 0;
+            return;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        ClearNode(*Root, Height);
+    }
+
+    //! \brief Calls func(index, value) on each value in the allocated chunks, in index
+    //! order
+    template<class Func>
+    void ForEach(Func func) const
+    {
+        if(Root)
+            ForEachInNode(*Root, Height, 0, func);
+    }
+
+    //! \returns The number of values in the allocated chunks
+    size_t GetAllocatedSize() const
+    {
+        if(!Root)
+            return 0;
+
+        return CountChunks(*Root, Height) * ChunkSize;
+    }
+
+    //! \returns True if other uses the exact same storage, which means they are equal
+    bool SharesStorage(const CopyOnWriteVector& other) const
+    {
+        return Root == other.Root;
+    }
+
+private:
+    //! \returns How many chunks fit in the tree with its current height
+    size_t GetChunkCapacity() const
+    {
+        size_t capacity = 1;
+
+        for(unsigned i = 0; i < Height; ++i)
+            capacity *= Fanout;
+
+        return capacity;
+    }
+
+    //! \returns The child of a node at height to go to for chunkIndex
+    static size_t GetChildIndex(size_t chunkIndex, unsigned height)
+    {
+        for(unsigned i = 1; i < height; ++i)
+            chunkIndex /= Fanout;
+
+        return chunkIndex % Fanout;
+    }
+
+    static void ClearNode(Node& node, unsigned height)
+    {
+        if(height == 1) {
+            for(auto& chunk : AsLeaf(node).Chunks) {
+                if(!chunk)
+                    continue;
+
+                if(chunk.use_count() != 1) {
+                    chunk.reset();
+                } else {
+                    chunk->fill(T{});
+                }
+            }
+
+            return;
+        }
+
+        for(auto& child : AsInterior(node).Children) {
+            if(!child)
+                continue;
+
+            if(child.use_count() != 1) {
+                child.reset();
+            } else {
+                ClearNode(*child, height - 1);
+            }
+        }
+    }
+
+    template<class Func>
+    static void ForEachInNode(const Node& node, unsigned height, size_t firstChunk, Func& func)
+    {
+        if(height == 1) {
+            for(size_t i = 0; i < Fanout; ++i) {
+                const auto& chunk = AsLeaf(node).Chunks[i];
+
+                if(!chunk)
+                    continue;
+
+                for(size_t value = 0; value < ChunkSize; ++value)
+                    func((firstChunk + i) * ChunkSize + value, (*chunk)[value]);
+            }
+
+            return;
+        }
+
+        size_t childChunks = 1;
+
+        for(unsigned i = 1; i < height; ++i)
+            childChunks *= Fanout;
+
+        const auto& children = AsInterior(node).Children;
+
+        for(size_t i = 0; i < Fanout; ++i) {
+            if(children[i])
+                ForEachInNode(*children[i], height - 1, firstChunk + i * childChunks, func);
+        }
+    }
+
+    static size_t CountChunks(const Node& node, unsigned height)
+    {
+        size_t chunks = 0;
+
+        if(height == 1) {
+            for(const auto& chunk : AsLeaf(node).Chunks) {
+                if(chunk)
+                    ++chunks;
+            }
+
+            return chunks;
+        }
+
+        for(const auto& child : AsInterior(node).Children) {
+            if(child)
+                chunks += CountChunks(*child, height - 1);
+        }
+
+        return chunks;
+    }
+
+    static const Interior& AsInterior(const Node& node)
+    {
+        return static_cast<const Interior&>(node);
+    }
+
+    static Interior& AsInterior(Node& node)
+    {
+        return static_cast<Interior&>(node);
+    }
+
+    static const Leaf& AsLeaf(const Node& node)
+    {
+        return static_cast<const Leaf&>(node);
+    }
+
+    static Leaf& AsLeaf(Node& node)
+    {
+        return static_cast<Leaf&>(node);
+    }
+
+    //! \brief MakeUnique with the node type that is used at height
+    static void MakeUniqueNode(std::shared_ptr<Node>& ptr, unsigned height)
+    {
+        if(height == 1) {
+            MakeUnique<Leaf>(ptr);
+        } else {
+            MakeUnique<Interior>(ptr);
+        }
+    }
+
+    //! \brief Copies the pointed to object if it is shared (or creates it if null)
+    //! \tparam Actual The type of the object ptr points to
+    template<class Actual, class PointedT>
+    static void MakeUnique(std::shared_ptr<PointedT>& ptr)
+    {
+        if(!ptr) {
+            ptr = std::make_shared<Actual>();
+        } else if(ptr.use_count() != 1) {
+            ptr = std::make_shared<Actual>(static_cast<const Actual&>(*ptr));
+        } else {
+            // Make sure all reads by the other (now released) owners are done before this
+            // thread starts writing
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+    }
+
+private:
+    std::shared_ptr<Node> Root;
+
+    //! Levels of nodes in the tree, 0 when empty
+    unsigned Height = 0;
+};
+
+} // namespace smacpp
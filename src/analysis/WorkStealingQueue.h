@@ -0,0 +1,55 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+
+namespace smacpp {
+
+//! \brief Per worker queue for the parallel analysis
+//!
+//! The owning worker pushes and pops from the back (so it keeps working on the most recently
+//! found, cache warm, operations) and other workers steal from the front
+template<class T>
+class WorkStealingQueue {
+public:
+    //! \brief Moves all of items to the back of the queue
+    void Push(std::list<T>& items)
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Items.splice(Items.end(), items);
+    }
+
+    //! \brief Moves the last item to the end of target
+    //! \returns False if there was nothing to take
+    bool Pop(std::list<T>& target)
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+
+        if(Items.empty())
+            return false;
+
+        target.splice(target.end(), Items, std::prev(Items.end()));
+        return true;
+    }
+
+    //! \brief Moves the first item to the end of target
+    //! \returns False if there was nothing to take
+    bool Steal(std::list<T>& target)
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+
+        if(Items.empty())
+            return false;
+
+        target.splice(target.end(), Items, Items.begin());
+        return true;
+    }
+
+private:
+    std::mutex Mutex;
+
+    //! Items are spliced in and out so queueing doesn't allocate or move them
+    std::list<T> Items;
+};
+
+} // namespace smacpp
@@ -0,0 +1,495 @@
+// ------------------------------------ //
+#include "AnalysisServer.h"
+
+#include "Logging.h"
+#include "parse/ClangFrontendAction.h"
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Tooling/ArgumentsAdjusters.h"
+#include "clang/Tooling/Tooling.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/VirtualFileSystem.h"
+
+#include <boost/asio.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+using namespace smacpp;
+
+namespace asio = boost::asio;
+using Protocol = asio::local::stream_protocol;
+// ------------------------------------ //
+namespace {
+
+//! Seconds before the analysis started that files need to have been last modified for the
+//! result to be cached
+constexpr int RACY_FILE_SECONDS = 2;
+
+//! \brief Sends message to the server and reads the reply until the server closes the
+//! connection
+std::optional<std::string> Exchange(const std::string& socketPath, const std::string& message)
+{
+    asio::io_context io;
+    Protocol::socket socket(io);
+
+    boost::system::error_code error;
+    socket.connect(Protocol::endpoint(socketPath), error);
+
+    if(error)
+        return {};
+
+    asio::write(socket, asio::buffer(message), error);
+
+    if(error)
+        return {};
+
+    std::string reply;
+    asio::read(socket, asio::dynamic_buffer(reply), error);
+
+    if(error && error != asio::error::eof)
+        return {};
+
+    return reply;
+}
+
+bool IsSendable(const std::string& line)
+{
+    // Lines are the message framing so they can't be sent
+    return !line.empty() && line.find('\n') == std::string::npos;
+}
+
+std::string FormatResponse(const ServerResponse& response)
+{
+    std::string reply;
+
+    for(const auto& line : response.Output)
+        reply += line + "\n";
+
+    return reply + "exit " + std::to_string(response.ExitCode) + "\n";
+}
+
+//! \brief Reads one request from a client and writes the response
+//!
+//! Reading the request and writing the response both have a deadline, when it passes the
+//! socket is closed which fails the pending operation. The handlers run on a strand so the
+//! deadline can't close the socket while another handler is using it
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(AnalysisServer& server, Protocol::socket socket, asio::io_context& io) :
+        Server(server), Io(io), Strand(asio::make_strand(io)), Socket(std::move(socket)),
+        Deadline(io)
+    {}
+
+    void Start()
+    {
+        StartDeadline();
+
+        asio::async_read_until(Socket, Buffer, "\n\n",
+            asio::bind_executor(Strand,
+                [self = shared_from_this()](const boost::system::error_code& error, size_t) {
+                    self->OnRequest(error);
+                }));
+    }
+
+private:
+    void StartDeadline()
+    {
+        Deadline.expires_after(std::chrono::milliseconds(Server.GetSettings().ClientTimeout));
+
+        Deadline.async_wait(asio::bind_executor(
+            Strand, [self = shared_from_this()](const boost::system::error_code& error) {
+                // The expiry is checked as the deadline could have been moved after this
+                // was already queued
+                if(error == asio::error::operation_aborted ||
+                    self->Deadline.expiry() > asio::steady_timer::clock_type::now())
+                    return;
+
+                SMACPP_LOG(Info, Analysis, "closing a client connection that timed out");
+
+                boost::system::error_code ignored;
+                self->Socket.close(ignored);
+            }));
+    }
+
+    void OnRequest(const boost::system::error_code& error)
+    {
+        // Analysing can take longer than the client is allowed to stall
+        Deadline.cancel();
+
+        if(error)
+            return;
+
+        std::istream stream(&Buffer);
+
+        std::string command;
+        std::getline(stream, command);
+
+        ServerResponse response;
+
+        if(command == "analyse") {
+            ServerRequest request;
+            std::getline(stream, request.Directory);
+
+            std::string line;
+
+            while(std::getline(stream, line) && !line.empty())
+                request.Arguments.push_back(line);
+
+            response = Server.HandleRequest(request);
+        } else if(command == "ping") {
+            // Only used to check that a server is running
+        } else if(command == "shutdown") {
+            SMACPP_LOG(Info, Analysis, "server shutdown requested");
+            Io.stop();
+        } else {
+            response.ExitCode = 2;
+            response.Output.push_back("smacpp: unknown server command: " + command);
+        }
+
+        Reply = FormatResponse(response);
+        StartDeadline();
+
+        asio::async_write(Socket, asio::buffer(Reply),
+            asio::bind_executor(Strand,
+                [self = shared_from_this()](const boost::system::error_code&, size_t) {
+                    self->Deadline.cancel();
+                }));
+    }
+
+private:
+    AnalysisServer& Server;
+    asio::io_context& Io;
+    asio::strand<asio::io_context::executor_type> Strand;
+    Protocol::socket Socket;
+    asio::steady_timer Deadline;
+    asio::streambuf Buffer;
+    std::string Reply;
+};
+
+//! \brief Removes path if it is a Unix socket
+//! \returns False if path exists but is something else, which must not be deleted
+bool RemoveSocket(const std::string& path)
+{
+    struct stat status;
+
+    if(lstat(path.c_str(), &status) != 0)
+        return errno == ENOENT;
+
+    if(!S_ISSOCK(status.st_mode))
+        return false;
+
+    // llvm::sys::fs::remove refuses to remove sockets
+    return unlink(path.c_str()) == 0 || errno == ENOENT;
+}
+
+void Accept(AnalysisServer& server, Protocol::acceptor& acceptor, asio::io_context& io)
+{
+    acceptor.async_accept([&server, &acceptor, &io](const boost::system::error_code& error,
+                              Protocol::socket socket) {
+        if(error)
+            return;
+
+        // Accept the next connection first so that other io threads can serve it while this
+        // one is analysing
+        Accept(server, acceptor, io);
+        std::make_shared<Connection>(server, std::move(socket), io)->Start();
+    });
+}
+
+} // namespace
+// ------------------------------------ //
+void AnalysisServer::Run()
+{
+    // A leftover socket from a crashed server would make binding fail, but a live server
+    // must not be replaced
+    if(Exchange(Settings.SocketPath, "ping\n\n"))
+        throw std::runtime_error("a server is already listening on " + Settings.SocketPath);
+
+    if(!RemoveSocket(Settings.SocketPath)) {
+        throw std::runtime_error(
+            Settings.SocketPath + " already exists and is not a socket, not replacing it");
+    }
+
+    asio::io_context io;
+
+    Protocol::acceptor acceptor(io);
+    boost::system::error_code error;
+
+    acceptor.open(Protocol(), error);
+
+    if(!error)
+        acceptor.bind(Protocol::endpoint(Settings.SocketPath), error);
+
+    if(!error)
+        acceptor.listen(asio::socket_base::max_listen_connections, error);
+
+    if(error) {
+        throw std::runtime_error(
+            "failed to listen on " + Settings.SocketPath + ": " + error.message());
+    }
+
+    asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([&io](const boost::system::error_code&, int) { io.stop(); });
+
+    Accept(*this, acceptor, io);
+
+    SMACPP_LOG(Info, Analysis, "server listening on " << Settings.SocketPath);
+
+    // Each io thread serves one connection at a time
+    std::vector<std::thread> threads;
+
+    for(unsigned i = 1; i < std::max(1u, std::thread::hardware_concurrency()); ++i)
+        threads.emplace_back([&io]() { io.run(); });
+
+    io.run();
+
+    for(auto& thread : threads)
+        thread.join();
+
+    acceptor.close(error);
+    RemoveSocket(Settings.SocketPath);
+}
+// ------------------------------------ //
+ServerResponse AnalysisServer::HandleRequest(const ServerRequest& request)
+{
+    if(request.Directory.empty() || request.Arguments.empty()) {
+        ServerResponse response;
+        response.ExitCode = 2;
+        response.Output.push_back("smacpp: empty analysis request");
+        return response;
+    }
+
+    std::string key = request.Directory;
+
+    for(const auto& argument : request.Arguments)
+        key += '\n' + argument;
+
+    {
+        std::lock_guard<std::mutex> lock(CacheMutex);
+
+        const auto found = Cache.find(key);
+
+        if(found != Cache.end() && IsUpToDate(found->second.Dependencies)) {
+            SMACPP_LOG(Debug, Analysis, "reusing cached result for " << key);
+
+            CacheOrder.splice(CacheOrder.begin(), CacheOrder, found->second.Order);
+            return found->second.Response;
+        }
+    }
+
+    std::optional<std::vector<FileStamp>> dependencies;
+    auto response = Analyse(request, dependencies);
+
+    // Failures are not cached as they are often caused by something outside the TU, like
+    // a missing generated header
+    if(response.ExitCode != 2 && dependencies) {
+        std::lock_guard<std::mutex> lock(CacheMutex);
+        StoreResult(key, std::move(*dependencies), response);
+    }
+
+    return response;
+}
+
+void AnalysisServer::StoreResult(
+    const std::string& key, std::vector<FileStamp>&& dependencies, ServerResponse response)
+{
+    const auto found = Cache.find(key);
+
+    if(found != Cache.end()) {
+        found->second.Dependencies = std::move(dependencies);
+        found->second.Response = std::move(response);
+        CacheOrder.splice(CacheOrder.begin(), CacheOrder, found->second.Order);
+        return;
+    }
+
+    CacheOrder.push_front(key);
+    Cache.emplace(
+        key, CachedResult{std::move(dependencies), std::move(response), CacheOrder.begin()});
+
+    while(Cache.size() > std::max<size_t>(Settings.MaxCachedResults, 1)) {
+        Cache.erase(CacheOrder.back());
+        CacheOrder.pop_back();
+    }
+}
+
+ServerResponse AnalysisServer::Analyse(
+    const ServerRequest& request, std::optional<std::vector<FileStamp>>& dependencies)
+{
+    ServerResponse response;
+
+    // Files modified this close to the start may have changed without their modification
+    // time changing (on file systems with coarse timestamps), so their results are not
+    // cached. Same as git does with racily clean files
+    const auto modifiedBefore =
+        std::chrono::system_clock::now() - std::chrono::seconds(RACY_FILE_SECONDS);
+
+    // Each request gets a new FileManager so that changed files are read again
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> fileSystem(
+        llvm::vfs::createPhysicalFileSystem().release());
+
+    if(fileSystem->setCurrentWorkingDirectory(request.Directory)) {
+        response.ExitCode = 2;
+        response.Output.push_back("smacpp: invalid working directory: " + request.Directory);
+        return response;
+    }
+
+    llvm::IntrusiveRefCntPtr<clang::FileManager> files(
+        new clang::FileManager(clang::FileSystemOptions(), fileSystem));
+
+    clang::tooling::CommandLineArguments commandLine = request.Arguments;
+    commandLine.insert(
+        commandLine.end(), Settings.ExtraArguments.begin(), Settings.ExtraArguments.end());
+
+    // Same adjustments as ClangTool does, only parsing is needed
+    const auto adjuster = clang::tooling::combineAdjusters(
+        clang::tooling::combineAdjusters(clang::tooling::getClangSyntaxOnlyAdjuster(),
+            clang::tooling::getClangStripOutputAdjuster()),
+        clang::tooling::getClangStripDependencyFileAdjuster());
+
+    std::vector<FoundProblem> problems;
+
+    clang::tooling::ToolInvocation invocation(adjuster(commandLine, ""),
+        std::make_unique<FrontendAction>(Settings.Analysis,
+            [&problems](std::vector<FoundProblem>&& found) { problems = std::move(found); }),
+        files.get());
+
+    clang::IgnoringDiagConsumer ignoreDiagnostics;
+    invocation.setDiagnosticConsumer(&ignoreDiagnostics);
+
+    bool success = false;
+
+    try {
+        success = invocation.run();
+    } catch(const std::runtime_error& e) {
+        response.Output.push_back(std::string("smacpp: analysis failed: ") + e.what());
+    }
+
+    if(!success) {
+        response.ExitCode = 2;
+        return response;
+    }
+
+    for(const auto& problem : problems) {
+        if(problem.Severity == FoundProblem::SEVERITY::Error)
+            response.ExitCode = 1;
+
+        response.Output.push_back(problem.FormatAsString());
+    }
+
+    llvm::SmallVector<const clang::FileEntry*, 64> entries;
+    files->GetUniqueIDMapping(entries);
+
+    std::vector<FileStamp> stamps;
+
+    for(const auto* entry : entries) {
+        if(!entry)
+            continue;
+
+        llvm::SmallString<256> path(entry->tryGetRealPathName());
+
+        if(path.empty()) {
+            path = entry->getName();
+            fileSystem->makeAbsolute(path);
+        }
+
+        // clang's stamp is from when the file was opened, if the file doesn't match it
+        // anymore it was changed during the analysis
+        llvm::sys::fs::file_status status;
+
+        if(llvm::sys::fs::status(path, status) ||
+            llvm::sys::toTimeT(status.getLastModificationTime()) !=
+                entry->getModificationTime() ||
+            status.getSize() != static_cast<uint64_t>(entry->getSize()) ||
+            status.getLastModificationTime() > modifiedBefore) {
+            SMACPP_LOG(
+                Debug, Analysis, "not caching result, " << path << " was just modified");
+            return response;
+        }
+
+        stamps.push_back(
+            FileStamp{path.str().str(), status.getLastModificationTime(), status.getSize()});
+    }
+
+    dependencies = std::move(stamps);
+    return response;
+}
+
+bool AnalysisServer::IsUpToDate(const std::vector<FileStamp>& dependencies)
+{
+    // Newly created files that would shadow an included header are not noticed here
+    for(const auto& dependency : dependencies) {
+        llvm::sys::fs::file_status status;
+
+        if(llvm::sys::fs::status(dependency.Path, status))
+            return false;
+
+        if(status.getLastModificationTime() != dependency.ModificationTime ||
+            status.getSize() != dependency.Size)
+            return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+std::optional<ServerResponse> smacpp::SendServerRequest(
+    const std::string& socketPath, const ServerRequest& request)
+{
+    if(!IsSendable(request.Directory))
+        return {};
+
+    std::string message = "analyse\n" + request.Directory + "\n";
+
+    for(const auto& argument : request.Arguments) {
+        if(!IsSendable(argument))
+            return {};
+
+        message += argument + "\n";
+    }
+
+    const auto reply = Exchange(socketPath, message + "\n");
+
+    if(!reply)
+        return {};
+
+    ServerResponse response;
+    size_t start = 0;
+
+    while(start < reply->size()) {
+        auto end = reply->find('\n', start);
+
+        if(end == std::string::npos)
+            end = reply->size();
+
+        const auto line = reply->substr(start, end - start);
+        start = end + 1;
+
+        if(line.find("exit ") == 0) {
+            response.ExitCode = std::atoi(line.c_str() + std::strlen("exit "));
+            return response;
+        }
+
+        response.Output.push_back(line);
+    }
+
+    // The connection was closed before the end of the response
+    return {};
+}
+
+bool smacpp::SendServerShutdown(const std::string& socketPath)
+{
+    return Exchange(socketPath, "shutdown\n\n").has_value();
+}
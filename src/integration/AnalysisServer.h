@@ -0,0 +1,123 @@
+#pragma once
+
+#include "analysis/Analyzer.h"
+
+#include "llvm/Support/Chrono.h"
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace smacpp {
+
+//! \brief A single compile command to analyse
+//!
+//! On the socket a request is the command ("analyse", "ping" or "shutdown"), the working
+//! directory and then each argument on its own line. An empty line ends the request.
+struct ServerRequest {
+    std::string Directory;
+    //! The full compiler command line starting with the compiler (clang or clang++)
+    std::vector<std::string> Arguments;
+};
+
+//! \brief Result of a request
+//!
+//! On the socket these are the output lines followed by "exit <code>"
+struct ServerResponse {
+    //! Found problems formatted like clang diagnostics
+    std::vector<std::string> Output;
+    //! 1 if errors were found, 2 if the command couldn't be parsed
+    int ExitCode = 0;
+};
+
+struct ServerSettings {
+    std::string SocketPath;
+
+    //! Added to the end of every compile command, for example -resource-dir
+    std::vector<std::string> ExtraArguments;
+
+    //! The least recently used results are dropped when there are more than this many
+    size_t MaxCachedResults = 1024;
+
+    //! Milliseconds a client has to send its request and to read the response. After that
+    //! the connection is closed so a stalled client doesn't keep an io thread
+    unsigned ClientTimeout = 30000;
+
+    AnalysisSettings Analysis;
+};
+
+//! \brief Keeps smacpp loaded and answers analysis requests over a Unix socket
+//!
+//! Results are cached per command line and reused without parsing as long as none of the
+//! files the TU read have changed, which makes repeated checks of the same files from
+//! editors and commit hooks fast. The cache keeps at most ServerSettings::MaxCachedResults
+//! results, dropping the least recently used.
+class AnalysisServer {
+    struct FileStamp {
+        std::string Path;
+        //! Full resolution, clang only keeps whole seconds
+        llvm::sys::TimePoint<> ModificationTime;
+        uint64_t Size;
+    };
+
+    struct CachedResult {
+        std::vector<FileStamp> Dependencies;
+        ServerResponse Response;
+        //! Position in CacheOrder
+        std::list<std::string>::iterator Order;
+    };
+
+public:
+    AnalysisServer(const ServerSettings& settings) : Settings(settings) {}
+
+    //! \brief Serves requests until a shutdown request or SIGINT / SIGTERM is received
+    //! \exception std::runtime_error if the socket can't be listened on
+    void Run();
+
+    //! \brief Parses and analyses request, or returns the cached result
+    //!
+    //! Can be called from multiple threads at once
+    ServerResponse HandleRequest(const ServerRequest& request);
+
+    const ServerSettings& GetSettings() const
+    {
+        return Settings;
+    }
+
+private:
+    //! \param dependencies Set to the files the TU read, left empty if the result can't be
+    //! cached
+    ServerResponse Analyse(const ServerRequest& request,
+        std::optional<std::vector<FileStamp>>& dependencies);
+
+    static bool IsUpToDate(const std::vector<FileStamp>& dependencies);
+
+    //! \brief Adds or replaces the result of key and drops the least recently used results
+    //! over the limit. CacheMutex must be locked
+    void StoreResult(const std::string& key, std::vector<FileStamp>&& dependencies,
+        ServerResponse response);
+
+private:
+    const ServerSettings Settings;
+
+    std::mutex CacheMutex;
+    std::unordered_map<std::string, CachedResult> Cache;
+
+    //! Keys of Cache, most recently used first
+    std::list<std::string> CacheOrder;
+};
+
+//! \brief Sends request to the server listening on socketPath
+//! \returns The response or nothing if there is no server or it didn't answer properly
+std::optional<ServerResponse> SendServerRequest(
+    const std::string& socketPath, const ServerRequest& request);
+
+//! \brief Asks the server listening on socketPath to stop
+//! \returns False if there was no server
+bool SendServerShutdown(const std::string& socketPath);
+
+} // namespace smacpp
@@ -1,6 +1,8 @@
 // ------------------------------------ //
 #include "SMACPPChecker.h"
 
+#include "Logging.h"
+
 using namespace smacpp;
 using namespace clang;
 using namespace clang::ento;
@@ -50,20 +52,28 @@ void SMACPPChecker::checkBind(
     SymbolRef var = location.getAsSymbol();
     SymbolRef source = val.getAsSymbol();
 
-    llvm::outs() << "assigning: ";
+    if(!SMACPP_LOG_ENABLED(Debug, Checker))
+        return;
+
+    std::string message;
+    llvm::raw_string_ostream stream(message);
+
+    stream << "assigning: ";
     if(var)
-        var->dumpToStream(llvm::outs());
+        var->dumpToStream(stream);
     else
-        llvm::outs() << "unknown var: ";
+        stream << "unknown var: ";
 
-    llvm::outs() << " value: ";
+    stream << " value: ";
     if(source)
-        source->dumpToStream(llvm::outs());
+        source->dumpToStream(stream);
     else {
-        llvm::outs() << " statement: ";
-        S->dump(llvm::outs());
+        stream << " statement: ";
+        S->dump(stream);
     }
 
+    SMACPP_LOG(Debug, Checker, stream.str());
+
 
     // ProgramStateRef State = C.getState();
     // State = State->set<VariableToPointedMemoryMap>(var, MemoryAreaStats(0));
@@ -0,0 +1,186 @@
+// Whole program analysis driver. Loads the summary files written by the clang plugin
+// (-smacpp-emit-summary) into a single BlockRegistry and analyses them without reparsing
+// any source code
+
+#include "Logging.h"
+#include "Statistics.h"
+#include "Trace.h"
+#include "analysis/BlockRegistry.h"
+#include "serialization/CodeBlockSerializer.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+{
+    po::options_description options("smacpp-link options");
+    // clang-format off
+    options.add_options()
+        ("help,h", "print this help")
+        ("threads,j", po::value<unsigned>()->default_value(1),
+            "analysis threads, 0 for all cores")
+        ("max-paths",
+            po::value<unsigned>()->default_value(smacpp::AnalysisSettings{}.MaxPaths),
+            "paths each call is split into at most when conditions can't be determined")
+        ("max-call-contexts",
+            po::value<unsigned>()->default_value(smacpp::AnalysisSettings{}.MaxCallContexts),
+            "different parameters a call calls each function with before they are widened, "
+            "0 is unlimited")
+        ("no-bottom-up",
+            "don't summarise the functions for unknown parameters before the entry point")
+        ("time-limit", po::value<unsigned>()->default_value(0),
+            "milliseconds after which the problems found so far are reported, 0 is unlimited")
+        ("max-operations", po::value<size_t>()->default_value(0),
+            "function calls analysed at most, 0 is unlimited")
+        ("max-memory", po::value<size_t>()->default_value(0),
+            "MiB the program states can use at most, 0 is unlimited")
+        ("function-time-limit", po::value<unsigned>()->default_value(0),
+            "milliseconds after which the rest of a function call is skipped")
+        ("debug", "enable analysis debug printing")
+        ("log", po::value<std::string>(),
+            "enable debug printing for comma separated categories: parse, analysis, "
+            "serialization, checker or all")
+        ("stats", "print phase times and analysis counters")
+        ("stats-json", po::value<std::string>(), "write the statistics as JSON to this file")
+        ("trace", po::value<std::string>(),
+            "write a timeline of the analysis as Chrome trace event JSON to this file")
+        ("cache", po::value<std::string>(),
+            "reuse the results stored in this file if the analysed code has not changed")
+        ("input", po::value<std::vector<std::string>>(), "summary files to analyse");
+    // clang-format on
+
+    po::positional_options_description positional;
+    positional.add("input", -1);
+
+    po::variables_map arguments;
+
+    try {
+        po::store(po::command_line_parser(argc, argv)
+                      .options(options)
+                      .positional(positional)
+                      .run(),
+            arguments);
+        po::notify(arguments);
+    } catch(const po::error& e) {
+        std::cerr << "smacpp-link: " << e.what() << "\n" << options;
+        return 2;
+    }
+
+    if(arguments.count("help") || !arguments.count("input")) {
+        std::cout << "Usage: smacpp-link [options] file.smacpp...\n" << options;
+        return arguments.count("help") ? 0 : 2;
+    }
+
+    if(arguments.count("debug"))
+        smacpp::Logger::SetLevel(smacpp::LOG_LEVEL::Debug);
+
+    if(arguments.count("log") &&
+        !smacpp::Logger::EnableDebugCategories(arguments["log"].as<std::string>())) {
+        std::cerr << "smacpp-link: unknown log category\n";
+        return 2;
+    }
+
+    smacpp::AnalysisSettings settings;
+    settings.Threads = arguments["threads"].as<unsigned>();
+    settings.MaxPaths = arguments["max-paths"].as<unsigned>();
+    settings.MaxCallContexts = arguments["max-call-contexts"].as<unsigned>();
+    settings.BottomUpSummaries = arguments.count("no-bottom-up") == 0;
+    settings.EntryPointBudget.TimeLimit = arguments["time-limit"].as<unsigned>();
+    settings.EntryPointBudget.MaxOperations = arguments["max-operations"].as<size_t>();
+    settings.EntryPointBudget.MaxMemory = arguments["max-memory"].as<size_t>() << 20;
+    settings.FunctionBudget.TimeLimit = arguments["function-time-limit"].as<unsigned>();
+
+    if(arguments.count("cache")) {
+        settings.ResultCacheFile = arguments["cache"].as<std::string>();
+
+        // The linked summaries make up the program
+        auto inputs = arguments["input"].as<std::vector<std::string>>();
+        std::sort(inputs.begin(), inputs.end());
+
+        for(const auto& input : inputs)
+            settings.ProgramName += (settings.ProgramName.empty() ? "" : ";") + input;
+    }
+
+    if(settings.Threads == 0)
+        settings.Threads = std::max(1u, std::thread::hardware_concurrency());
+
+    smacpp::Statistics::Enable(arguments.count("stats") || arguments.count("stats-json"));
+    smacpp::Trace::Enable(arguments.count("trace") > 0);
+
+    smacpp::BlockRegistry registry;
+    const smacpp::VariableNameTable::Scope names(registry.GetNames());
+
+    {
+        smacpp::PhaseTimer timer(smacpp::STAT_PHASE::SummaryLoading);
+
+        // The summaries are only mapped here, functions are decoded when the analysis reaches
+        // them
+        for(const auto& input : arguments["input"].as<std::vector<std::string>>()) {
+            try {
+                registry.AddSummary(smacpp::MappedSummary::OpenFile(input));
+            } catch(const smacpp::SerializationError& e) {
+                std::cerr << "smacpp-link: invalid summary file " << input << ": " << e.what()
+                          << "\n";
+                return 2;
+            }
+        }
+    }
+
+    std::vector<smacpp::FoundProblem> problems;
+
+    try {
+        problems = registry.PerformAnalysis(settings);
+    } catch(const smacpp::SerializationError& e) {
+        std::cerr << "smacpp-link: invalid summary data: " << e.what() << "\n";
+        return 2;
+    }
+
+    bool errors = false;
+
+    {
+        smacpp::PhaseTimer timer(smacpp::STAT_PHASE::Diagnostics);
+
+        for(const auto& problem : problems) {
+
+            if(problem.Severity == smacpp::FoundProblem::SEVERITY::Error)
+                errors = true;
+
+            std::cout << problem.FormatAsString() << "\n";
+        }
+    }
+
+    if(arguments.count("stats"))
+        smacpp::Statistics::Print(llvm::errs());
+
+    if(arguments.count("stats-json")) {
+        const auto& path = arguments["stats-json"].as<std::string>();
+
+        std::error_code error;
+        llvm::raw_fd_ostream file(path, error);
+
+        if(error) {
+            std::cerr << "smacpp-link: failed to write statistics file: " << path << "\n";
+            return 2;
+        }
+
+        smacpp::Statistics::PrintJSON(file);
+    }
+
+    if(arguments.count("trace")) {
+        const auto& path = arguments["trace"].as<std::string>();
+
+        if(!smacpp::Trace::WriteFile(path)) {
+            std::cerr << "smacpp-link: failed to write trace file: " << path << "\n";
+            return 2;
+        }
+    }
+
+    return errors ? 1 : 0;
+}
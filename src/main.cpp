@@ -1,22 +1,315 @@
 // Forwards program invocation to clang or clang++ with the extra needed flags to load the
-// smacpp plugin
+// smacpp plugin. With --batch as the first argument all files in a compile_commands.json
+// are instead analysed in this process. With --server this stays running and analyses
+// the commands sent by other smacpp invocations that have SMACPP_SERVER set
 
 // Only for posix systems
 #include <unistd.h>
 
+#include "Logging.h"
+#include "Statistics.h"
+#include "Trace.h"
+#include "integration/AnalysisServer.h"
 #include "integration/SMACPPFinder.h"
+#include "parse/BatchAnalysis.h"
 
+#include "clang/Driver/Driver.h"
+
+#include <boost/filesystem.hpp>
 #include <boost/process/search_path.hpp>
+#include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+
+namespace po = boost::program_options;
+
+namespace {
+
+//! \returns Arguments for finding the builtin headers (stddef.h etc.) of the installed clang
+//! when parsing in this process
+std::vector<std::string> ResourceDirArguments()
+{
+    const auto clangPath = boost::process::search_path("clang").string();
+
+    if(clangPath.empty())
+        return {};
+
+    return {"-resource-dir=" + clang::driver::Driver::GetResourcesPath(clangPath)};
+}
+
+//! \returns True if arg is flag, either alone or with its value after an equals sign
+bool IsModeFlag(const char* arg, const char* flag)
+{
+    const auto length = std::strlen(flag);
+    return std::strncmp(arg, flag, length) == 0 && (arg[length] == '\0' || arg[length] == '=');
+}
+
+int RunBatch(int argc, char* argv[])
+{
+    po::options_description options("smacpp --batch options");
+    // clang-format off
+    options.add_options()
+        ("help,h", "print this help")
+        ("batch", po::value<std::string>()->required(),
+            "build folder containing compile_commands.json, or the path to the file")
+        ("threads,j", po::value<unsigned>()->default_value(0),
+            "files to analyse at the same time, 0 for all cores")
+        ("output,o", po::value<std::string>(), "write the report to this file")
+        ("extra-arg", po::value<std::vector<std::string>>(),
+            "argument to add to every compile command")
+        ("time-limit", po::value<unsigned>()->default_value(0),
+            "milliseconds after which the analysis of a file reports the problems found so "
+            "far, 0 is unlimited")
+        ("function-time-limit", po::value<unsigned>()->default_value(0),
+            "milliseconds after which the rest of a function call is skipped")
+        ("log", po::value<std::string>(),
+            "enable debug printing for comma separated categories: parse, analysis, "
+            "serialization, checker or all")
+        ("stats", "print phase times and analysis counters of all files")
+        ("trace", po::value<std::string>(),
+            "write a timeline of the analysis as Chrome trace event JSON to this file")
+        ("filter", po::value<std::vector<std::string>>(),
+            "only analyse files with a path containing one of these");
+    // clang-format on
+
+    po::positional_options_description positional;
+    positional.add("filter", -1);
+
+    po::variables_map arguments;
+
+    try {
+        po::store(po::command_line_parser(argc, argv)
+                      .options(options)
+                      .positional(positional)
+                      .run(),
+            arguments);
+
+        if(arguments.count("help")) {
+            std::cout << "Usage: smacpp --batch build-folder [options] [filter...]\n"
+                      << options;
+            return 0;
+        }
+
+        po::notify(arguments);
+    } catch(const po::error& e) {
+        std::cerr << "smacpp: " << e.what() << "\n" << options;
+        return 2;
+    }
+
+    if(arguments.count("log") &&
+        !smacpp::Logger::EnableDebugCategories(arguments["log"].as<std::string>())) {
+        std::cerr << "smacpp: unknown log category\n";
+        return 2;
+    }
+
+    smacpp::BatchSettings settings;
+    settings.CompilationDatabase = arguments["batch"].as<std::string>();
+    settings.Threads = arguments["threads"].as<unsigned>();
 
+    if(settings.Threads == 0)
+        settings.Threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if(arguments.count("filter"))
+        settings.Filters = arguments["filter"].as<std::vector<std::string>>();
+
+    settings.ExtraArguments = ResourceDirArguments();
+
+    if(arguments.count("extra-arg")) {
+        for(const auto& arg : arguments["extra-arg"].as<std::vector<std::string>>())
+            settings.ExtraArguments.push_back(arg);
+    }
+
+    settings.Analysis.EntryPointBudget.TimeLimit = arguments["time-limit"].as<unsigned>();
+    settings.Analysis.FunctionBudget.TimeLimit =
+        arguments["function-time-limit"].as<unsigned>();
+
+    smacpp::Statistics::Enable(arguments.count("stats") > 0);
+    smacpp::Trace::Enable(arguments.count("trace") > 0);
+
+    smacpp::BatchResult result;
+
+    try {
+        result = smacpp::RunBatchAnalysis(settings);
+    } catch(const std::runtime_error& e) {
+        std::cerr << "smacpp: " << e.what() << "\n";
+        return 2;
+    }
+
+    std::ofstream file;
+
+    if(arguments.count("output")) {
+        file.open(arguments["output"].as<std::string>());
+
+        if(!file.good()) {
+            std::cerr << "smacpp: failed to open " << arguments["output"].as<std::string>()
+                      << "\n";
+            return 2;
+        }
+    }
+
+    std::ostream& report = file.is_open() ? file : std::cout;
+    bool errors = false;
+
+    for(const auto& problem : result.Problems) {
+        if(problem.Severity == smacpp::FoundProblem::SEVERITY::Error)
+            errors = true;
+
+        report << problem.FormatAsString() << "\n";
+    }
+
+    for(const auto& [failedFile, reason] : result.FailedFiles)
+        report << failedFile << ": note: not analysed: " << reason << "\n";
+
+    report << "smacpp: analysed " << result.AnalysedFiles << " files, found "
+           << result.Problems.size() << " problems, " << result.FailedFiles.size()
+           << " files failed\n";
+
+    if(arguments.count("stats"))
+        smacpp::Statistics::Print(llvm::errs());
+
+    if(arguments.count("trace")) {
+        const auto& path = arguments["trace"].as<std::string>();
+
+        if(!smacpp::Trace::WriteFile(path)) {
+            std::cerr << "smacpp: failed to write trace file: " << path << "\n";
+            return 2;
+        }
+    }
+
+    return errors ? 1 : 0;
+}
+
+int RunServer(int argc, char* argv[])
+{
+    po::options_description options("smacpp --server options");
+    // clang-format off
+    options.add_options()
+        ("help,h", "print this help")
+        ("server", po::value<std::string>()->required(), "unix socket to listen on")
+        ("stop", "stop the server listening on the socket instead")
+        ("threads,j", po::value<unsigned>()->default_value(1),
+            "analysis threads for each file, 0 for all cores")
+        ("extra-arg", po::value<std::vector<std::string>>(),
+            "argument to add to every compile command")
+        ("max-cached", po::value<size_t>()->default_value(
+            smacpp::ServerSettings{}.MaxCachedResults),
+            "results to keep, the least recently used ones are dropped first")
+        ("client-timeout", po::value<unsigned>()->default_value(
+            smacpp::ServerSettings{}.ClientTimeout),
+            "milliseconds a client has to send its request and read the response")
+        ("log", po::value<std::string>(),
+            "enable debug printing for comma separated categories: parse, analysis, "
+            "serialization, checker or all");
+    // clang-format on
+
+    po::variables_map arguments;
+
+    try {
+        po::store(po::parse_command_line(argc, argv, options), arguments);
+
+        if(arguments.count("help")) {
+            std::cout << "Usage: smacpp --server socket [options]\n"
+                      << "Other smacpp invocations use the server when the environment "
+                         "variable SMACPP_SERVER is set to the socket\n"
+                      << options;
+            return 0;
+        }
+
+        po::notify(arguments);
+    } catch(const po::error& e) {
+        std::cerr << "smacpp: " << e.what() << "\n" << options;
+        return 2;
+    }
+
+    smacpp::ServerSettings settings;
+    settings.SocketPath = arguments["server"].as<std::string>();
+
+    if(arguments.count("stop")) {
+        if(!smacpp::SendServerShutdown(settings.SocketPath)) {
+            std::cerr << "smacpp: no server is listening on " << settings.SocketPath << "\n";
+            return 2;
+        }
+
+        return 0;
+    }
+
+    if(arguments.count("log") &&
+        !smacpp::Logger::EnableDebugCategories(arguments["log"].as<std::string>())) {
+        std::cerr << "smacpp: unknown log category\n";
+        return 2;
+    }
+
+    settings.MaxCachedResults = arguments["max-cached"].as<size_t>();
+    settings.ClientTimeout = arguments["client-timeout"].as<unsigned>();
+    settings.Analysis.Threads = arguments["threads"].as<unsigned>();
+
+    if(settings.Analysis.Threads == 0)
+        settings.Analysis.Threads = std::max(1u, std::thread::hardware_concurrency());
+
+    settings.ExtraArguments = ResourceDirArguments();
+
+    if(arguments.count("extra-arg")) {
+        for(const auto& arg : arguments["extra-arg"].as<std::vector<std::string>>())
+            settings.ExtraArguments.push_back(arg);
+    }
+
+    try {
+        smacpp::AnalysisServer server(settings);
+        server.Run();
+    } catch(const std::runtime_error& e) {
+        std::cerr << "smacpp: " << e.what() << "\n";
+        return 2;
+    }
+
+    return 0;
+}
+
+//! \brief Analyses the command with the server set in SMACPP_SERVER
+//! \returns False if there is no server or it couldn't analyse the command, in which case
+//! the plugin needs to be loaded into clang
+bool AnalyseWithServer(const char* clangExecutable, int argc, char* argv[], int& exitCode)
+{
+    const char* socket = std::getenv("SMACPP_SERVER");
+
+    if(!socket || !*socket)
+        return false;
+
+    smacpp::ServerRequest request;
+    request.Directory = boost::filesystem::current_path().string();
+    request.Arguments.push_back(clangExecutable);
+    request.Arguments.insert(request.Arguments.end(), argv + 1, argv + argc);
+
+    const auto response = smacpp::SendServerRequest(socket, request);
+
+    if(!response || response->ExitCode == 2)
+        return false;
+
+    for(const auto& line : response->Output)
+        std::cerr << line << "\n";
+
+    exitCode = response->ExitCode;
+    return true;
+}
+
+} // namespace
 
 int main(int argc, char* argv[])
 {
     if(argc < 1)
         return 1;
 
+    if(argc > 1 && IsModeFlag(argv[1], "--batch"))
+        return RunBatch(argc, argv);
+
+    if(argc > 1 && IsModeFlag(argv[1], "--server"))
+        return RunServer(argc, argv);
+
     const char* clangExecutable = "clang";
 
     if(std::string(argv[0]).find_last_of("++") != std::string::npos)
@@ -44,6 +337,20 @@ int main(int argc, char* argv[])
 
     // TODO: check if the plugin loading args already exist
 
+    // The server has already analysed the code so clang only needs to compile it
+    int serverExitCode = 0;
+
+    if(AnalyseWithServer(clangExecutable, argc, argv, serverExitCode)) {
+        // Like with the plugin, found errors fail the compilation
+        if(serverExitCode != 0 ||
+            std::find_if(argv + 1, argv + argc, [](const char* arg) {
+                return std::strcmp(arg, "-fsyntax-only") == 0;
+            }) != argv + argc)
+            return serverExitCode;
+
+        pluginLoadingAlreadyPresent = true;
+    }
+
     if(!pluginLoadingAlreadyPresent) {
 
         const auto plugin = smacpp::FindSMACPPClangPlugin(argv[0]);
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "llvm/Support/Allocator.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace smacpp {
+
+//! \brief Standard allocator that takes memory from a bump pointer arena
+//!
+//! Deallocating is a no-op, the memory is released all at once when the arena is destroyed.
+//! Without an arena the global heap is used. Copies of containers using this allocate
+//! their own storage from the global heap, but the copied elements are not deep copies:
+//! shared pointers in them (like the Condition parts made inside an ArenaScope) still point
+//! to arena memory. So copies of arena allocated data can't outlive the arena either.
+template<class T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator(llvm::BumpPtrAllocator* arena = nullptr) noexcept : Arena(arena) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : Arena(other.GetArena())
+    {}
+
+    T* allocate(size_t count)
+    {
+        if(!Arena)
+            return std::allocator<T>().allocate(count);
+
+        return static_cast<T*>(Arena->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept
+    {
+        if(!Arena)
+            std::allocator<T>().deallocate(pointer, count);
+    }
+
+    ArenaAllocator select_on_container_copy_construction() const
+    {
+        return ArenaAllocator();
+    }
+
+    llvm::BumpPtrAllocator* GetArena() const
+    {
+        return Arena;
+    }
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U>& other) const
+    {
+        return Arena == other.GetArena();
+    }
+
+    template<class U>
+    bool operator!=(const ArenaAllocator<U>& other) const
+    {
+        return Arena != other.GetArena();
+    }
+
+private:
+    llvm::BumpPtrAllocator* Arena;
+};
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+//! \brief Sets the arena for the objects that are created deep inside other objects, like
+//! the Condition parts, on this thread while this exists
+//!
+//! Everything allocated from the arena must be destroyed before the arena
+class ArenaScope {
+public:
+    ArenaScope(llvm::BumpPtrAllocator& arena) : Previous(Current)
+    {
+        Current = &arena;
+    }
+
+    ~ArenaScope()
+    {
+        Current = Previous;
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    //! \returns The arena of the innermost scope on this thread or null
+    static llvm::BumpPtrAllocator* GetCurrent()
+    {
+        return Current;
+    }
+
+private:
+    llvm::BumpPtrAllocator* const Previous;
+
+    static inline thread_local llvm::BumpPtrAllocator* Current = nullptr;
+};
+
+} // namespace smacpp
@@ -0,0 +1,170 @@
+// ------------------------------------ //
+#include "BatchAnalysis.h"
+
+#include "ClangFrontendAction.h"
+#include "Logging.h"
+#include "Trace.h"
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Tooling/ArgumentsAdjusters.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/JSONCompilationDatabase.h"
+#include "clang/Tooling/Tooling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+using namespace smacpp;
+// ------------------------------------ //
+namespace {
+
+class ActionFactory : public clang::tooling::FrontendActionFactory {
+public:
+    ActionFactory(const AnalysisSettings& settings, MainASTConsumer::ProblemHandler handler) :
+        Settings(settings), Handler(std::move(handler))
+    {}
+
+    std::unique_ptr<clang::FrontendAction> create() override
+    {
+        return std::make_unique<FrontendAction>(Settings, Handler);
+    }
+
+private:
+    const AnalysisSettings& Settings;
+    MainASTConsumer::ProblemHandler Handler;
+};
+
+std::unique_ptr<clang::tooling::CompilationDatabase> LoadDatabase(const std::string& path)
+{
+    std::string error;
+    std::unique_ptr<clang::tooling::CompilationDatabase> database;
+
+    if(llvm::StringRef(path).endswith(".json")) {
+        database = clang::tooling::JSONCompilationDatabase::loadFromFile(
+            path, error, clang::tooling::JSONCommandLineSyntax::AutoDetect);
+    } else {
+        database = clang::tooling::CompilationDatabase::loadFromDirectory(path, error);
+    }
+
+    if(!database)
+        throw std::runtime_error("failed to load compilation database: " + error);
+
+    return database;
+}
+
+bool ProblemLess(const FoundProblem& first, const FoundProblem& second)
+{
+    return std::tie(first.Position.File, first.Position.Line, first.Position.Column,
+               first.Message) < std::tie(second.Position.File, second.Position.Line,
+                                    second.Position.Column, second.Message);
+}
+
+} // namespace
+// ------------------------------------ //
+BatchResult smacpp::RunBatchAnalysis(const BatchSettings& settings)
+{
+    const auto database = LoadDatabase(settings.CompilationDatabase);
+
+    std::vector<std::string> files;
+
+    for(auto& file : database->getAllFiles()) {
+        if(settings.Filters.empty() ||
+            std::any_of(settings.Filters.begin(), settings.Filters.end(),
+                [&](const std::string& filter) {
+                    return file.find(filter) != std::string::npos;
+                }))
+            files.push_back(std::move(file));
+    }
+
+    BatchResult result;
+    std::mutex resultMutex;
+
+    // Files are small units of work so a shared counter is enough to balance the threads
+    std::atomic<size_t> nextFile{0};
+
+    const auto worker = [&]() {
+        clang::IgnoringDiagConsumer ignoreDiagnostics;
+
+        while(true) {
+            const auto index = nextFile.fetch_add(1, std::memory_order_relaxed);
+
+            if(index >= files.size())
+                break;
+
+            const auto& file = files[index];
+
+            TraceScope scope("batch", file);
+            SMACPP_LOG(Info, Parse, "analysing " << file);
+
+            std::vector<FoundProblem> problems;
+
+            ActionFactory factory(
+                settings.Analysis, [&problems](std::vector<FoundProblem>&& found) {
+                    problems = std::move(found);
+                });
+
+            // The database is only read here so it can be shared between the threads
+            clang::tooling::ClangTool tool(*database, {file});
+
+            // Compiler errors are not interesting, only that the file could not be parsed
+            tool.setDiagnosticConsumer(&ignoreDiagnostics);
+
+            if(!settings.ExtraArguments.empty()) {
+                tool.appendArgumentsAdjuster(clang::tooling::getInsertArgumentAdjuster(
+                    settings.ExtraArguments, clang::tooling::ArgumentInsertPosition::END));
+            }
+
+            std::string failure;
+
+            try {
+                if(tool.run(&factory) != 0)
+                    failure = "failed to parse";
+            } catch(const std::runtime_error& e) {
+                failure = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(resultMutex);
+
+            if(!failure.empty()) {
+                SMACPP_LOG(Warning, Parse, file << ": " << failure);
+                result.FailedFiles.emplace_back(file, failure);
+            }
+
+            ++result.AnalysedFiles;
+
+            result.Problems.insert(result.Problems.end(),
+                std::make_move_iterator(problems.begin()),
+                std::make_move_iterator(problems.end()));
+        }
+    };
+
+    const auto threadCount =
+        std::max<size_t>(1, std::min<size_t>(settings.Threads, files.size()));
+
+    std::vector<std::thread> threads;
+
+    for(size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for(auto& thread : threads)
+        thread.join();
+
+    std::sort(result.Problems.begin(), result.Problems.end(), ProblemLess);
+
+    result.Problems.erase(std::unique(result.Problems.begin(), result.Problems.end(),
+                              [](const FoundProblem& first, const FoundProblem& second) {
+                                  return first.Position == second.Position &&
+                                         first.Message == second.Message;
+                              }),
+        result.Problems.end());
+
+    std::sort(result.FailedFiles.begin(), result.FailedFiles.end());
+
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "analysis/Analyzer.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace smacpp {
+
+struct BatchSettings {
+    //! Build folder containing compile_commands.json or the path of the file itself
+    std::string CompilationDatabase;
+
+    //! If not empty only files with a path containing one of these are analysed
+    std::vector<std::string> Filters;
+
+    //! Added to the end of every compile command, for example -resource-dir
+    std::vector<std::string> ExtraArguments;
+
+    //! How many files are parsed and analysed at the same time
+    unsigned Threads = 1;
+
+    //! \note The threads setting in this is used for the analysis within each file
+    AnalysisSettings Analysis;
+};
+
+struct BatchResult {
+    //! Problems from all files sorted by position. Problems in headers found through
+    //! multiple files are only included once
+    std::vector<FoundProblem> Problems;
+
+    size_t AnalysedFiles = 0;
+
+    //! Files that failed to parse or analyse along with the reason
+    std::vector<std::pair<std::string, std::string>> FailedFiles;
+};
+
+//! \brief Parses and analyses all files of a compilation database in this process
+//! \exception std::runtime_error if the compilation database can't be loaded
+BatchResult RunBatchAnalysis(const BatchSettings& settings);
+
+} // namespace smacpp
@@ -1,11 +1,20 @@
 #pragma once
 
+#include "Logging.h"
 #include "MainASTConsumer.h"
+#include "Statistics.h"
+#include "Trace.h"
 
 
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendAction.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+
 
 namespace smacpp {
 class ASTAction : public clang::PluginASTAction {
@@ -13,7 +22,22 @@ protected:
     std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
         clang::CompilerInstance& Compiler, llvm::StringRef InFile) override
     {
-        return std::make_unique<MainASTConsumer>(EnableDebugPrint
+        // Each TU gets its own statistics and trace
+        Statistics::Reset();
+        Trace::Clear();
+
+        std::string summaryOutput = SummaryOutput;
+
+        if(EmitSummary && summaryOutput.empty()) {
+            // Placed next to the object file
+            const auto& output = Compiler.getFrontendOpts().OutputFile;
+
+            summaryOutput = (output.empty() || output == "-" ? InFile.str() : output) +
+                            SUMMARY_FILE_EXTENSION;
+        }
+
+        return std::make_unique<MainASTConsumer>(
+            Settings, summaryOutput, StatsOutput, TraceOutput
             // Compiler.getASTContext()
         );
     }
@@ -23,7 +47,74 @@ protected:
     {
         for(size_t i = 0; i < args.size(); ++i) {
             if(args[i] == "-smacpp-debug") {
-                EnableDebugPrint = true;
+                Logger::SetLevel(LOG_LEVEL::Debug);
+            } else if(args[i].find("-smacpp-log=") == 0) {
+                if(!Logger::EnableDebugCategories(
+                       args[i].substr(std::strlen("-smacpp-log=")))) {
+                    llvm::errs() << "smacpp: unknown log category in: " << args[i] << "\n";
+                    return false;
+                }
+            } else if(args[i].find("-smacpp-log-level=") == 0) {
+                const auto level =
+                    Logger::ParseLevel(args[i].substr(std::strlen("-smacpp-log-level=")));
+
+                if(!level) {
+                    llvm::errs() << "smacpp: unknown log level in: " << args[i] << "\n";
+                    return false;
+                }
+
+                Logger::SetLevel(*level);
+            } else if(args[i].find("-smacpp-threads=") == 0) {
+                const auto threads =
+                    std::atoi(args[i].c_str() + std::strlen("-smacpp-threads="));
+
+                Settings.Threads =
+                    threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+            } else if(args[i].find("-smacpp-max-paths=") == 0) {
+                if(!ParseNumber(args[i], "-smacpp-max-paths=", 1u, Settings.MaxPaths))
+                    return false;
+            } else if(args[i].find("-smacpp-max-call-contexts=") == 0) {
+                if(!ParseNumber(args[i], "-smacpp-max-call-contexts=", 0u,
+                       Settings.MaxCallContexts))
+                    return false;
+            } else if(args[i].find("-smacpp-time-limit=") == 0) {
+                if(!ParseNumber(args[i], "-smacpp-time-limit=", 0u,
+                       Settings.EntryPointBudget.TimeLimit))
+                    return false;
+            } else if(args[i].find("-smacpp-max-operations=") == 0) {
+                if(!ParseNumber(args[i], "-smacpp-max-operations=", size_t(0),
+                       Settings.EntryPointBudget.MaxOperations))
+                    return false;
+            } else if(args[i].find("-smacpp-max-memory=") == 0) {
+                if(!ParseNumber(args[i], "-smacpp-max-memory=", size_t(0),
+                       Settings.EntryPointBudget.MaxMemory))
+                    return false;
+
+                Settings.EntryPointBudget.MaxMemory <<= 20;
+            } else if(args[i].find("-smacpp-function-time-limit=") == 0) {
+                if(!ParseNumber(args[i], "-smacpp-function-time-limit=", 0u,
+                       Settings.FunctionBudget.TimeLimit))
+                    return false;
+            } else if(args[i].find("-smacpp-function-max-operations=") == 0) {
+                if(!ParseNumber(args[i], "-smacpp-function-max-operations=", size_t(0),
+                       Settings.FunctionBudget.MaxOperations))
+                    return false;
+            } else if(args[i] == "-smacpp-emit-summary") {
+                EmitSummary = true;
+            } else if(args[i].find("-smacpp-summary-output=") == 0) {
+                EmitSummary = true;
+                SummaryOutput = args[i].substr(std::strlen("-smacpp-summary-output="));
+            } else if(args[i] == "-smacpp-stats") {
+                Statistics::Enable(true);
+            } else if(args[i].find("-smacpp-stats=") == 0) {
+                Statistics::Enable(true);
+                StatsOutput = args[i].substr(std::strlen("-smacpp-stats="));
+            } else if(args[i].find("-smacpp-trace=") == 0) {
+                Trace::Enable(true);
+                TraceOutput = args[i].substr(std::strlen("-smacpp-trace="));
+            } else if(args[i].find("-smacpp-result-cache=") == 0) {
+                Settings.ResultCacheFile =
+                    args[i].substr(std::strlen("-smacpp-result-cache="));
             }
         }
         if(!args.empty() && args[0] == "help")
@@ -32,10 +123,56 @@ protected:
         return true;
     }
 
+    //! \brief Parses the number after prefix in arg into value
+    //! \returns False after printing a diagnostic if the value isn't a whole number of at
+    //! least min that fits in T
+    template<typename T>
+    static bool ParseNumber(const std::string& arg, const char* prefix, T min, T& value)
+    {
+        unsigned long long parsed;
+
+        if(llvm::StringRef(arg).substr(std::strlen(prefix)).getAsInteger(10, parsed) ||
+            parsed < min || parsed > std::numeric_limits<T>::max()) {
+            llvm::errs() << "smacpp: invalid value in: " << arg << " (expected a number of at "
+                         << "least " << min << ")\n";
+            return false;
+        }
+
+        value = static_cast<T>(parsed);
+        return true;
+    }
+
     void PrintHelp(llvm::raw_ostream& ros)
     {
         ros << "SMACPP Clang plugin:\n"
-            << "-smacpp-debug Enables debug printing\n";
+            << "-smacpp-debug Enables debug printing\n"
+            << "-smacpp-log=category,... Enables debug printing only for the categories "
+               "(parse, analysis, serialization, checker, all)\n"
+            << "-smacpp-log-level=level Sets the printed messages (error, warning, info, "
+               "debug)\n"
+            << "-smacpp-threads=N Runs the analysis with N threads (0 uses all cores)\n"
+            << "-smacpp-max-paths=N Splits the analysis of each call into at most N paths "
+               "when conditions can't be determined (1 disables splitting)\n"
+            << "-smacpp-max-call-contexts=N Widens the parameters of the calls a function "
+               "call makes to a function after N different ones (0 is unlimited)\n"
+            << "-smacpp-time-limit=ms Stops the analysis after ms milliseconds and reports "
+               "the problems found so far\n"
+            << "-smacpp-max-operations=N Stops the analysis after N function calls\n"
+            << "-smacpp-max-memory=MiB Stops the analysis when the program states use more "
+               "memory\n"
+            << "-smacpp-function-time-limit=ms Skips the rest of a function call after ms "
+               "milliseconds\n"
+            << "-smacpp-function-max-operations=N Skips the rest of a function call after N "
+               "action steps\n"
+            << "-smacpp-emit-summary Writes the parsed code next to the object file (as "
+            << SUMMARY_FILE_EXTENSION << ") for smacpp-link\n"
+            << "-smacpp-summary-output=file Writes the parsed code to file\n"
+            << "-smacpp-stats Prints phase times and analysis counters\n"
+            << "-smacpp-stats=file Writes the statistics to file as JSON\n"
+            << "-smacpp-trace=file Writes a timeline of the parsing and analysis as Chrome "
+               "trace event JSON\n"
+            << "-smacpp-result-cache=file Reuses the results from file if the analysed code "
+               "has not changed\n";
     }
 
     //! This should automatically run the plugin after the main AST action when usinf -fplugin=
@@ -45,7 +182,14 @@ protected:
         return AddAfterMainAction;
     }
 
+public:
+    static constexpr auto SUMMARY_FILE_EXTENSION = ".smacpp";
+
 protected:
-    bool EnableDebugPrint = false;
+    AnalysisSettings Settings;
+    bool EmitSummary = false;
+    std::string SummaryOutput;
+    std::string StatsOutput;
+    std::string TraceOutput;
 };
 } // namespace smacpp
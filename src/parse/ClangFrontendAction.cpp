@@ -1,8 +1,6 @@
 // ------------------------------------ //
 #include "ClangFrontendAction.h"
 
-#include "MainASTConsumer.h"
-
 #include <clang/Frontend/CompilerInstance.h>
 
 using namespace smacpp;
@@ -10,6 +8,10 @@ using namespace smacpp;
 std::unique_ptr<clang::ASTConsumer> FrontendAction::CreateASTConsumer(
     clang::CompilerInstance& Compiler, llvm::StringRef InFile)
 {
-    return std::make_unique<MainASTConsumer>(false // Compiler.getASTContext()
-    );
+    auto consumer = std::make_unique<MainASTConsumer>(Settings);
+
+    if(Handler)
+        consumer->SetProblemHandler(Handler);
+
+    return consumer;
 }
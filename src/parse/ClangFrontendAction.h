@@ -1,12 +1,29 @@
 #pragma once
 
+#include "MainASTConsumer.h"
+
 #include "clang/Frontend/FrontendAction.h"
 
 
 namespace smacpp {
+//! \brief Runs smacpp on a TU without clang loading it as a plugin
 class FrontendAction : public clang::ASTFrontendAction {
 public:
+    FrontendAction() = default;
+
+    //! \param handler If set receives the found problems instead of them being reported as
+    //! clang diagnostics
+    FrontendAction(
+        const AnalysisSettings& settings, MainASTConsumer::ProblemHandler handler = nullptr) :
+        Settings(settings),
+        Handler(std::move(handler))
+    {}
+
     virtual std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
         clang::CompilerInstance& Compiler, llvm::StringRef InFile);
+
+protected:
+    AnalysisSettings Settings;
+    MainASTConsumer::ProblemHandler Handler;
 };
 } // namespace smacpp
@@ -2,12 +2,44 @@
 #include "CodeBlock.h"
 
 #include <sstream>
+#include <stdexcept>
 
 using namespace smacpp;
 // ------------------------------------ //
+// CodeBlock
+void CodeBlock::AddProcessedAction(const Condition& condition, ProcessedAction::Data action,
+    clang::SourceLocation location, const SourcePosition& position)
+{
+    if(Conditions.empty() || !(Conditions.back() == condition))
+        AddCondition(condition);
+
+    AddProcessedAction(Conditions.size() - 1, std::move(action), location, position);
+}
+
+void CodeBlock::AddProcessedAction(uint32_t condition, ProcessedAction::Data action,
+    clang::SourceLocation location, const SourcePosition& position)
+{
+    if(condition >= Conditions.size())
+        throw std::runtime_error("CodeBlock: action condition index is out of range");
+
+    Actions.emplace_back(std::move(action), condition, location);
 
+    if(position.IsValid()) {
+        ActionPositions.resize(Actions.size());
+        ActionPositions.back() = position;
+    }
+}
+
+const SourcePosition& CodeBlock::GetActionPosition(size_t index) const
+{
+    static const SourcePosition noPosition;
+
+    if(index >= ActionPositions.size())
+        return noPosition;
+
+    return ActionPositions[index];
+}
 // ------------------------------------ //
-// CodeBlock
 std::string CodeBlock::Dump() const
 {
     std::stringstream sstream;
@@ -21,7 +53,7 @@ std::string CodeBlock::Dump() const
 
     sstream << "actions:\n";
     for(const auto& action : Actions)
-        sstream << " " << action->Dump() << "\n";
+        sstream << " " << GetCondition(action).Dump() << " " << action.Dump() << "\n";
 
     sstream << "block end\n";
     return sstream.str();
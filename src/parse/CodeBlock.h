@@ -1,5 +1,6 @@
 #pragma once
 
+#include "CompiledCondition.h"
 #include "Condition.h"
 #include "ProcessedAction.h"
 
@@ -10,21 +11,50 @@ namespace smacpp {
 //! Represents a block of source code that has properties extracted from it
 class CodeBlock {
 public:
-    CodeBlock(const std::string& qualifiedName, clang::SourceLocation location) :
-        Name(qualifiedName), Location(location)
+    //! \param arena If not null the actions and conditions are allocated from this. The
+    //! arena must outlive this
+    CodeBlock(const std::string& qualifiedName, clang::SourceLocation location,
+        llvm::BumpPtrAllocator* arena = nullptr) :
+        Name(qualifiedName),
+        Location(location),
+        FunctionParameters(arena),
+        Actions(arena),
+        Conditions(arena),
+        CompiledConditions(arena),
+        ActionPositions(arena)
     {}
 
+    CodeBlock(CodeBlock&& other) = default;
+    CodeBlock& operator=(CodeBlock&& other) = default;
+
+    //! A copy would still share the arena allocated condition parts of this, so blocks can
+    //! only be moved
+    CodeBlock(const CodeBlock& other) = delete;
+    CodeBlock& operator=(const CodeBlock& other) = delete;
+
     //! \brief All potentially unsafe calls, and variable state changes are added through this
     //!
     //! Everything is bunched together like this in order to be able to determine the variable
     //! states at the potentially unsafe operations in order to verify the conditions under
     //! which they are unsafe
-    void AddProcessedAction(std::unique_ptr<ProcessedAction>&& action,
-        clang::SourceLocation location = clang::SourceLocation{})
+    //! \param position Only needed for actions loaded from a summary file where location
+    //! can't be used
+    void AddProcessedAction(const Condition& condition, ProcessedAction::Data action,
+        clang::SourceLocation location = clang::SourceLocation{},
+        const SourcePosition& position = SourcePosition{});
+
+    //! \brief Variant of AddProcessedAction for a condition added with AddCondition
+    void AddProcessedAction(uint32_t condition, ProcessedAction::Data action,
+        clang::SourceLocation location = clang::SourceLocation{},
+        const SourcePosition& position = SourcePosition{});
+
+    //! \brief Adds a condition without checking for duplicates
+    //! \returns The index to give to AddProcessedAction
+    uint32_t AddCondition(const Condition& condition)
     {
-        if(location.isValid())
-            action->Location = location;
-        Actions.push_back(std::move(action));
+        Conditions.push_back(condition);
+        CompiledConditions.emplace_back(condition, GetArena());
+        return Conditions.size() - 1;
     }
 
     //! \brief Register function parameter
@@ -38,11 +68,37 @@ public:
         return Actions;
     }
 
+    const auto& GetConditions() const
+    {
+        return Conditions;
+    }
+
+    const Condition& GetCondition(const ProcessedAction& action) const
+    {
+        return Conditions[action.If];
+    }
+
+    //! \brief The conditions compiled for evaluation, same indices as GetConditions
+    const auto& GetCompiledConditions() const
+    {
+        return CompiledConditions;
+    }
+
+    //! \returns The position of the action at index or an invalid position if the action
+    //! was not loaded from a summary file
+    const SourcePosition& GetActionPosition(size_t index) const;
+
     const auto& GetParameters() const
     {
         return FunctionParameters;
     }
 
+    //! \returns The arena this is allocated from or null if this is on the heap
+    llvm::BumpPtrAllocator* GetArena() const
+    {
+        return Actions.get_allocator().GetArena();
+    }
+
     // //! \brief Computes an overall Condition that if it matches this is unsafe to call
     // Condition ComputeUnsafeInput();
 
@@ -58,16 +114,38 @@ public:
         return Location;
     }
 
+    const auto& GetPosition() const
+    {
+        return Position;
+    }
+
+    void SetPosition(const SourcePosition& position)
+    {
+        Position = position;
+    }
+
 private:
     std::string Name;
     clang::SourceLocation Location;
 
+    //! Set when loaded from a summary file
+    SourcePosition Position;
+
     //! \todo Find default values
-    std::vector<VariableIdentifier> FunctionParameters;
+    ArenaVector<VariableIdentifier> FunctionParameters;
 
     //! All actions in chronological order in order to be able to do symbolic execution
     //! correctly
-    std::vector<std::unique_ptr<ProcessedAction>> Actions;
+    ArenaVector<ProcessedAction> Actions;
+
+    //! The conditions referred to by ProcessedAction::If. Consecutive actions with equal
+    //! conditions share the same entry
+    ArenaVector<Condition> Conditions;
+    ArenaVector<CompiledCondition> CompiledConditions;
+
+    //! Positions of the actions, only filled up to the last action that has one as they are
+    //! rarely used
+    ArenaVector<SourcePosition> ActionPositions;
 };
 
 } // namespace smacpp
@@ -1,531 +1,577 @@
 // ------------------------------------ //
 #include "CodeBlockBuildingVisitor.h"
 
-#include "ComplexExpressionParser.h"
-#include "LiteralStateVisitor.h"
+#include "Logging.h"
 #include "ProcessedAction.h"
+#include "Statistics.h"
+#include "Trace.h"
 #include "analysis/BlockRegistry.h"
 
 #include <optional>
+#include <unordered_map>
 
 using namespace smacpp;
 // ------------------------------------ //
-// CodeBlockBuildingVisitor::VariableRefOrArrayVisitor
-class CodeBlockBuildingVisitor::VariableRefOrArrayVisitor
-    : public clang::RecursiveASTVisitor<VariableRefOrArrayVisitor> {
+// CodeBlockBuildingVisitor::FunctionVisitor
+class CodeBlockBuildingVisitor::FunctionVisitor
+    : public clang::RecursiveASTVisitor<FunctionVisitor> {
+
+    //! \brief What is known about an already visited expression
+    struct ExprInfo {
+        //! Set when the expression names a whole variable (possibly through casts)
+        std::optional<VariableIdentifier> Variable;
+        //! Set when the expression is an integer constant
+        std::optional<PrimitiveInfo::Integer> Literal;
+        //! The value the expression computes if it could be parsed
+        std::optional<VariableState> Value;
+        //! Set when the expression can be used as a condition
+        std::optional<Condition::Part> ConditionPart;
+    };
+
+    //! \brief The cases seen so far in the switch body that is being visited
+    struct SwitchScope {
+        std::optional<VariableIdentifier> Variable;
+        std::optional<VariableState> Constant;
+        Condition CurrentCase;
+        std::vector<Condition> Cases;
+    };
+
+    //! \brief A condition applying to the statements under an if or switch
+    struct ConditionScope {
+        Condition Base;
+        //! Set for switch bodies, case labels only apply to the innermost switch
+        std::optional<SwitchScope> Switch;
+    };
+
 public:
-    VariableRefOrArrayVisitor(bool debug) : Debug(debug) {}
+    FunctionVisitor(clang::ASTContext& context, CodeBlock& target) :
+        Context(context), Target(target)
+    {}
 
-    bool VisitDeclRefExpr(clang::DeclRefExpr* expr)
+    //! \brief Children are visited before their parents so that the parents can use the
+    //! results of the children
+    bool shouldTraversePostOrder() const
     {
-        if(clang::VarDecl* var = clang::dyn_cast<clang::VarDecl>(expr->getDecl()); var) {
-
-            VariableIdentifier ident(var);
-
-            if(Debug)
-                llvm::outs() << "found var reference: " << ident.Dump() << "\n";
-
-            if(LikelyFullVariableAssign) {
-                FoundVar = ident;
-            }
-
-        } else {
-            if(Debug)
-                llvm::outs() << "found unknown reference\n";
-        }
-
         return true;
     }
 
-    bool VisitArraySubscriptExpr(clang::ArraySubscriptExpr* expr)
+    bool VisitParmVarDecl(clang::ParmVarDecl* var)
     {
-        LikelyFullVariableAssign = false;
+        Target.AddFunctionParameter(VariableIdentifier(var));
         return true;
     }
 
-    std::optional<VariableIdentifier> FoundVar;
+    bool VisitVarDecl(clang::VarDecl* var);
 
-private:
-    bool LikelyFullVariableAssign = true;
-    bool Debug;
-};
+    bool VisitDeclRefExpr(clang::DeclRefExpr* expr);
+    bool VisitIntegerLiteral(clang::IntegerLiteral* literal);
+    bool VisitParenExpr(clang::ParenExpr* expr);
+    bool VisitCastExpr(clang::CastExpr* expr);
+    bool VisitUnaryOperator(clang::UnaryOperator* op);
+    bool VisitBinaryOperator(clang::BinaryOperator* op);
+    bool VisitArraySubscriptExpr(clang::ArraySubscriptExpr* expr);
+    bool VisitCallExpr(clang::CallExpr* call);
 
-// ------------------------------------ //
-#define VALUE_VISITOR_VISIT_TYPES                                 \
-    bool VisitVarDecl(clang::VarDecl* var)                        \
-    {                                                             \
-        return ValueVisitBase::VisitVarDecl(var);                 \
-    }                                                             \
-    bool TraverseIfStmt(clang::IfStmt* stmt)                      \
-    {                                                             \
-        return ValueVisitBase::TraverseIfStmt(stmt);              \
-    }                                                             \
-    bool TraverseSwitchStmt(clang::SwitchStmt* stmt)              \
-    {                                                             \
-        return ValueVisitBase::TraverseSwitchStmt(stmt);          \
-    }                                                             \
-    bool VisitArraySubscriptExpr(clang::ArraySubscriptExpr* expr) \
-    {                                                             \
-        return ValueVisitBase::VisitArraySubscriptExpr(expr);     \
-    }                                                             \
-    bool VisitBinaryOperator(clang::BinaryOperator* op)           \
-    {                                                             \
-        return ValueVisitBase::VisitBinaryOperator(op);           \
-    }                                                             \
-    bool TraverseCallExpr(clang::CallExpr* call)                  \
-    {                                                             \
-        return ValueVisitBase::TraverseCallExpr(call);            \
-    }
+    bool TraverseIfStmt(clang::IfStmt* stmt);
+    bool TraverseSwitchStmt(clang::SwitchStmt* stmt);
+    bool TraverseCaseStmt(clang::CaseStmt* stmt);
+    bool TraverseDefaultStmt(clang::DefaultStmt* stmt);
+    bool VisitBreakStmt(clang::BreakStmt* stmt);
 
+    Condition GetCurrentCondition() const;
 
+private:
+    //! \returns The stored info for an already visited expression or null
+    const ExprInfo* FindInfo(const clang::Expr* expr) const
+    {
+        if(!expr)
+            return nullptr;
 
-// ------------------------------------ //
-// CodeBlockBuildingVisitor::ConditionalContentVisitor
-class CodeBlockBuildingVisitor::ConditionalContentVisitor
-    : public clang::RecursiveASTVisitor<ConditionalContentVisitor>,
-      public ValueVisitBase {
-public:
-    ConditionalContentVisitor(
-        Condition cond, clang::ASTContext& context, CodeBlock& target, bool debug) :
-        ValueVisitBase(context, target, debug),
-        Cond(cond)
-    {}
+        const auto found = Expressions.find(expr);
+        return found != Expressions.end() ? &found->second : nullptr;
+    }
+
+    //! \brief Copies the info of a sub expression that doesn't change the value
+    void ForwardInfo(const clang::Expr* expr, const clang::Expr* subExpr)
+    {
+        if(const auto* info = FindInfo(subExpr); info)
+            Expressions[expr] = *info;
+    }
 
-    VALUE_VISITOR_VISIT_TYPES;
+    Condition ConditionFromExpr(const clang::Expr* expr) const;
 
-    Condition GetCurrentCondition() const override
+    SwitchScope* GetInnermostSwitch()
     {
-        return Cond;
+        if(Scopes.empty() || !Scopes.back().Switch)
+            return nullptr;
+
+        return &*Scopes.back().Switch;
     }
 
+    bool TraverseConditional(clang::Stmt* stmt, const Condition& condition);
+
 private:
-    Condition Cond;
+    clang::ASTContext& Context;
+    CodeBlock& Target;
+
+    std::unordered_map<const clang::Expr*, ExprInfo> Expressions;
+    std::vector<ConditionScope> Scopes;
 };
 // ------------------------------------ //
-// CodeBlockBuildingVisitor::FunctionVisitor
-class CodeBlockBuildingVisitor::FunctionVisitor
-    : public clang::RecursiveASTVisitor<FunctionVisitor>,
-      public ValueVisitBase {
-public:
-    FunctionVisitor(clang::ASTContext& context, CodeBlock& target, bool debug) :
-        ValueVisitBase(context, target, debug)
-    {}
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitVarDecl(clang::VarDecl* var)
+{
+    clang::FullSourceLoc fullLocation = Context.getFullLoc(var->getBeginLoc());
 
-    bool VisitParmVarDecl(clang::ParmVarDecl* var)
-    {
-        // llvm::outs() << "function param: " << var->getQualifiedNameAsString() << "\n";
+    if(clang::dyn_cast<clang::ParmVarDecl>(var))
+        return true;
 
-        Target.AddFunctionParameter(VariableIdentifier(var));
+    VariableState state;
 
-        return true;
+    const auto* value = var->getAnyInitializer();
+
+    if(value && value->getStmtClass() == clang::Stmt::StmtClass::StringLiteralClass) {
+        const auto* literal = static_cast<const clang::StringLiteral*>(value);
+
+        state.Set(BufferInfo(literal->getByteLength()));
     }
 
-    VALUE_VISITOR_VISIT_TYPES;
-};
+    SMACPP_LOG(Debug, Parse,
+        "local var: " << var->getType().getAsString() << " "
+                      << var->getQualifiedNameAsString() << " init: " << state.Dump());
+
+    Target.AddProcessedAction(GetCurrentCondition(),
+        action::VarDeclared{VariableIdentifier(var), state}, fullLocation);
+
+    return true;
+}
 // ------------------------------------ //
-// CodeBlockBuildingVisitor::CaseConditionalVisitor
-class CodeBlockBuildingVisitor::CaseConditionalVisitor
-    : public clang::RecursiveASTVisitor<CaseConditionalVisitor>,
-      public ValueVisitBase {
-public:
-    CaseConditionalVisitor(Condition baseCondition, VariableIdentifier switchVar,
-        clang::ASTContext& context, CodeBlock& target, bool debug) :
-        ValueVisitBase(context, target, debug),
-        BaseCondition(baseCondition), SwitchVar(switchVar)
-    {}
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitDeclRefExpr(clang::DeclRefExpr* expr)
+{
+    clang::VarDecl* var = clang::dyn_cast<clang::VarDecl>(expr->getDecl());
 
-    CaseConditionalVisitor(Condition baseCondition, VariableState constant,
-        clang::ASTContext& context, CodeBlock& target, bool debug) :
-        ValueVisitBase(context, target, debug),
-        BaseCondition(baseCondition), SwitchVar("unused"), SwitchConstant(constant)
-    {}
+    if(!var)
+        return true;
 
-    bool VisitCaseStmt(clang::CaseStmt* stmt)
-    {
-        if(!stmt->getLHS()) {
-            llvm::outs() << "Case statement without LHS";
-            return true;
-        }
+    VariableIdentifier ident(var);
 
-        LiteralStateVisitor literal;
-        literal.TraverseStmt(stmt->getLHS());
+    SMACPP_LOG(Debug, Parse, "found var reference: " << ident.Dump());
 
-        if(!literal.FoundValue) {
-            if(Debug) {
-                llvm::outs() << "Could not parse switch case value: ";
-                stmt->getLHS()->dump();
-            }
-            return true;
-        }
+    auto& info = Expressions[expr];
+    info.Variable = ident;
+    info.Value = VariableState(VarCopyInfo(ident));
+    info.ConditionPart = Condition::Part(
+        VariableValueCondition(ident, ValueRange(ValueRange::RANGE_CLASS::NotZero)));
+    return true;
+}
+
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitIntegerLiteral(
+    clang::IntegerLiteral* literal)
+{
+    // TODO: this can only handle 64 bit numbers, anything higher will cause an error
+    const auto value = literal->getValue().getSExtValue();
 
-        const auto range = ValueRange(COMPARISON::EQUAL, *literal.FoundValue);
+    auto& info = Expressions[literal];
+    info.Literal = value;
+    info.Value = VariableState(PrimitiveInfo(value));
+    return true;
+}
 
-        Condition newCondition(
-            SwitchConstant ? Condition::Part(VariableStateCondition(*SwitchConstant, range)) :
-                             Condition::Part(VariableValueCondition(SwitchVar, range)));
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitParenExpr(clang::ParenExpr* expr)
+{
+    ForwardInfo(expr, expr->getSubExpr());
+    return true;
+}
 
-        SwitchCases.push_back(newCondition);
-        if(CurrentSwitchCondition.IsAlwaysTrue()) {
-            CurrentSwitchCondition = newCondition;
-        } else {
-            CurrentSwitchCondition = CurrentSwitchCondition.Or(newCondition);
-        }
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitCastExpr(clang::CastExpr* expr)
+{
+    // Casts to boolean are also fine as a variable is already treated as "not zero" when
+    // used as a condition
+    ForwardInfo(expr, expr->getSubExpr());
+    return true;
+}
 
-        if(Debug) {
-            llvm::outs() << "Current switch condition is: " << CurrentSwitchCondition.Dump()
-                         << "\n";
-        }
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitUnaryOperator(clang::UnaryOperator* op)
+{
+    const auto* sub = FindInfo(op->getSubExpr());
 
+    if(!sub)
         return true;
-    }
 
-    bool VisitBreakStmt(clang::BreakStmt* stmt)
-    {
-        // TODO: this needs to detect if there is a loop inside this case statement or not
-        CurrentSwitchCondition = Condition();
+    switch(op->getOpcode()) {
+    case clang::UO_Minus: {
+        if(!sub->Literal)
+            return true;
 
-        if(Debug) {
-            llvm::outs() << "Hit case break\n";
-        }
+        auto& info = Expressions[op];
+        info.Literal = -*sub->Literal;
+        info.Value = VariableState(PrimitiveInfo(*info.Literal));
         return true;
     }
+    case clang::UO_LNot: {
+        if(!sub->ConditionPart)
+            return true;
 
-    bool VisitDefaultStmt(clang::DefaultStmt* stmt)
-    {
-        // TODO: this only works correctly if the default statement is last
+        try {
+            Expressions[op].ConditionPart = sub->ConditionPart->Negate();
+        } catch(const std::exception& e) {
+            SMACPP_LOG(Info, Parse, "Failed to negate condition, exception: " << e.what());
+        }
+        return true;
+    }
+    default: return true;
+    }
+}
 
-        Condition defaultCondition;
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitBinaryOperator(clang::BinaryOperator* op)
+{
+    const auto* lhs = FindInfo(op->getLHS());
+    const auto* rhs = FindInfo(op->getRHS());
 
-        for(const auto& cond : SwitchCases) {
-            if(defaultCondition.IsAlwaysTrue()) {
-                defaultCondition = cond.Negate();
-            } else {
-                defaultCondition = defaultCondition.And(cond.Negate());
-            }
-        }
+    if(!lhs || !rhs)
+        return true;
 
-        if(defaultCondition.IsAlwaysTrue()) {
-            if(Debug)
-                llvm::outs() << "default condition is always true\n";
-        }
+    std::optional<OPERATOR> basicOperator;
+    std::optional<COMPARISON> comparison;
+    std::optional<COMBINE_OPERATOR> combine;
 
-        if(CurrentSwitchCondition.IsAlwaysTrue()) {
-            CurrentSwitchCondition = defaultCondition;
-        } else {
-            CurrentSwitchCondition = CurrentSwitchCondition.Or(defaultCondition);
-        }
+    switch(op->getOpcode()) {
+    case clang::BO_Assign: {
+        if(!lhs->Variable || !rhs->Value)
+            return true;
 
-        if(Debug) {
-            llvm::outs() << "Default switch case condition is: "
-                         << CurrentSwitchCondition.Dump() << "\n";
-        }
+        SMACPP_LOG(Debug, Parse,
+            "Assignment found: " << lhs->Variable->Dump() << " = " << rhs->Value->Dump());
 
+        Target.AddProcessedAction(GetCurrentCondition(),
+            action::VarAssigned{*lhs->Variable, *rhs->Value},
+            Context.getFullLoc(op->getBeginLoc()));
         return true;
     }
+    case clang::BO_Add: basicOperator = OPERATOR::Add; break;
+    case clang::BO_Mul: basicOperator = OPERATOR::Multiply; break;
+    case clang::BO_Sub: basicOperator = OPERATOR::Subtract; break;
+    case clang::BO_LT: comparison = COMPARISON::LESS_THAN; break;
+    case clang::BO_LE: comparison = COMPARISON::LESS_THAN_EQUAL; break;
+    case clang::BO_GT: comparison = COMPARISON::GREATER_THAN; break;
+    case clang::BO_GE: comparison = COMPARISON::GREATER_THAN_EQUAL; break;
+    case clang::BO_EQ: comparison = COMPARISON::EQUAL; break;
+    case clang::BO_NE: comparison = COMPARISON::NOT_EQUAL; break;
+    case clang::BO_LAnd: combine = COMBINE_OPERATOR::And; break;
+    case clang::BO_LOr: combine = COMBINE_OPERATOR::Or; break;
+    default: return true;
+    }
 
-    VALUE_VISITOR_VISIT_TYPES;
+    if(basicOperator) {
+        if(lhs->Value && rhs->Value) {
+            Expressions[op].Value =
+                lhs->Value->CreateOperatorApplyingState(*basicOperator, *rhs->Value);
+        }
 
-    Condition GetCurrentCondition() const override
-    {
-        return BaseCondition.And(CurrentSwitchCondition);
+    } else if(comparison) {
+        // TODO: implement constant comparing to a variable (only variable to constant
+        // comparison works)
+        if(!lhs->Variable)
+            return true;
+
+        if(rhs->Variable) {
+            Expressions[op].ConditionPart = Condition::Part(VariableValueCondition(
+                *lhs->Variable, ValueRange(*comparison, *rhs->Variable)));
+        } else if(rhs->Literal) {
+            const auto constant = VariableState(PrimitiveInfo(*rhs->Literal));
+
+            Expressions[op].ConditionPart = Condition::Part(
+                VariableValueCondition(*lhs->Variable, ValueRange(*comparison, constant)));
+        }
+
+    } else if(combine) {
+        if(lhs->ConditionPart && rhs->ConditionPart) {
+            Expressions[op].ConditionPart =
+                Condition::Part(Condition::Part::MakeShared(*lhs->ConditionPart), *combine,
+                    Condition::Part::MakeShared(*rhs->ConditionPart));
+        }
     }
 
-protected:
-    Condition BaseCondition;
-    Condition CurrentSwitchCondition;
-    std::vector<Condition> SwitchCases;
-    VariableIdentifier SwitchVar;
-    std::optional<VariableState> SwitchConstant;
-};
-// ------------------------------------ //
-// CodeBlockBuildingVisitor::ValueVisitBase
-CodeBlockBuildingVisitor::ValueVisitBase::ValueVisitBase(
-    clang::ASTContext& context, CodeBlock& target, bool debug) :
-    Context(context),
-    Target(target), Debug(debug)
-{}
+    return true;
+}
 
-bool CodeBlockBuildingVisitor::ValueVisitBase::VisitVarDecl(clang::VarDecl* var)
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitArraySubscriptExpr(
+    clang::ArraySubscriptExpr* expr)
 {
-    clang::FullSourceLoc fullLocation = Context.getFullLoc(var->getBeginLoc());
+    const auto* lhs = FindInfo(expr->getLHS());
+    const auto* index = FindInfo(expr->getIdx());
 
-    // if(!fullLocation.isValid())
-    //     return true;
+    if(!lhs || !lhs->Variable)
+        return true;
 
-    if(clang::dyn_cast<clang::ParmVarDecl>(var))
+    SMACPP_LOG(Debug, Parse, "found array access for variable: " << lhs->Variable->Dump());
+
+    if(!index || !index->Literal) {
+        SMACPP_LOG(Debug, Parse, "unknown array subscript index");
         return true;
+    }
 
-    // if(fullLocation.isInSystemHeader())
-    //     return true;
+    SMACPP_LOG(Debug, Parse, "used array index: " << *index->Literal);
 
-    VariableState state;
+    const auto indexValue = VariableState(PrimitiveInfo(*index->Literal));
 
-    const std::string varName = var->getQualifiedNameAsString();
-    const std::string varType = var->getType().getAsString();
+    Target.AddProcessedAction(GetCurrentCondition(),
+        action::ArrayIndexAccess{*lhs->Variable, indexValue},
+        Context.getFullLoc(expr->getBeginLoc()));
 
-    const auto* value = var->getAnyInitializer();
+    return true;
+}
 
-    if(Debug)
-        llvm::outs() << "local var: " << varType << " " << varName << " init: ";
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitCallExpr(clang::CallExpr* call)
+{
+    if(!call->getDirectCallee())
+        return true;
 
-    if(value) {
+    const auto functionName = GetLinkageQualifiedName(call->getDirectCallee());
 
-        if(value->getStmtClass() == clang::Stmt::StmtClass::StringLiteralClass) {
-            const auto* literal = static_cast<const clang::StringLiteral*>(value);
+    std::vector<VariableState> callParams;
+    callParams.reserve(call->getNumArgs());
 
-            if(Debug)
-                llvm::outs() << "string literal('" << literal->getBytes() << "')";
-            state.Set(BufferInfo(literal->getByteLength()));
+    for(size_t i = 0; i < call->getNumArgs(); ++i) {
+        const auto* arg = FindInfo(call->getArg(i));
+
+        if(arg && arg->Literal) {
+            callParams.emplace_back(PrimitiveInfo(*arg->Literal));
         } else {
-            if(Debug)
-                llvm::outs() << "unknown initializer type";
+            callParams.emplace_back();
         }
-    } else {
-        if(Debug)
-            llvm::outs() << "uninitialized";
     }
 
-    if(Debug)
-        llvm::outs() << "\n";
-
-    // var->dump();
-
-    // if(fullLocation.isValid())
-    //     llvm::outs() << "Found vardecl at " << fullLocation.getSpellingLineNumber()
-    //     <<
-    //     ":"
-    //                  << fullLocation.getSpellingColumnNumber() << "\n";
-    Target.AddProcessedAction(std::make_unique<action::VarDeclared>(
-                                  GetCurrentCondition(), VariableIdentifier(var), state),
-        fullLocation);
+    Target.AddProcessedAction(GetCurrentCondition(),
+        action::FunctionCall{functionName, std::move(callParams)},
+        Context.getFullLoc(call->getBeginLoc()));
 
     return true;
 }
+// ------------------------------------ //
+bool CodeBlockBuildingVisitor::FunctionVisitor::TraverseIfStmt(clang::IfStmt* stmt)
+{
+    // The parts before the branches are always executed, and visiting the condition stores
+    // its parsed form
+    if(!TraverseStmt(stmt->getInit()))
+        return false;
 
+    if(!TraverseStmt(stmt->getConditionVariableDeclStmt()))
+        return false;
+
+    if(!TraverseStmt(stmt->getCond()))
+        return false;
 
-bool CodeBlockBuildingVisitor::ValueVisitBase::TraverseIfStmt(clang::IfStmt* stmt)
-{
     Condition condition;
     Condition negated;
 
     try {
-        condition = Condition(stmt->getCond());
+        condition = ConditionFromExpr(stmt->getCond());
         negated = condition.Negate();
 
     } catch(const std::exception& e) {
-        llvm::outs() << "Failed to parse condition, exception: " << e.what() << "\n";
+        SMACPP_LOG(Info, Parse, "Failed to parse condition, exception: " << e.what());
         return true;
     }
 
-    if(Debug)
-        llvm::outs() << "Condition: " << condition.Dump() << "\n"
-                     << "Combined with current: "
-                     << GetCurrentCondition().And(condition).Dump() << "\n"
-                     << "Negated: " << negated.Dump() << "\n";
+    SMACPP_LOG(Debug, Parse,
+        "Condition: " << condition.Dump() << "\n"
+                      << "Combined with current: "
+                      << GetCurrentCondition().And(condition).Dump() << "\n"
+                      << "Negated: " << negated.Dump());
 
     if(!negated.IsAlwaysTrue()) {
-        ConditionalContentVisitor visitor(
-            GetCurrentCondition().And(condition), Context, Target, Debug);
-        visitor.TraverseStmt(stmt->getThen());
+        if(!TraverseConditional(stmt->getThen(), GetCurrentCondition().And(condition)))
+            return false;
     }
 
     if(!condition.IsAlwaysTrue()) {
-        ConditionalContentVisitor visitor(
-            GetCurrentCondition().And(negated), Context, Target, Debug);
-        visitor.TraverseStmt(stmt->getElse());
+        if(!TraverseConditional(stmt->getElse(), GetCurrentCondition().And(negated)))
+            return false;
     }
 
     return true;
 }
 
-bool CodeBlockBuildingVisitor::ValueVisitBase::TraverseSwitchStmt(clang::SwitchStmt* stmt)
+bool CodeBlockBuildingVisitor::FunctionVisitor::TraverseSwitchStmt(clang::SwitchStmt* stmt)
 {
-    std::optional<VariableIdentifier> var;
-    std::optional<VariableState> literal;
-
     if(stmt->getConditionVariable()) {
-
         // TODO: this needs to parse the initial value for the variable and add a state set
-        var = VariableIdentifier(stmt->getConditionVariable());
-
         return true;
-    } else if(stmt->getCond()) {
+    }
 
-        VariableRefOrArrayVisitor visitor(Debug);
-        visitor.TraverseStmt(stmt->getCond());
+    if(!TraverseStmt(stmt->getInit()) || !TraverseStmt(stmt->getCond()))
+        return false;
 
-        if(!visitor.FoundVar) {
+    const auto* info = FindInfo(stmt->getCond());
 
-            LiteralStateVisitor literalVisitor;
-            literalVisitor.TraverseStmt(stmt->getCond());
+    SwitchScope switchScope;
 
-            if(literalVisitor.FoundValue) {
-                llvm::outs() << "Switch with a literal value\n";
-                literal = literalVisitor.FoundValue;
-            } else {
+    if(info && info->Variable) {
+        switchScope.Variable = info->Variable;
 
-                llvm::outs() << "Could not find switch variable\n";
-                return true;
-            }
-        } else {
-
-            var = visitor.FoundVar;
-        }
+        SMACPP_LOG(Debug, Parse, "Traversing switch on variable: " << info->Variable->Dump());
 
+    } else if(info && info->Literal) {
+        SMACPP_LOG(Debug, Parse, "Switch with a literal value");
+        switchScope.Constant = VariableState(PrimitiveInfo(*info->Literal));
     } else {
-        if(Debug)
-            llvm::outs() << "Switch has no variable we can understand\n";
+        SMACPP_LOG(Info, Parse, "Could not find switch variable");
+        return true;
     }
 
-    if(Debug)
-        llvm::outs() << "Traversing switch on variable: " << var->Dump() << "\n";
-
-    CaseConditionalVisitor visitor =
-        var ? CaseConditionalVisitor(GetCurrentCondition(), *var, Context, Target, Debug) :
-              CaseConditionalVisitor(GetCurrentCondition(), *literal, Context, Target, Debug);
-    visitor.TraverseStmt(stmt->getBody());
+    Scopes.push_back(ConditionScope{GetCurrentCondition(), std::move(switchScope)});
+    const bool result = TraverseStmt(stmt->getBody());
+    Scopes.pop_back();
 
-    return true;
+    return result;
 }
 
-bool CodeBlockBuildingVisitor::ValueVisitBase::VisitArraySubscriptExpr(
-    clang::ArraySubscriptExpr* expr)
+bool CodeBlockBuildingVisitor::FunctionVisitor::TraverseCaseStmt(clang::CaseStmt* stmt)
 {
-    const auto* index = expr->getIdx();
-
-    if(!index)
-        return true;
-
-    VariableRefOrArrayVisitor lhsVisitor(Debug);
-    lhsVisitor.TraverseStmt(expr->getLHS());
-
-    if(!lhsVisitor.FoundVar)
-        return true;
-
-    if(Debug)
-        llvm::outs() << "found array access for variable: " << lhsVisitor.FoundVar->Dump()
-                     << "\n";
-
-    VariableState indexValue;
-
-    if(index->getStmtClass() == clang::Stmt::StmtClass::IntegerLiteralClass) {
-        const auto* literal = static_cast<const clang::IntegerLiteral*>(index);
+    if(!TraverseStmt(stmt->getLHS()))
+        return false;
+
+    auto* switchScope = GetInnermostSwitch();
+    const auto* value = FindInfo(stmt->getLHS());
+
+    if(!switchScope) {
+        // Case labels nested in other statements are not handled
+    } else if(!value || !value->Literal) {
+        if(SMACPP_LOG_ENABLED(Debug, Parse) && stmt->getLHS()) {
+            LogMessage message(LOG_LEVEL::Debug, LOG_CATEGORY::Parse);
+            message.Stream() << "Could not parse switch case value:\n";
+            stmt->getLHS()->dump(message.Stream(), Context);
+        }
+    } else {
+        const auto range =
+            ValueRange(COMPARISON::EQUAL, VariableState(PrimitiveInfo(*value->Literal)));
 
-        if(Debug)
-            llvm::outs() << "used array index: " << literal->getValue() << "\n";
+        Condition newCondition(switchScope->Constant ?
+                                   Condition::Part(VariableStateCondition(
+                                       *switchScope->Constant, range)) :
+                                   Condition::Part(VariableValueCondition(
+                                       *switchScope->Variable, range)));
 
-        // TODO: this can only handle 64 bit numbers, anything higher will cause an error
-        indexValue.Set(PrimitiveInfo(literal->getValue().getSExtValue()));
+        switchScope->Cases.push_back(newCondition);
 
-    } else {
-        if(Debug)
-            llvm::outs() << "unknown array subscript index\n";
-    }
+        if(switchScope->CurrentCase.IsAlwaysTrue()) {
+            switchScope->CurrentCase = newCondition;
+        } else {
+            switchScope->CurrentCase = switchScope->CurrentCase.Or(newCondition);
+        }
 
-    if(indexValue.State != VariableState::STATE::Unknown) {
-        Target.AddProcessedAction(std::make_unique<action::ArrayIndexAccess>(
-                                      GetCurrentCondition(), *lhsVisitor.FoundVar, indexValue),
-            Context.getFullLoc(expr->getBeginLoc()));
+        SMACPP_LOG(Debug, Parse,
+            "Current switch condition is: " << switchScope->CurrentCase.Dump());
     }
 
-    return true;
+    return TraverseStmt(stmt->getSubStmt());
 }
 
-bool CodeBlockBuildingVisitor::ValueVisitBase::VisitBinaryOperator(clang::BinaryOperator* op)
+bool CodeBlockBuildingVisitor::FunctionVisitor::TraverseDefaultStmt(clang::DefaultStmt* stmt)
 {
-    if(clang::BO_Assign != op->getOpcode())
-        return true;
+    // TODO: this only works correctly if the default statement is last
+    if(auto* switchScope = GetInnermostSwitch(); switchScope) {
 
-    // if(Debug) {
-    //     llvm::outs() << "Assignment statement found: ";
-    //     op->dump();
-    // }
-
-    VariableRefOrArrayVisitor lhsVisitor(Debug);
-    lhsVisitor.TraverseStmt(op->getLHS());
+        Condition defaultCondition;
 
-    if(!lhsVisitor.FoundVar)
-        return true;
+        for(const auto& cond : switchScope->Cases) {
+            if(defaultCondition.IsAlwaysTrue()) {
+                defaultCondition = cond.Negate();
+            } else {
+                defaultCondition = defaultCondition.And(cond.Negate());
+            }
+        }
 
-    ComplexExpressionParser rhsVisitor(Debug);
-    rhsVisitor.TraverseStmt(op->getRHS());
+        if(defaultCondition.IsAlwaysTrue())
+            SMACPP_LOG(Debug, Parse, "default condition is always true");
 
-    if(!rhsVisitor.ParsedState) {
-        // Assign from literal
-        LiteralStateVisitor literalVisitor;
-        literalVisitor.TraverseStmt(op->getRHS());
+        if(switchScope->CurrentCase.IsAlwaysTrue()) {
+            switchScope->CurrentCase = defaultCondition;
+        } else {
+            switchScope->CurrentCase = switchScope->CurrentCase.Or(defaultCondition);
+        }
 
-        if(literalVisitor.FoundValue)
-            rhsVisitor.ParsedState = literalVisitor.FoundValue;
+        SMACPP_LOG(Debug, Parse,
+            "Default switch case condition is: " << switchScope->CurrentCase.Dump());
     }
 
-    // Simple variable to variable assign
-    if(rhsVisitor.ParsedState) {
-        if(Debug)
-            llvm::outs() << "Assignment found: " << lhsVisitor.FoundVar->Dump() << " = "
-                         << rhsVisitor.ParsedState->Dump() << "\n";
+    return TraverseStmt(stmt->getSubStmt());
+}
 
-        // TODO: the location here is not fully accurate, the sub visitor needs to store the
-        // accurate location
-        Target.AddProcessedAction(std::make_unique<action::VarAssigned>(GetCurrentCondition(),
-                                      *lhsVisitor.FoundVar, *rhsVisitor.ParsedState),
-            Context.getFullLoc(op->getBeginLoc()));
+bool CodeBlockBuildingVisitor::FunctionVisitor::VisitBreakStmt(clang::BreakStmt* stmt)
+{
+    // TODO: this needs to detect if there is a loop inside this case statement or not
+    if(auto* switchScope = GetInnermostSwitch(); switchScope) {
+        switchScope->CurrentCase = Condition();
+
+        SMACPP_LOG(Debug, Parse, "Hit case break");
     }
+
     return true;
 }
-
-bool CodeBlockBuildingVisitor::ValueVisitBase::TraverseCallExpr(clang::CallExpr* call)
+// ------------------------------------ //
+Condition CodeBlockBuildingVisitor::FunctionVisitor::GetCurrentCondition() const
 {
-    if(!call->getDirectCallee())
-        return true;
+    if(Scopes.empty())
+        return Condition();
 
-    const auto functionName = call->getDirectCallee()->getQualifiedNameAsString();
+    const auto& scope = Scopes.back();
 
-    // llvm::outs() << "func call: " << functionName << "\n";
+    if(scope.Switch)
+        return scope.Base.And(scope.Switch->CurrentCase);
 
-    // llvm::outs() << "arg count: " <<  << "\n";
+    return scope.Base;
+}
 
-    std::vector<VariableState> callParams;
+Condition CodeBlockBuildingVisitor::FunctionVisitor::ConditionFromExpr(
+    const clang::Expr* expr) const
+{
+    const auto* info = FindInfo(expr);
 
-    for(size_t i = 0; i < call->getNumArgs(); ++i) {
-        clang::Expr* arg = call->getArg(i);
+    if(!info || !info->ConditionPart)
+        return Condition();
 
-        // llvm::outs() << "visiting arg(" << i << "): ";
-        // arg->dump();
-        LiteralStateVisitor visitor;
-        visitor.TraverseStmt(arg);
+    return Condition(*info->ConditionPart);
+}
 
-        if(visitor.FoundValue) {
-            callParams.push_back(*visitor.FoundValue);
-        } else {
-            callParams.push_back(VariableState());
-        }
-    }
+bool CodeBlockBuildingVisitor::FunctionVisitor::TraverseConditional(
+    clang::Stmt* stmt, const Condition& condition)
+{
+    if(!stmt)
+        return true;
 
-    Target.AddProcessedAction(std::make_unique<action::FunctionCall>(
-                                  GetCurrentCondition(), functionName, callParams),
-        Context.getFullLoc(call->getBeginLoc()));
+    Scopes.push_back(ConditionScope{condition, std::nullopt});
+    const bool result = TraverseStmt(stmt);
+    Scopes.pop_back();
 
-    return true;
+    return result;
 }
 // ------------------------------------ //
 // CodeBlockBuildingVisitor
 CodeBlockBuildingVisitor::CodeBlockBuildingVisitor(
-    clang::ASTContext& context, BlockRegistry& registry, bool debug) :
+    clang::ASTContext& context, BlockRegistry& registry) :
     Context(context),
-    Registry(registry), Debug(debug)
+    Registry(registry)
 {}
 // ------------------------------------ //
 bool CodeBlockBuildingVisitor::TraverseFunctionDecl(clang::FunctionDecl* fun)
 {
-    CodeBlock block(fun->getQualifiedNameAsString(), Context.getFullLoc(fun->getBeginLoc()));
+    // The conditions built while visiting are also put in the arena, the temporary ones
+    // are freed along with the lowered ones
+    ArenaScope arenaScope(Registry.GetArena());
+
+    CodeBlock block(GetLinkageQualifiedName(fun), Context.getFullLoc(fun->getBeginLoc()),
+        &Registry.GetArena());
+    TraceScope trace("lowering", block.GetName());
     // This is split in two to easily detect the function end
 
-    FunctionVisitor Visitor(Context, block, Debug);
+    FunctionVisitor Visitor(Context, block);
     Visitor.TraverseDecl(fun);
 
-    if(Debug)
-        llvm::outs() << "completed block: " << block.Dump() << "\n";
+    SMACPP_LOG(Debug, Parse, "completed block: " << block.Dump());
+
+    Statistics::Add(STAT_COUNTER::FunctionsLowered);
+    Statistics::Add(STAT_COUNTER::ActionsLowered, block.GetActions().size());
 
     Registry.AddBlock(std::move(block));
     return true;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CodeBlock.h"
+#include "Logging.h"
 
 #include "clang/AST/RecursiveASTVisitor.h"
 
@@ -11,61 +12,32 @@ class BlockRegistry;
 //! Creates CodeBlock from AST and stores them for overall program analysis
 class CodeBlockBuildingVisitor : public clang::RecursiveASTVisitor<CodeBlockBuildingVisitor> {
 
-    //! \brief Looks for a variable reference or an array subscript to a variable
-    class VariableRefOrArrayVisitor;
-
-    class ValueVisitBase {
-    public:
-        ValueVisitBase(clang::ASTContext& context, CodeBlock& target, bool debug);
-
-        bool VisitVarDecl(clang::VarDecl* var);
-
-        bool TraverseIfStmt(clang::IfStmt* stmt);
-
-        bool TraverseSwitchStmt(clang::SwitchStmt* stmt);
-
-        bool VisitArraySubscriptExpr(clang::ArraySubscriptExpr* expr);
-
-        bool VisitBinaryOperator(clang::BinaryOperator* op);
-
-        bool TraverseCallExpr(clang::CallExpr* call);
-
-        virtual Condition GetCurrentCondition() const
-        {
-            return Condition();
-        }
-
-    protected:
-        clang::ASTContext& Context;
-
-        CodeBlock& Target;
-
-        bool Debug;
-    };
-
-    //! \brief Visits stuff under an if statement to take conditions into account
-    class ConditionalContentVisitor;
-
-    //! \brief Conditional visitor that handles applying case conditions
-    class CaseConditionalVisitor;
-
     //! \brief Builds a code block from a function definition
+    //!
+    //! The function is walked only once in post-order. Results for sub expressions
+    //! (variables, literals, values and conditions) are stored when they are visited so
+    //! that the parent expressions can combine them without traversing their children again
     class FunctionVisitor;
 
 public:
-    CodeBlockBuildingVisitor(clang::ASTContext& context, BlockRegistry& registry, bool debug);
+    CodeBlockBuildingVisitor(clang::ASTContext& context, BlockRegistry& registry);
 
     // TODO: remove, example code
     bool VisitCXXRecordDecl(clang::CXXRecordDecl* Declaration)
     {
+        if(!SMACPP_LOG_ENABLED(Debug, Parse))
+            return true;
+
         // For debugging, dumping the AST nodes will show which nodes are already
         // being visited.
-        Declaration->dump();
+        LogMessage message(LOG_LEVEL::Debug, LOG_CATEGORY::Parse);
 
         clang::FullSourceLoc fullLocation = Context.getFullLoc(Declaration->getBeginLoc());
         if(fullLocation.isValid())
-            llvm::outs() << "Found declaration at " << fullLocation.getSpellingLineNumber()
-                         << ":" << fullLocation.getSpellingColumnNumber() << "\n";
+            message.Stream() << "Found declaration at " << fullLocation.getSpellingLineNumber()
+                             << ":" << fullLocation.getSpellingColumnNumber() << "\n";
+
+        Declaration->dump(message.Stream());
 
         // The return value indicates whether we want the visitation to proceed.
         // Return false to stop the traversal of the AST.
@@ -78,7 +50,6 @@ public:
 private:
     clang::ASTContext& Context;
     BlockRegistry& Registry;
-    bool Debug;
 };
 
 } // namespace smacpp
@@ -0,0 +1,252 @@
+// ------------------------------------ //
+#include "CompiledCondition.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace smacpp;
+// ------------------------------------ //
+namespace {
+
+TRI_BOOL And(TRI_BOOL lhs, TRI_BOOL rhs)
+{
+    if(lhs == TRI_BOOL::False || rhs == TRI_BOOL::False)
+        return TRI_BOOL::False;
+
+    if(lhs == TRI_BOOL::Unknown || rhs == TRI_BOOL::Unknown)
+        return TRI_BOOL::Unknown;
+
+    return TRI_BOOL::True;
+}
+
+TRI_BOOL Or(TRI_BOOL lhs, TRI_BOOL rhs)
+{
+    if(lhs == TRI_BOOL::True || rhs == TRI_BOOL::True)
+        return TRI_BOOL::True;
+
+    if(lhs == TRI_BOOL::Unknown || rhs == TRI_BOOL::Unknown)
+        return TRI_BOOL::Unknown;
+
+    return TRI_BOOL::False;
+}
+
+TRI_BOOL FromBool(bool value)
+{
+    return value ? TRI_BOOL::True : TRI_BOOL::False;
+}
+
+//! \brief Compares resolved values, comparisons of intervals may not be decidable
+TRI_BOOL Compare(const VariableState& lhs, COMPARISON op, const VariableState& rhs)
+{
+    if(lhs.State != VariableState::STATE::Interval &&
+        rhs.State != VariableState::STATE::Interval)
+        return FromBool(lhs.CompareTo(op, rhs));
+
+    const auto first = IntervalInfo::FromState(lhs);
+    const auto second = IntervalInfo::FromState(rhs);
+
+    if(!first || !second)
+        return TRI_BOOL::Unknown;
+
+    const auto result = first->CompareTo(op, *second);
+
+    if(!result)
+        return TRI_BOOL::Unknown;
+
+    return FromBool(*result);
+}
+
+//! Conditions deeper than this use a heap allocated stack
+constexpr size_t INLINE_STACK_SIZE = 16;
+
+} // namespace
+// ------------------------------------ //
+// CompiledCondition
+CompiledCondition::CompiledCondition(
+    const Condition& condition, llvm::BumpPtrAllocator* arena) :
+    Code(arena),
+    Tests(arena)
+{
+    if(condition.IsAlwaysTrue()) {
+        Code.push_back(Instruction{OPCODE::True, 0});
+        MaxStackDepth = 1;
+    } else if(!condition.GetParts()) {
+        Code.push_back(Instruction{OPCODE::False, 0});
+        MaxStackDepth = 1;
+    } else {
+        CompilePart(*condition.GetParts(), 1);
+    }
+}
+// ------------------------------------ //
+void CompiledCondition::CompilePart(const Condition::Part& part, size_t depth)
+{
+    MaxStackDepth = std::max(MaxStackDepth, depth);
+
+    if(auto value = std::get_if<VariableValueCondition>(&part.Value); value) {
+
+        Code.push_back(Instruction{OPCODE::Test, static_cast<uint32_t>(Tests.size())});
+        Tests.push_back(Test{value->Variable, std::nullopt, value->Value});
+
+    } else if(auto value = std::get_if<VariableStateCondition>(&part.Value); value) {
+
+        Code.push_back(Instruction{OPCODE::Test, static_cast<uint32_t>(Tests.size())});
+        Tests.push_back(Test{std::nullopt, value->State, value->Value});
+
+    } else if(auto combined = std::get_if<Condition::Part::CombinedParts>(&part.Value);
+              combined) {
+
+        CompilePart(*std::get<0>(*combined), depth);
+        CompilePart(*std::get<2>(*combined), depth + 1);
+
+        Code.push_back(Instruction{
+            std::get<1>(*combined) == COMBINE_OPERATOR::And ? OPCODE::And : OPCODE::Or, 0});
+    }
+}
+// ------------------------------------ //
+TRI_BOOL CompiledCondition::Evaluate(
+    const VariableValueProvider& values, const TestAssumptions* assumptions) const
+{
+    std::array<TRI_BOOL, INLINE_STACK_SIZE> inlineStack;
+    std::vector<TRI_BOOL> heapStack;
+
+    TRI_BOOL* stack = inlineStack.data();
+
+    if(MaxStackDepth > INLINE_STACK_SIZE) {
+        heapStack.resize(MaxStackDepth);
+        stack = heapStack.data();
+    }
+
+    size_t top = 0;
+
+    for(const auto& instruction : Code) {
+        switch(instruction.Operation) {
+        case OPCODE::True: stack[top++] = TRI_BOOL::True; break;
+        case OPCODE::False: stack[top++] = TRI_BOOL::False; break;
+        case OPCODE::Test:
+            stack[top++] = EvaluateTest(Tests[instruction.Operand], values, assumptions);
+            break;
+        case OPCODE::And:
+            --top;
+            stack[top - 1] = ::And(stack[top - 1], stack[top]);
+            break;
+        case OPCODE::Or:
+            --top;
+            stack[top - 1] = ::Or(stack[top - 1], stack[top]);
+            break;
+        }
+    }
+
+    return stack[0];
+}
+
+const CompiledCondition::Test* CompiledCondition::FindUnknownTest(
+    const VariableValueProvider& values, const TestAssumptions* assumptions) const
+{
+    for(const auto& test : Tests) {
+        if(EvaluateTest(test, values, assumptions) == TRI_BOOL::Unknown)
+            return &test;
+    }
+
+    return nullptr;
+}
+
+TRI_BOOL CompiledCondition::EvaluateTest(const Test& test, const VariableValueProvider& values,
+    const TestAssumptions* assumptions) const
+{
+    const auto value = test.Variable ? values.GetVariableValue(*test.Variable) :
+                                       test.State->Resolve(values);
+
+    const auto result = MatchRange(value, test.Range, values);
+
+    if(result == TRI_BOOL::Unknown && assumptions)
+        return assumptions->Find(test);
+
+    return result;
+}
+// ------------------------------------ //
+TRI_BOOL CompiledCondition::MatchRange(const VariableState& resolved, const ValueRange& range,
+    const VariableValueProvider& values)
+{
+    if(resolved.State == VariableState::STATE::Unknown)
+        return TRI_BOOL::Unknown;
+
+    switch(range.Type) {
+    case ValueRange::RANGE_CLASS::NotZero:
+    case ValueRange::RANGE_CLASS::Zero: {
+        bool nonZero = false;
+
+        if(auto primitive = std::get_if<PrimitiveInfo>(&resolved.Value); primitive) {
+            nonZero = primitive->IsNonZero();
+        } else if(auto buffer = std::get_if<BufferInfo>(&resolved.Value); buffer) {
+            nonZero = !buffer->NullPtr;
+        } else if(auto interval = std::get_if<IntervalInfo>(&resolved.Value); interval) {
+            // Single values are stored as primitives so this can't be only zero
+            if(interval->Contains(0))
+                return TRI_BOOL::Unknown;
+
+            nonZero = true;
+        } else {
+            return TRI_BOOL::Unknown;
+        }
+
+        return FromBool(nonZero == (range.Type == ValueRange::RANGE_CLASS::NotZero));
+    }
+    case ValueRange::RANGE_CLASS::Comparison: {
+        const auto other = values.GetVariableValue(*range.ComparedTo);
+
+        if(other.State == VariableState::STATE::Unknown)
+            return TRI_BOOL::Unknown;
+
+        return Compare(resolved, range.Comparison, other);
+    }
+    case ValueRange::RANGE_CLASS::Constant:
+        if(range.ComparedConstant->State == VariableState::STATE::Unknown)
+            return TRI_BOOL::Unknown;
+
+        return Compare(resolved, range.Comparison, *range.ComparedConstant);
+    }
+
+    return TRI_BOOL::Unknown;
+}
+// ------------------------------------ //
+// TestAssumptions
+void TestAssumptions::Add(const CompiledCondition::Test& test, bool outcome)
+{
+    Assumed.emplace_back(test, outcome);
+
+    auto negated = test;
+    negated.Range = test.Range.Negate();
+    Assumed.emplace_back(std::move(negated), !outcome);
+}
+
+TRI_BOOL TestAssumptions::Find(const CompiledCondition::Test& test) const
+{
+    for(const auto& [assumed, outcome] : Assumed) {
+        if(assumed == test)
+            return FromBool(outcome);
+    }
+
+    return TRI_BOOL::Unknown;
+}
+
+void TestAssumptions::Forget(const VariableIdentifier& variable)
+{
+    // Tests on computed states can refer to any variable so those are always removed
+    Assumed.erase(std::remove_if(Assumed.begin(), Assumed.end(),
+                      [&](const auto& assumption) {
+                          const auto& test = std::get<0>(assumption);
+                          return !test.Variable || *test.Variable == variable ||
+                                 test.Range.ComparedTo == variable;
+                      }),
+        Assumed.end());
+}
+
+void TestAssumptions::Intersect(const TestAssumptions& other)
+{
+    Assumed.erase(std::remove_if(Assumed.begin(), Assumed.end(),
+                      [&](const auto& assumption) {
+                          return std::find(other.Assumed.begin(), other.Assumed.end(),
+                                     assumption) == other.Assumed.end();
+                      }),
+        Assumed.end());
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Condition.h"
+
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace smacpp {
+
+//! Result of evaluating a condition when some variable values may not be known
+enum class TRI_BOOL : uint8_t { False, True, Unknown };
+
+class TestAssumptions;
+
+//! \brief A Condition lowered to linear postfix code for fast evaluation
+//!
+//! The leaf comparisons are stored in a flat table and refer to variables by their interned
+//! id. Evaluation doesn't throw, comparisons involving values that can't be determined give
+//! TRI_BOOL::Unknown which is then combined with Kleene logic.
+class CompiledCondition {
+public:
+    enum class OPCODE : uint8_t {
+        //! Pushes true
+        True,
+        //! Pushes false
+        False,
+        //! Pushes the result of a leaf test, Operand is the index in Tests
+        Test,
+        //! Pops two values and pushes their combined result
+        And,
+        Or
+    };
+
+    struct Instruction {
+        OPCODE Operation;
+        uint32_t Operand;
+    };
+
+    //! A single VariableValueCondition or VariableStateCondition
+    struct Test {
+        //! Set for VariableValueCondition
+        std::optional<VariableIdentifier> Variable;
+        //! Set for VariableStateCondition
+        std::optional<VariableState> State;
+        ValueRange Range;
+
+        bool operator==(const Test& other) const
+        {
+            return Variable == other.Variable && State == other.State &&
+                   Range == other.Range;
+        }
+    };
+
+public:
+    //! \param arena If not null the compiled code is allocated from this
+    CompiledCondition(const Condition& condition, llvm::BumpPtrAllocator* arena = nullptr);
+
+    //! \param assumptions If given these are used for tests that can't be determined
+    TRI_BOOL Evaluate(const VariableValueProvider& values,
+        const TestAssumptions* assumptions = nullptr) const;
+
+    //! \returns The first test that can't be determined with values and assumptions, or
+    //! null if there isn't one
+    const Test* FindUnknownTest(
+        const VariableValueProvider& values, const TestAssumptions* assumptions) const;
+
+    //! \returns True if this matches without looking at any variables
+    bool IsAlwaysTrue() const
+    {
+        return Code.size() == 1 && Code[0].Operation == OPCODE::True;
+    }
+
+    //! \brief Checks if resolved is in range
+    static TRI_BOOL MatchRange(const VariableState& resolved, const ValueRange& range,
+        const VariableValueProvider& values);
+
+    const auto& GetCode() const
+    {
+        return Code;
+    }
+
+private:
+    void CompilePart(const Condition::Part& part, size_t depth);
+
+    TRI_BOOL EvaluateTest(const Test& test, const VariableValueProvider& values,
+        const TestAssumptions* assumptions) const;
+
+private:
+    ArenaVector<Instruction> Code;
+    ArenaVector<Test> Tests;
+
+    //! Number of values needed on the stack during evaluation
+    size_t MaxStackDepth = 0;
+};
+
+//! \brief Outcomes assumed for tests that could not be determined when the analysis was
+//! split to follow both outcomes
+class TestAssumptions {
+public:
+    //! \brief Assumes test has outcome, and so the negation of test the opposite
+    void Add(const CompiledCondition::Test& test, bool outcome);
+
+    //! \returns The assumed outcome or TRI_BOOL::Unknown if nothing is assumed about test
+    TRI_BOOL Find(const CompiledCondition::Test& test) const;
+
+    //! \brief Removes the assumptions that may depend on the value of variable, called
+    //! when it changes
+    void Forget(const VariableIdentifier& variable);
+
+    //! \brief Keeps only the assumptions that are also in other
+    void Intersect(const TestAssumptions& other);
+
+    void Clear()
+    {
+        Assumed.clear();
+    }
+
+private:
+    std::vector<std::tuple<CompiledCondition::Test, bool>> Assumed;
+};
+
+} // namespace smacpp
@@ -1,153 +1,10 @@
 // ------------------------------------ //
 #include "Condition.h"
 
-#include "LiteralStateVisitor.h"
-
-#include "clang/AST/RecursiveASTVisitor.h"
-
 #include <sstream>
 
 using namespace smacpp;
 // ------------------------------------ //
-class ConditionParseVisitor : public clang::RecursiveASTVisitor<ConditionParseVisitor> {
-public:
-    // FunctionVisitor(clang::ASTContext& context) : ValueVisitBase(context) {}
-
-    // No clue why traverse doesn't work here
-    bool VisitBinaryOperator(clang::BinaryOperator* op)
-    {
-        clang::Expr* lhs = op->getLHS();
-        clang::Expr* rhs = op->getRHS();
-
-        if(!lhs || !rhs)
-            return true;
-
-        if(op->getReferencedDeclOfCallee()) {
-            llvm::outs() << "binary operator has decl of callee, this is not handled: ";
-            llvm::outs() << "decl of callee: ";
-            op->getReferencedDeclOfCallee()->dump();
-            return true;
-        }
-
-        // llvm::outs() << "found operator ";
-        // llvm::outs() << "lhs: ";
-        // lhs->dump();
-        // llvm::outs() << "rhs: ";
-        // rhs->dump();
-
-        ConditionParseVisitor lhsVisitor;
-        lhsVisitor.TraverseStmt(lhs);
-
-        ConditionParseVisitor rhsVisitor;
-        rhsVisitor.TraverseStmt(rhs);
-
-        const auto lhsConstant = LiteralFromExpr(lhs);
-        const auto rhsConstant = LiteralFromExpr(rhs);
-
-        if((lhsVisitor.Variable || lhsConstant) && (rhsVisitor.Variable || rhsConstant)) {
-            std::optional<COMPARISON> translatedOp;
-
-            switch(op->getOpcode()) {
-            case clang::BO_LT: translatedOp = COMPARISON::LESS_THAN; break;
-            case clang::BO_LE: translatedOp = COMPARISON::LESS_THAN_EQUAL; break;
-            case clang::BO_GT: translatedOp = COMPARISON::GREATER_THAN; break;
-            case clang::BO_GE: translatedOp = COMPARISON::GREATER_THAN_EQUAL; break;
-            case clang::BO_EQ: translatedOp = COMPARISON::EQUAL; break;
-            case clang::BO_NE: translatedOp = COMPARISON::NOT_EQUAL; break;
-            case clang::BO_LAnd: {
-                llvm::outs() << "Condition binary and not implemented\n";
-                return true;
-            }
-            default:
-                llvm::outs() << "unknown binary operator opcode for two variables: "
-                             << op->getOpcode() << "\n";
-                return false;
-            }
-
-            if(!lhsVisitor.Variable) {
-
-                llvm::outs() << "TODO: implement constant comparing to a variable (only "
-                                "variable to constant comparison works)\n";
-                return false;
-            }
-
-            if(rhsVisitor.Variable) {
-                Parts = Condition::Part(VariableValueCondition(
-                    *lhsVisitor.Variable, ValueRange(*translatedOp, *rhsVisitor.Variable)));
-            } else {
-
-                Parts = Condition::Part(VariableValueCondition(
-                    *lhsVisitor.Variable, ValueRange(*translatedOp, *rhsConstant)));
-            }
-            return false;
-        }
-
-        llvm::outs() << "binary operator has lhs and rhs that couldn't be combined\n";
-
-        return true;
-    }
-
-    bool VisitImplicitCastExpr(clang::ImplicitCastExpr* expr)
-    {
-        switch(expr->getCastKind()) {
-        case clang::CK_FixedPointToBoolean:
-        case clang::CK_FloatingComplexToBoolean:
-        case clang::CK_FloatingToBoolean:
-        case clang::CK_IntegralComplexToBoolean:
-        case clang::CK_IntegralToBoolean:
-        case clang::CK_MemberPointerToBoolean:
-        case clang::CK_PointerToBoolean: {
-            ConditionParseVisitor subVisitor;
-            subVisitor.TraverseStmt(expr->getSubExpr());
-
-            if(!subVisitor.Variable) {
-                llvm::outs() << "could not find implicit cast referenced variable\n";
-                return false;
-            }
-
-            Parts = Condition::Part(VariableValueCondition(
-                *subVisitor.Variable, ValueRange(ValueRange::RANGE_CLASS::NotZero)));
-            return false;
-        }
-        default: return true;
-        }
-    }
-
-    bool VisitDeclRefExpr(clang::DeclRefExpr* ref)
-    {
-        if(clang::VarDecl* var = clang::dyn_cast<clang::VarDecl>(ref->getDecl()); var) {
-
-            if(Variable) {
-                llvm::outs() << "found multiple variables in condition, this should have been "
-                                "handled by a higher level visitor\n";
-            }
-
-            Variable = VariableIdentifier(var);
-        }
-
-        return true;
-    }
-
-    std::optional<VariableState> LiteralFromExpr(clang::Expr* expr)
-    {
-        LiteralStateVisitor visitor;
-        visitor.TraverseStmt(expr);
-
-        return visitor.FoundValue;
-    }
-
-    void CheckIfOnlyVariable()
-    {
-        if(!Parts && Variable) {
-            Parts = Condition::Part(VariableValueCondition(
-                *Variable, ValueRange(ValueRange::RANGE_CLASS::NotZero)));
-        }
-    }
-
-    std::optional<VariableIdentifier> Variable;
-    std::optional<Condition::Part> Parts;
-};
-// ------------------------------------ //
 // VariableValueCondition
 VariableValueCondition VariableValueCondition::Negate() const
 {
@@ -218,6 +75,22 @@ bool Condition::Part::Evaluate(const VariableValueProvider& values) const
     }
 }
 // ------------------------------------ //
+bool Condition::Part::operator==(const Part& other) const
+{
+    if(Value.index() != other.Value.index())
+        return false;
+
+    if(auto combined = std::get_if<CombinedParts>(&Value); combined) {
+        const auto& otherCombined = std::get<CombinedParts>(other.Value);
+
+        return std::get<1>(*combined) == std::get<1>(otherCombined) &&
+               *std::get<0>(*combined) == *std::get<0>(otherCombined) &&
+               *std::get<2>(*combined) == *std::get<2>(otherCombined);
+    }
+
+    return Value == other.Value;
+}
+
 Condition::Part Condition::Part::Negate() const
 {
     if(auto value = std::get_if<VariableValueCondition>(&Value); value) {
@@ -228,10 +101,10 @@ Condition::Part Condition::Part::Negate() const
 
         return Part(value->Negate());
 
-    } else if(auto combined = std::get_if<CombinedParts>(&Value); value) {
-        return Part(std::make_shared<Part>(std::get<0>(*combined)->Negate()),
+    } else if(auto combined = std::get_if<CombinedParts>(&Value); combined) {
+        return Part(Part::MakeShared(std::get<0>(*combined)->Negate()),
             NegateCombineOperator(std::get<1>(*combined)),
-            std::make_shared<Part>(std::get<2>(*combined)->Negate()));
+            Part::MakeShared(std::get<2>(*combined)->Negate()));
     } else {
         throw std::runtime_error("negate not implemented for this variant type");
     }
@@ -263,21 +136,6 @@ std::string Condition::Part::Dump() const
 }
 // ------------------------------------ //
 // Condition
-Condition::Condition(clang::Stmt* stmt)
-{
-    ConditionParseVisitor visitor;
-    visitor.TraverseStmt(stmt);
-    visitor.CheckIfOnlyVariable();
-
-    if(!visitor.Parts || visitor.Parts->DetectTautology()) {
-
-        Tautology = true;
-    } else {
-
-        VariableConditions = std::move(visitor.Parts);
-    }
-}
-
 Condition::Condition(const Part& part)
 {
     if(part.DetectTautology()) {
@@ -319,8 +177,8 @@ Condition Condition::And(const Condition& other) const
         return Condition(*other.VariableConditions);
     }
 
-    return Condition(Part(std::make_shared<Part>(*VariableConditions), COMBINE_OPERATOR::And,
-        std::make_shared<Part>(*other.VariableConditions)));
+    return Condition(Part(Part::MakeShared(*VariableConditions), COMBINE_OPERATOR::And,
+        Part::MakeShared(*other.VariableConditions)));
 }
 
 Condition Condition::Or(const Condition& other) const
@@ -331,8 +189,8 @@ Condition Condition::Or(const Condition& other) const
         return combined;
     }
 
-    return Condition(Part(std::make_shared<Part>(*VariableConditions), COMBINE_OPERATOR::Or,
-        std::make_shared<Part>(*other.VariableConditions)));
+    return Condition(Part(Part::MakeShared(*VariableConditions), COMBINE_OPERATOR::Or,
+        Part::MakeShared(*other.VariableConditions)));
 }
 // ------------------------------------ //
 std::string Condition::Dump() const
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Arena.h"
 #include "Variable.h"
 
 #include <clang/AST/Stmt.h>
@@ -24,6 +25,11 @@ public:
 
     std::string Dump() const;
 
+    bool operator==(const VariableValueCondition& other) const
+    {
+        return Variable == other.Variable && Value == other.Value;
+    }
+
     VariableIdentifier Variable;
     ValueRange Value;
 };
@@ -37,6 +43,11 @@ public:
 
     std::string Dump() const;
 
+    bool operator==(const VariableStateCondition& other) const
+    {
+        return State == other.State && Value == other.Value;
+    }
+
     VariableState State;
     ValueRange Value;
 };
@@ -85,6 +96,16 @@ public:
             Value(std::make_tuple(lhs, op, rhs))
         {}
 
+        //! \brief Moves part to shared storage for combining it with other parts
+        //!
+        //! The storage comes from the arena of the current ArenaScope if there is one. Copies
+        //! of the returned pointer (and of Conditions using it) must not outlive that arena
+        static std::shared_ptr<Part> MakeShared(Part part)
+        {
+            return std::allocate_shared<Part>(
+                ArenaAllocator<Part>(ArenaScope::GetCurrent()), std::move(part));
+        }
+
         bool Evaluate(const VariableValueProvider& values) const;
 
         //! \brief Tries to detect if this is always true
@@ -98,6 +119,9 @@ public:
 
         std::string Dump() const;
 
+        //! \brief Compares the structure of the parts, not just the pointers
+        bool operator==(const Part& other) const;
+
         //! shared_ptrs are used here to make copying work
         std::variant<VariableValueCondition, VariableStateCondition, CombinedParts> Value;
     };
@@ -108,8 +132,6 @@ public:
     //! Creates an always true condition
     Condition() : Tautology(true) {}
 
-    Condition(clang::Stmt* stmt);
-
     Condition(const Part& part);
 
     bool Evaluate(const VariableValueProvider& values) const;
@@ -131,6 +153,16 @@ public:
 
     std::string Dump() const;
 
+    bool operator==(const Condition& other) const
+    {
+        return Tautology == other.Tautology && VariableConditions == other.VariableConditions;
+    }
+
+    const auto& GetParts() const
+    {
+        return VariableConditions;
+    }
+
 private:
     //! \todo Add contradiction
     bool Tautology = false;
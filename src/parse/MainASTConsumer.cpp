@@ -2,7 +2,12 @@
 #include "MainASTConsumer.h"
 
 #include "CodeBlockBuildingVisitor.h"
+#include "Statistics.h"
+#include "Trace.h"
 #include "analysis/BlockRegistry.h"
+#include "serialization/CodeBlockSerializer.h"
+
+#include <fstream>
 
 using namespace smacpp;
 // ------------------------------------ //
@@ -13,25 +18,126 @@ void MainASTConsumer::HandleTranslationUnit(clang::ASTContext& Context)
     RegisterDiagnostics(de);
 
     BlockRegistry registry;
-    CodeBlockBuildingVisitor visitor(Context, registry, DebugPrint);
+    const VariableNameTable::Scope names(registry.GetNames());
+
+    {
+        PhaseTimer timer(STAT_PHASE::Lowering);
+        CodeBlockBuildingVisitor visitor(Context, registry);
+
+        // Traversing the translation unit decl via a RecursiveASTVisitor
+        // will visit all nodes in the AST.
+        visitor.TraverseDecl(Context.getTranslationUnitDecl());
+    }
+
+    const auto& sourceManager = Context.getSourceManager();
+    const auto resolver = CreatePositionResolver(sourceManager);
 
-    // Traversing the translation unit decl via a RecursiveASTVisitor
-    // will visit all nodes in the AST.
-    visitor.TraverseDecl(Context.getTranslationUnitDecl());
+    if(!SummaryOutput.empty()) {
+        PhaseTimer timer(STAT_PHASE::SummaryWriting);
+        WriteSummary(registry, resolver);
+    }
 
     // The traversal creates all the CodeBlocks in this TU
     // This analysis here can only find problems within this TU as it only has the current TU's
     // CodeBlocks loaded
-    const auto errors = registry.PerformAnalysis(DebugPrint);
-
-    for(const auto& error : errors) {
-        if(error.Severity == FoundProblem::SEVERITY::Error) {
-            de.Report(error.Location, SMACPPErrorId).AddString(error.Message);
-        } else {
-            // TODO: use the proper clang error output mechanism
-            llvm::errs() << "smacpp: " << error.FormatAsString() << "\n";
+    auto settings = Settings;
+
+    if(const auto* mainFile = sourceManager.getFileEntryForID(sourceManager.getMainFileID());
+        mainFile)
+        settings.ProgramName = mainFile->getName().str();
+
+    auto errors = registry.PerformAnalysis(settings, resolver);
+
+    if(Handler) {
+        Handler(std::move(errors));
+        return;
+    }
+
+    {
+        PhaseTimer timer(STAT_PHASE::Diagnostics);
+
+        for(const auto& error : errors) {
+            if(error.Severity == FoundProblem::SEVERITY::Error) {
+
+                const auto location = error.Location.isValid() ?
+                                          error.Location :
+                                          FindLocation(sourceManager, error.Position);
+
+                de.Report(location, SMACPPErrorId).AddString(error.Message);
+            } else {
+                // TODO: use the proper clang error output mechanism
+                llvm::errs() << "smacpp: " << error.FormatAsString() << "\n";
+            }
         }
     }
+
+    if(Statistics::IsEnabled())
+        WriteStatistics();
+
+    if(!TraceOutput.empty() && !Trace::WriteFile(TraceOutput))
+        llvm::errs() << "smacpp: failed to write trace file: " << TraceOutput << "\n";
+}
+// ------------------------------------ //
+void MainASTConsumer::WriteStatistics()
+{
+    if(StatsOutput.empty()) {
+        Statistics::Print(llvm::errs());
+        return;
+    }
+
+    std::error_code error;
+    llvm::raw_fd_ostream file(StatsOutput, error);
+
+    if(error) {
+        llvm::errs() << "smacpp: failed to write statistics file: " << StatsOutput << ": "
+                     << error.message() << "\n";
+        return;
+    }
+
+    Statistics::PrintJSON(file);
+}
+// ------------------------------------ //
+void MainASTConsumer::WriteSummary(
+    const BlockRegistry& registry, const PositionResolver& resolver)
+{
+    const auto data = SerializeBlockRegistry(registry, resolver);
+
+    std::ofstream file(SummaryOutput, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+
+    if(!file.good())
+        llvm::errs() << "smacpp: failed to write summary file: " << SummaryOutput << "\n";
+}
+// ------------------------------------ //
+PositionResolver MainASTConsumer::CreatePositionResolver(
+    const clang::SourceManager& sourceManager)
+{
+    return [&sourceManager](clang::SourceLocation location) {
+        SourcePosition position;
+        const auto presumed = sourceManager.getPresumedLoc(location);
+
+        if(presumed.isValid()) {
+            position.File = presumed.getFilename();
+            position.Line = presumed.getLine();
+            position.Column = presumed.getColumn();
+        }
+
+        return position;
+    };
+}
+
+clang::SourceLocation MainASTConsumer::FindLocation(
+    const clang::SourceManager& sourceManager, const SourcePosition& position)
+{
+    if(!position.IsValid())
+        return clang::SourceLocation{};
+
+    const auto file = sourceManager.getFileManager().getFile(position.File);
+
+    if(!file)
+        return clang::SourceLocation{};
+
+    return sourceManager.translateFileLineCol(*file, position.Line, position.Column);
 }
 // ------------------------------------ //
 void MainASTConsumer::RegisterDiagnostics(clang::DiagnosticsEngine& de)
@@ -1,21 +1,62 @@
 #pragma once
 
+#include "analysis/Analyzer.h"
+
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTConsumer.h"
 
+#include <functional>
+
 namespace smacpp {
 
+class BlockRegistry;
+
 class MainASTConsumer : public clang::ASTConsumer {
 public:
-    MainASTConsumer(bool debugPrint) : DebugPrint(debugPrint) {}
+    //! Receives the problems found in a TU instead of them being reported through clang
+    using ProblemHandler = std::function<void(std::vector<FoundProblem>&&)>;
+
+    //! \param summaryOutput If not empty the CodeBlocks are written to this file for whole
+    //! program analysis with smacpp-link
+    //! \param statsOutput When Statistics are enabled they are written as JSON to this file,
+    //! or printed to stderr if this is empty
+    //! \param traceOutput If not empty the Trace of this TU is written to this file
+    MainASTConsumer(const AnalysisSettings& settings, const std::string& summaryOutput = "",
+        const std::string& statsOutput = "", const std::string& traceOutput = "") :
+        Settings(settings),
+        SummaryOutput(summaryOutput), StatsOutput(statsOutput), TraceOutput(traceOutput)
+    {}
 
     virtual void HandleTranslationUnit(clang::ASTContext& Context);
 
+    //! \brief Makes the found problems go to handler instead of clang diagnostics
+    //!
+    //! Used when many TUs are analysed in one process so the caller takes care of the
+    //! Statistics and Trace, which are then not written by this
+    void SetProblemHandler(ProblemHandler handler)
+    {
+        Handler = std::move(handler);
+    }
+
 protected:
     void RegisterDiagnostics(clang::DiagnosticsEngine& de);
 
+    void WriteSummary(const BlockRegistry& registry, const PositionResolver& resolver);
+
+    void WriteStatistics();
+
+    static PositionResolver CreatePositionResolver(const clang::SourceManager& sourceManager);
+
+    //! \brief Finds the location for problems loaded from the result cache
+    static clang::SourceLocation FindLocation(
+        const clang::SourceManager& sourceManager, const SourcePosition& position);
+
 protected:
     unsigned SMACPPErrorId;
-    bool DebugPrint;
+    AnalysisSettings Settings;
+    std::string SummaryOutput;
+    std::string StatsOutput;
+    std::string TraceOutput;
+    ProblemHandler Handler;
 };
 } // namespace smacpp
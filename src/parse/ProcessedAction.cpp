@@ -1,65 +1,37 @@
 // ------------------------------------ //
 #include "ProcessedAction.h"
 
-#include "analysis/Analyzer.h"
-
 using namespace smacpp;
 using namespace smacpp::action;
 // ------------------------------------ //
 // ProcessedAction
 std::string ProcessedAction::Dump() const
 {
-    std::stringstream sstream;
-
-    sstream << If.Dump() << " ";
-
-    DumpSpecialized(sstream);
-
-    return sstream.str();
+    return std::visit([](const auto& action) { return action.Dump(); }, Value);
 }
 // ------------------------------------ //
 // VarDeclared
-void VarDeclared::Dispatch(AnalysisOperation& receiver) const
+std::string VarDeclared::Dump() const
 {
-    receiver.HandleAction(this);
+    return "VarDeclared " + Variable.Dump() + " value: " + State.Dump();
 }
-
-void VarDeclared::DumpSpecialized(std::stringstream& sstream) const
-{
-    sstream << "VarDeclared " << Variable.Dump() << " value: " << State.Dump();
-}
-
 // ------------------------------------ //
 // VarAssigned
-void VarAssigned::Dispatch(AnalysisOperation& receiver) const
-{
-    receiver.HandleAction(this);
-}
-
-void VarAssigned::DumpSpecialized(std::stringstream& sstream) const
+std::string VarAssigned::Dump() const
 {
-    sstream << "VarAssigned " << Variable.Dump() << " = " << State.Dump();
+    return "VarAssigned " + Variable.Dump() + " = " + State.Dump();
 }
 // ------------------------------------ //
 // ArrayIndexAccess
-void ArrayIndexAccess::Dispatch(AnalysisOperation& receiver) const
-{
-    receiver.HandleAction(this);
-}
-
-void ArrayIndexAccess::DumpSpecialized(std::stringstream& sstream) const
+std::string ArrayIndexAccess::Dump() const
 {
-    sstream << "ArrayIndexAccess " << Array.Dump() << "[" << Index.Dump() << "]";
+    return "ArrayIndexAccess " + Array.Dump() + "[" + Index.Dump() + "]";
 }
 // ------------------------------------ //
 // FunctionCall
-void FunctionCall::Dispatch(AnalysisOperation& receiver) const
-{
-    receiver.HandleAction(this);
-}
-
-void FunctionCall::DumpSpecialized(std::stringstream& sstream) const
+std::string FunctionCall::Dump() const
 {
+    std::stringstream sstream;
     sstream << "FunctionCall " << Function << "(";
 
     bool first = true;
@@ -72,4 +44,6 @@ void FunctionCall::DumpSpecialized(std::stringstream& sstream) const
         sstream << param.Dump();
     }
     sstream << ")";
+
+    return sstream.str();
 }
@@ -1,105 +1,68 @@
 #pragma once
 
 #include "Condition.h"
+#include "SourcePosition.h"
 #include "Variable.h"
 
 #include <sstream>
+#include <variant>
 
 namespace smacpp {
 
-class AnalysisOperation;
-
-//! \brief Some action the program takes that is relevant for static analysis
-class ProcessedAction {
-public:
-    ProcessedAction(Condition condition) : If(condition) {}
-    virtual ~ProcessedAction() = default;
-
-    virtual std::string Dump() const;
-
-    virtual void Dispatch(AnalysisOperation& receiver) const = 0;
-
-protected:
-    virtual void DumpSpecialized(std::stringstream& sstream) const = 0;
-
-public:
-    //! Action is taken when this condition is true
-    const Condition If;
-    //! This is not const to reduce the constructor param count
-    clang::SourceLocation Location;
-};
-
 namespace action {
-class VarDeclared : public ProcessedAction {
-public:
-    VarDeclared(Condition condition, VariableIdentifier var, VariableState state) :
-        ProcessedAction(condition), Variable(var), State(state)
-    {}
-
-    void Dispatch(AnalysisOperation& receiver) const override;
-
-protected:
-    void DumpSpecialized(std::stringstream& sstream) const override;
+struct VarDeclared {
+    std::string Dump() const;
 
-public:
-    const VariableIdentifier Variable;
-    const VariableState State;
+    VariableIdentifier Variable;
+    VariableState State;
 };
 
-class VarAssigned : public ProcessedAction {
-public:
-    VarAssigned(Condition condition, VariableIdentifier var, VariableState state) :
-        ProcessedAction(condition), Variable(var), State(state)
-    {}
-
-    void Dispatch(AnalysisOperation& receiver) const override;
-
-protected:
-    void DumpSpecialized(std::stringstream& sstream) const override;
+struct VarAssigned {
+    std::string Dump() const;
 
-public:
-    const VariableIdentifier Variable;
-    const VariableState State;
+    VariableIdentifier Variable;
+    VariableState State;
 };
 
 //! \brief Array index read that should be checked to be within the buffer size
-class ArrayIndexAccess : public ProcessedAction {
-public:
-    ArrayIndexAccess(Condition condition, VariableIdentifier array, VariableState index) :
-        ProcessedAction(condition), Array(array), Index(index)
-    {}
+struct ArrayIndexAccess {
+    std::string Dump() const;
 
-    void Dispatch(AnalysisOperation& receiver) const override;
+    VariableIdentifier Array;
+    VariableState Index;
+};
 
-protected:
-    void DumpSpecialized(std::stringstream& sstream) const override;
+struct FunctionCall {
+    std::string Dump() const;
 
-public:
-    const VariableIdentifier Array;
-    const VariableState Index;
+    std::string Function;
+    std::vector<VariableState> Params;
 };
+} // namespace action
 
-class FunctionCall : public ProcessedAction {
-public:
-    FunctionCall(Condition condition, const std::string& function,
-        const std::vector<VariableState>& params) :
-        ProcessedAction(condition),
-        Function(function), Params(params)
+//! \brief Some action the program takes that is relevant for static analysis
+//!
+//! Stored by value in CodeBlock so that the analysis can walk the actions of a function in
+//! contiguous memory. The condition is stored in CodeBlock as consecutive actions usually
+//! share the same condition.
+struct ProcessedAction {
+    using Data = std::variant<action::VarDeclared, action::VarAssigned,
+        action::ArrayIndexAccess, action::FunctionCall>;
+
+    ProcessedAction(Data value, uint32_t condition, clang::SourceLocation location) :
+        Value(std::move(value)), If(condition), Location(location)
     {}
 
-    void Dispatch(AnalysisOperation& receiver) const override;
-
-protected:
-    void DumpSpecialized(std::stringstream& sstream) const override;
-
-public:
-    const std::string Function;
-    const std::vector<VariableState> Params;
-};
+    //! \brief Dumps the action without its condition
+    std::string Dump() const;
 
+    Data Value;
 
+    //! Index of the condition in CodeBlock::GetConditions that needs to be true for this to
+    //! be taken
+    uint32_t If;
 
-}; // namespace action
-
+    clang::SourceLocation Location;
+};
 
 } // namespace smacpp
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <clang/Basic/SourceLocation.h>
+
+#include <functional>
+#include <string>
+
+namespace smacpp {
+
+//! \brief A location in a source file that stays meaningful outside the translation unit
+//! (and clang::SourceManager) it was found in
+struct SourcePosition {
+    bool IsValid() const
+    {
+        return Line != 0;
+    }
+
+    std::string Dump() const
+    {
+        return File + ":" + std::to_string(Line) + ":" + std::to_string(Column);
+    }
+
+    bool operator==(const SourcePosition& other) const
+    {
+        return Line == other.Line && Column == other.Column && File == other.File;
+    }
+
+    std::string File;
+    unsigned Line = 0;
+    unsigned Column = 0;
+};
+
+//! Converts clang locations to positions that stay valid outside the translation unit
+using PositionResolver = std::function<SourcePosition(clang::SourceLocation)>;
+
+} // namespace smacpp
@@ -3,15 +3,132 @@
 
 #include "parse/Condition.h"
 
+#include <clang/AST/ASTContext.h>
 #include <clang/AST/Decl.h>
+#include <clang/Basic/SourceManager.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 using namespace smacpp;
 // ------------------------------------ //
+// VariableNameTable
+namespace {
+
+thread_local VariableNameTable* CurrentNameTable = nullptr;
+
+} // namespace
+
+VariableNameTable::Scope::Scope(VariableNameTable& table) : Previous(CurrentNameTable)
+{
+    CurrentNameTable = &table;
+}
+
+VariableNameTable::Scope::~Scope()
+{
+    CurrentNameTable = Previous;
+}
+// ------------------------------------ //
+VariableNameTable& VariableNameTable::Get()
+{
+    if(CurrentNameTable)
+        return *CurrentNameTable;
+
+    static VariableNameTable table;
+    return table;
+}
+// ------------------------------------ //
+VariableNameTable::ID VariableNameTable::Intern(const std::string& name)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(Mutex);
+
+        const auto found = IDs.find(name);
+
+        if(found != IDs.end())
+            return found->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+
+    // Another thread may have added this between the locks
+    const auto [iter, inserted] = IDs.emplace(name, static_cast<ID>(Entries.size()));
+
+    if(inserted)
+        Entries.push_back(Entry{name});
+
+    return iter->second;
+}
+
+const std::string& VariableNameTable::GetName(ID id) const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+
+    if(id >= Entries.size())
+        throw std::runtime_error("VariableNameTable: invalid variable id");
+
+    return Entries[id].Name;
+}
+
+void VariableNameTable::MarkGlobal(ID id)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+
+    if(id >= Entries.size())
+        throw std::runtime_error("VariableNameTable: invalid variable id");
+
+    Entries[id].Global = true;
+}
+
+bool VariableNameTable::IsGlobal(ID id) const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return id < Entries.size() && Entries[id].Global;
+}
+
+size_t VariableNameTable::GetCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Entries.size();
+}
+// ------------------------------------ //
 // VariableIdentifier
+//! \brief Names locals (and parameters) after their function so that they can't be confused
+//! with a global or a local of another function that has the same name
+static std::string GetVariableName(const clang::VarDecl* var)
+{
+    if(var->isLocalVarDeclOrParm()) {
+        if(const auto* function =
+                clang::dyn_cast_or_null<clang::FunctionDecl>(var->getParentFunctionOrMethod());
+            function)
+            return GetLinkageQualifiedName(function) + "::" + var->getNameAsString();
+    }
+
+    return GetLinkageQualifiedName(var);
+}
+
 VariableIdentifier::VariableIdentifier(clang::VarDecl* var) :
-    Name(var->getQualifiedNameAsString())
+    VariableIdentifier(GetVariableName(var))
 {
-    // var->getGlobalID();
+    if(var->hasGlobalStorage())
+        VariableNameTable::Get().MarkGlobal(ID);
+}
+// ------------------------------------ //
+std::string smacpp::GetLinkageQualifiedName(const clang::NamedDecl* decl)
+{
+    auto name = decl->getQualifiedNameAsString();
+
+    if(decl->isExternallyVisible())
+        return name;
+
+    const auto& sourceManager = decl->getASTContext().getSourceManager();
+
+    if(const auto* mainFile = sourceManager.getFileEntryForID(sourceManager.getMainFileID());
+        mainFile)
+        name += "@" + mainFile->getName().str();
+
+    return name;
 }
 // ------------------------------------ //
 // BufferInfo
@@ -160,21 +277,269 @@ std::string PrimitiveInfo::Dump() const
     }
 }
 // ------------------------------------ //
+// IntervalInfo
+namespace {
+
+using Integer = IntervalInfo::Integer;
+
+Integer SaturatingAdd(Integer first, Integer second)
+{
+    Integer result;
+
+    if(__builtin_add_overflow(first, second, &result))
+        return second > 0 ? IntervalInfo::Unbounded : IntervalInfo::UnboundedBelow;
+
+    return result;
+}
+
+Integer SaturatingSubtract(Integer first, Integer second)
+{
+    Integer result;
+
+    if(__builtin_sub_overflow(first, second, &result))
+        return second < 0 ? IntervalInfo::Unbounded : IntervalInfo::UnboundedBelow;
+
+    return result;
+}
+
+Integer SaturatingMultiply(Integer first, Integer second)
+{
+    Integer result;
+
+    if(__builtin_mul_overflow(first, second, &result)) {
+        return (first < 0) != (second < 0) ? IntervalInfo::UnboundedBelow :
+                                             IntervalInfo::Unbounded;
+    }
+
+    return result;
+}
+
+} // namespace
+
+std::optional<IntervalInfo> IntervalInfo::FromState(const VariableState& state)
+{
+    if(auto interval = std::get_if<IntervalInfo>(&state.Value); interval)
+        return *interval;
+
+    if(auto primitive = std::get_if<PrimitiveInfo>(&state.Value); primitive) {
+        // Fractions can't be represented
+        if(std::holds_alternative<double>(primitive->Value))
+            return {};
+
+        return IntervalInfo(primitive->AsInteger(), primitive->AsInteger());
+    }
+
+    return {};
+}
+// ------------------------------------ //
+IntervalInfo IntervalInfo::Join(const IntervalInfo& other) const
+{
+    return IntervalInfo(std::min(Min, other.Min), std::max(Max, other.Max));
+}
+
+std::optional<IntervalInfo> IntervalInfo::Meet(const IntervalInfo& other) const
+{
+    const auto min = std::max(Min, other.Min);
+    const auto max = std::min(Max, other.Max);
+
+    if(min > max)
+        return {};
+
+    return IntervalInfo(min, max);
+}
+
+std::optional<IntervalInfo> IntervalInfo::Restrict(COMPARISON op, Integer constant) const
+{
+    switch(op) {
+    case COMPARISON::LESS_THAN:
+        if(constant == UnboundedBelow)
+            return {};
+        return Meet(IntervalInfo(UnboundedBelow, constant - 1));
+    case COMPARISON::LESS_THAN_EQUAL: return Meet(IntervalInfo(UnboundedBelow, constant));
+    case COMPARISON::GREATER_THAN:
+        if(constant == Unbounded)
+            return {};
+        return Meet(IntervalInfo(constant + 1, Unbounded));
+    case COMPARISON::GREATER_THAN_EQUAL: return Meet(IntervalInfo(constant, Unbounded));
+    case COMPARISON::EQUAL: return Meet(IntervalInfo(constant, constant));
+    case COMPARISON::NOT_EQUAL:
+        // Only the ends can be cut off
+        if(IsSingleValue())
+            return constant == Min ? std::optional<IntervalInfo>{} : *this;
+        if(constant == Min)
+            return IntervalInfo(Min + 1, Max);
+        if(constant == Max)
+            return IntervalInfo(Min, Max - 1);
+        return *this;
+    }
+
+    throw std::runtime_error("unhandled COMPARISON in IntervalInfo");
+}
+
+IntervalInfo IntervalInfo::Widen(const IntervalInfo& next) const
+{
+    return IntervalInfo(
+        next.Min < Min ? UnboundedBelow : Min, next.Max > Max ? Unbounded : Max);
+}
+// ------------------------------------ //
+std::optional<bool> IntervalInfo::CompareTo(COMPARISON op, const IntervalInfo& other) const
+{
+    switch(op) {
+    case COMPARISON::LESS_THAN:
+        if(Max < other.Min)
+            return true;
+        if(Min >= other.Max)
+            return false;
+        return {};
+    case COMPARISON::LESS_THAN_EQUAL:
+        if(Max <= other.Min)
+            return true;
+        if(Min > other.Max)
+            return false;
+        return {};
+    case COMPARISON::GREATER_THAN: return other.CompareTo(COMPARISON::LESS_THAN, *this);
+    case COMPARISON::GREATER_THAN_EQUAL:
+        return other.CompareTo(COMPARISON::LESS_THAN_EQUAL, *this);
+    case COMPARISON::EQUAL:
+        if(!Meet(other))
+            return false;
+        if(IsSingleValue() && *this == other)
+            return true;
+        return {};
+    case COMPARISON::NOT_EQUAL: {
+        const auto equal = CompareTo(COMPARISON::EQUAL, other);
+
+        if(!equal)
+            return {};
+
+        return !*equal;
+    }
+    }
+
+    throw std::runtime_error("unhandled COMPARISON in IntervalInfo");
+}
+
+IntervalInfo IntervalInfo::ApplyOperator(OPERATOR op, const IntervalInfo& other) const
+{
+    switch(op) {
+    case OPERATOR::Add:
+        return IntervalInfo(
+            Min == UnboundedBelow || other.Min == UnboundedBelow ?
+                UnboundedBelow :
+                SaturatingAdd(Min, other.Min),
+            Max == Unbounded || other.Max == Unbounded ? Unbounded :
+                                                         SaturatingAdd(Max, other.Max));
+    case OPERATOR::Subtract:
+        return IntervalInfo(
+            Min == UnboundedBelow || other.Max == Unbounded ?
+                UnboundedBelow :
+                SaturatingSubtract(Min, other.Max),
+            Max == Unbounded || other.Min == UnboundedBelow ?
+                Unbounded :
+                SaturatingSubtract(Max, other.Min));
+    case OPERATOR::Multiply: {
+        if(Min == UnboundedBelow || Max == Unbounded || other.Min == UnboundedBelow ||
+            other.Max == Unbounded)
+            return IntervalInfo(UnboundedBelow, Unbounded);
+
+        const Integer products[] = {SaturatingMultiply(Min, other.Min),
+            SaturatingMultiply(Min, other.Max), SaturatingMultiply(Max, other.Min),
+            SaturatingMultiply(Max, other.Max)};
+
+        return IntervalInfo(*std::min_element(std::begin(products), std::end(products)),
+            *std::max_element(std::begin(products), std::end(products)));
+    }
+    }
+
+    throw std::runtime_error("unhandled OPERATOR in IntervalInfo");
+}
+// ------------------------------------ //
+std::string IntervalInfo::Dump() const
+{
+    return "[" + (Min == UnboundedBelow ? std::string("-inf") : std::to_string(Min)) + ", " +
+           (Max == Unbounded ? std::string("inf") : std::to_string(Max)) + "]";
+}
+// ------------------------------------ //
 // VarCopyInfo
 std::string VarCopyInfo::Dump() const
 {
     return "assign from " + Source.Dump();
 }
 // ------------------------------------ //
+// ComputeNodeTable
+namespace {
+
+//! \brief Keeps track of the alive ComputeNodes in order to share identical ones
+class ComputeNodeTable {
+public:
+    static ComputeNodeTable& Get()
+    {
+        static ComputeNodeTable table;
+        return table;
+    }
+
+    std::shared_ptr<const ComputeNode> Intern(
+        OPERATOR op, const VariableState& lhs, const VariableState& rhs)
+    {
+        // The child hashes are cached in their nodes so this doesn't recurse
+        const auto hash = std::hash<VariableState>()(lhs) ^
+                          ::rotateLeft(std::hash<VariableState>()(rhs), 1) ^
+                          ::rotateLeft(std::hash<OPERATOR>()(op), 2);
+
+        std::lock_guard<std::mutex> lock(Mutex);
+
+        const auto range = Nodes.equal_range(hash);
+
+        for(auto iter = range.first; iter != range.second; ++iter) {
+
+            // Children are interned already so comparing them is shallow
+            const auto existing = iter->second.lock();
+
+            if(existing && existing->Operation == op && existing->LHS == lhs &&
+                existing->RHS == rhs)
+                return existing;
+        }
+
+        if(Nodes.size() >= NextCleanup) {
+            RemoveExpired();
+            NextCleanup = std::max<size_t>(Nodes.size() * 2, MinimumCleanup);
+        }
+
+        auto node = std::make_shared<const ComputeNode>(op, lhs, rhs, hash);
+        Nodes.emplace(hash, node);
+        return node;
+    }
+
+private:
+    void RemoveExpired()
+    {
+        for(auto iter = Nodes.begin(); iter != Nodes.end();) {
+            if(iter->second.expired()) {
+                iter = Nodes.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t MinimumCleanup = 1024;
+
+    std::mutex Mutex;
+    std::unordered_multimap<size_t, std::weak_ptr<const ComputeNode>> Nodes;
+    size_t NextCleanup = MinimumCleanup;
+};
+
+} // namespace
+// ------------------------------------ //
 // ComputeInfo
 ComputeInfo::ComputeInfo(const VariableState& lhs, OPERATOR op, const VariableState& rhs) :
-    Operation(op), LHS(std::make_shared<VariableState>(lhs)),
-    RHS(std::make_shared<VariableState>(rhs))
+    Node(ComputeNodeTable::Get().Intern(op, lhs, rhs))
 {}
 // ------------------------------------ //
 std::string ComputeInfo::Dump() const
 {
-    return LHS->Dump() + " " + ::Dump(Operation) + " " + RHS->Dump();
+    return GetLHS().Dump() + " " + ::Dump(GetOperation()) + " " + GetRHS().Dump();
 }
 // ------------------------------------ //
 // VariableState
@@ -185,6 +550,10 @@ int VariableState::ToZeroOrNonZero() const
         throw UnknownVariableStateException("unknown variable in VariableState");
     case STATE::Primitive: return std::get<PrimitiveInfo>(Value).IsNonZero() ? 1 : 0;
     case STATE::Buffer: return std::get<BufferInfo>(Value).NullPtr ? 0 : 1;
+    case STATE::Interval:
+        if(std::get<IntervalInfo>(Value).Contains(0))
+            throw UnknownVariableStateException("interval in VariableState may be zero");
+        return 1;
     case STATE::Compute:
     case STATE::CopyVar:
         throw UnknownVariableStateException(
@@ -221,6 +590,16 @@ bool VariableState::CompareTo(COMPARISON op, const VariableState& other) const
     if(State == STATE::Unknown || other.State == STATE::Unknown)
         return false;
 
+    if(State == STATE::Interval || other.State == STATE::Interval) {
+        const auto first = IntervalInfo::FromState(*this);
+        const auto second = IntervalInfo::FromState(other);
+
+        if(!first || !second)
+            return false;
+
+        return first->CompareTo(op, *second).value_or(false);
+    }
+
     // TODO: some different states could probably be compared. Like Buffer not 0
     if(State != other.State)
         return false;
@@ -244,15 +623,61 @@ VariableState VariableState::CreateOperatorApplyingState(
     return VariableState(ComputeInfo(*this, op, other));
 }
 // ------------------------------------ //
+VariableState VariableState::FromInterval(const IntervalInfo& interval)
+{
+    if(interval.IsSingleValue())
+        return VariableState(PrimitiveInfo(interval.Min));
+
+    return VariableState(interval);
+}
+
+VariableState VariableState::Join(const VariableState& other) const
+{
+    if(*this == other)
+        return *this;
+
+    const auto first = IntervalInfo::FromState(*this);
+    const auto second = IntervalInfo::FromState(other);
+
+    if(!first || !second)
+        return VariableState();
+
+    return FromInterval(first->Join(*second));
+}
+
+VariableState VariableState::Widen(const VariableState& next) const
+{
+    if(*this == next)
+        return *this;
+
+    const auto first = IntervalInfo::FromState(*this);
+    const auto second = IntervalInfo::FromState(next);
+
+    if(!first || !second)
+        return VariableState();
+
+    return FromInterval(first->Widen(*second));
+}
+// ------------------------------------ //
 VariableState VariableState::PerformComputation(
     const ComputeInfo& computation, const VariableValueProvider& otherVariables)
 {
-    const auto lhs = computation.LHS->Resolve(otherVariables);
-    const auto rhs = computation.RHS->Resolve(otherVariables);
+    const auto lhs = computation.GetLHS().Resolve(otherVariables);
+    const auto rhs = computation.GetRHS().Resolve(otherVariables);
 
     if(lhs.State == STATE::Unknown || rhs.State == STATE::Unknown)
         return VariableState();
 
+    if(lhs.State == STATE::Interval || rhs.State == STATE::Interval) {
+        const auto first = IntervalInfo::FromState(lhs);
+        const auto second = IntervalInfo::FromState(rhs);
+
+        if(!first || !second)
+            return VariableState();
+
+        return FromInterval(first->ApplyOperator(computation.GetOperation(), *second));
+    }
+
     // TODO: some different states could probably be applied an operator to. Like
     // Buffer and 1
     if(lhs.State != rhs.State)
@@ -261,10 +686,10 @@ VariableState VariableState::PerformComputation(
     switch(lhs.State) {
     case STATE::Primitive:
         return std::get<PrimitiveInfo>(lhs.Value).ApplyOperator(
-            computation.Operation, std::get<PrimitiveInfo>(rhs.Value));
+            computation.GetOperation(), std::get<PrimitiveInfo>(rhs.Value));
     case STATE::Buffer:
         return std::get<BufferInfo>(lhs.Value).ApplyOperator(
-            computation.Operation, std::get<BufferInfo>(rhs.Value));
+            computation.GetOperation(), std::get<BufferInfo>(rhs.Value));
     case STATE::Compute:
     case STATE::CopyVar:
         throw UnknownVariableStateException(
@@ -279,7 +704,8 @@ std::string VariableState::Dump() const
     case STATE::Unknown: return "unknown";
     case STATE::Primitive:
     case STATE::Buffer:
-    case STATE::CopyVar: return DumpValue();
+    case STATE::CopyVar:
+    case STATE::Interval: return DumpValue();
     case STATE::Compute: return "(compute " + std::get<ComputeInfo>(Value).Dump() + ")";
     }
 
@@ -294,6 +720,8 @@ std::string VariableState::DumpValue() const
         return value->Dump();
     } else if(auto value = std::get_if<VarCopyInfo>(&Value); value) {
         return value->Dump();
+    } else if(auto value = std::get_if<IntervalInfo>(&Value); value) {
+        return value->Dump();
     } else {
         throw std::runtime_error("VariableState Value has unprintable type");
     }
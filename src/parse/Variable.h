@@ -5,13 +5,24 @@
 #include <clang/AST/Stmt.h>
 
 #include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <variant>
 
+namespace clang {
+class NamedDecl;
+} // namespace clang
+
 namespace smacpp {
 
 class VariableValueProvider;
 class VariableState;
+struct ComputeNode;
 
 //! \todo The values inside should be renamed to match naming convention
 enum class COMPARISON {
@@ -26,25 +37,112 @@ enum class COMPARISON {
 enum class OPERATOR { Add, Multiply, Subtract };
 
 
+//! \brief Interns variable names into small integer ids
+//!
+//! The ids are only valid in the table that made them. Each BlockRegistry has its own table
+//! that is made current with Scope while its blocks are built and analysed, so long running
+//! batch and server processes don't keep the names of every translation unit they have
+//! seen. Blocks combined into one registry share its table
+//! \note This is thread safe
+class VariableNameTable {
+public:
+    using ID = uint32_t;
+
+    //! \brief Makes a table the current one on this thread until this is destroyed
+    class Scope {
+    public:
+        explicit Scope(VariableNameTable& table);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        VariableNameTable* Previous;
+    };
+
+public:
+    //! \returns The current table of this thread or the process wide default table if no
+    //! Scope is active
+    static VariableNameTable& Get();
+
+    //! \returns The id for name, new names get the next free id
+    ID Intern(const std::string& name);
+
+    //! \returns The name of an interned variable. The reference stays valid as long as the
+    //! table exists
+    const std::string& GetName(ID id) const;
+
+    //! \brief Marks a variable as having static storage (globals and static locals)
+    void MarkGlobal(ID id);
+    bool IsGlobal(ID id) const;
+
+    size_t GetCount() const;
+
+private:
+    struct Entry {
+        std::string Name;
+        bool Global = false;
+    };
+
+private:
+    mutable std::shared_mutex Mutex;
+    std::unordered_map<std::string, ID> IDs;
+
+    //! deque is used to not invalidate references returned by GetName
+    std::deque<Entry> Entries;
+};
+
 struct VariableIdentifier {
-    VariableIdentifier(const std::string& name) : Name(name) {}
+    VariableIdentifier(const std::string& name) : ID(VariableNameTable::Get().Intern(name)) {}
 
     VariableIdentifier(clang::VarDecl* var);
 
+    static VariableIdentifier FromID(VariableNameTable::ID id)
+    {
+        VariableIdentifier result;
+        result.ID = id;
+        return result;
+    }
+
     std::string Dump() const
     {
-        return Name;
+        return GetName();
+    }
+
+    bool IsGlobal() const
+    {
+        return VariableNameTable::Get().IsGlobal(ID);
+    }
+
+    const std::string& GetName() const
+    {
+        return VariableNameTable::Get().GetName(ID);
     }
 
     bool operator==(const VariableIdentifier& other) const
     {
-        return Name == other.Name;
+        return ID == other.ID;
     }
 
     //! \todo Implement proper scoping
-    std::string Name;
+    //! Interned name of the variable, used to index ProgramState
+    VariableNameTable::ID ID;
+
+private:
+    VariableIdentifier() = default;
 };
 
+static_assert(std::is_trivially_copyable_v<VariableIdentifier>,
+    "VariableIdentifier is copied around a lot and needs to stay cheap");
+
+//! \brief The qualified name of decl, with the main file of the TU added to declarations
+//! with internal linkage (like static functions)
+//!
+//! This keeps them from being confused with the same name from other TUs when summaries
+//! are linked together
+std::string GetLinkageQualifiedName(const clang::NamedDecl* decl);
+
 struct BufferInfo {
 public:
     BufferInfo(std::nullptr_t) : NullPtr(true) {}
@@ -87,6 +185,65 @@ public:
     std::variant<bool, Integer, double> Value;
 };
 
+//! \brief A range of integer values [Min, Max]
+//!
+//! Created when analysis paths with different values for a variable are joined so that the
+//! values don't need to be enumerated. The numeric limits of Integer stand for unbounded ends.
+struct IntervalInfo {
+public:
+    using Integer = PrimitiveInfo::Integer;
+
+    static constexpr Integer Unbounded = std::numeric_limits<Integer>::max();
+    static constexpr Integer UnboundedBelow = std::numeric_limits<Integer>::min();
+
+    IntervalInfo(Integer min, Integer max) : Min(min), Max(max) {}
+
+    //! \returns The interval of a single primitive or interval state, or nothing for
+    //! non-numeric states
+    static std::optional<IntervalInfo> FromState(const VariableState& state);
+
+
+    bool Contains(Integer value) const
+    {
+        return Min <= value && value <= Max;
+    }
+
+    bool IsSingleValue() const
+    {
+        return Min == Max;
+    }
+
+    //! \returns The smallest interval containing both
+    IntervalInfo Join(const IntervalInfo& other) const;
+
+    //! \returns The values in both or nothing if there are none
+    std::optional<IntervalInfo> Meet(const IntervalInfo& other) const;
+
+    //! \returns The values that satisfy "value op constant" or nothing if there are none
+    std::optional<IntervalInfo> Restrict(COMPARISON op, Integer constant) const;
+
+    //! \brief Joins with next, but ends that keep growing are made unbounded so that repeated
+    //! widening stops changing after a few steps
+    IntervalInfo Widen(const IntervalInfo& next) const;
+
+    //! \returns The comparison result for all values in the intervals, or nothing if it
+    //! depends on which values are picked
+    std::optional<bool> CompareTo(COMPARISON op, const IntervalInfo& other) const;
+
+    //! \note Results that would overflow become unbounded
+    IntervalInfo ApplyOperator(OPERATOR op, const IntervalInfo& other) const;
+
+    std::string Dump() const;
+
+    bool operator==(const IntervalInfo& other) const
+    {
+        return Min == other.Min && Max == other.Max;
+    }
+
+    Integer Min;
+    Integer Max;
+};
+
 struct VarCopyInfo {
     VarCopyInfo(VariableIdentifier source) : Source(source) {}
 
@@ -101,18 +258,23 @@ struct VarCopyInfo {
 };
 
 struct ComputeInfo {
+    //! \brief Finds the existing node for this computation or creates a new one
     ComputeInfo(const VariableState& lhs, OPERATOR op, const VariableState& rhs);
 
     std::string Dump() const;
 
+    inline OPERATOR GetOperation() const;
+    inline const VariableState& GetLHS() const;
+    inline const VariableState& GetRHS() const;
+    inline size_t GetHash() const;
+
+    //! Identical computations share one node so this doesn't need to recurse
     bool operator==(const ComputeInfo& other) const
     {
-        return Operation == other.Operation && LHS == other.LHS && RHS == other.RHS;
+        return Node == other.Node;
     }
 
-    OPERATOR Operation;
-    std::shared_ptr<VariableState> LHS;
-    std::shared_ptr<VariableState> RHS;
+    std::shared_ptr<const ComputeNode> Node;
 };
 
 class UnknownVariableStateException : public std::runtime_error {
@@ -124,7 +286,7 @@ public:
 
 class VariableState {
 public:
-    enum class STATE { Unknown, Primitive, Buffer, CopyVar, Compute };
+    enum class STATE { Unknown, Primitive, Buffer, CopyVar, Compute, Interval };
 
 public:
     VariableState() {}
@@ -149,6 +311,11 @@ public:
         Set(compute);
     }
 
+    VariableState(const IntervalInfo& interval)
+    {
+        Set(interval);
+    }
+
     VariableState(const VariableState& other) : State(other.State), Value(other.Value) {}
     VariableState(VariableState&& other) noexcept :
         State(other.State), Value(std::move(other.Value))
@@ -181,12 +348,31 @@ public:
         Value = compute;
     }
 
+    //! \note Use FromInterval to get a primitive for single value intervals
+    void Set(IntervalInfo interval)
+    {
+        State = STATE::Interval;
+        Value = interval;
+    }
+
+    //! \returns A primitive state if interval only has one value, an interval state otherwise
+    static VariableState FromInterval(const IntervalInfo& interval);
+
     //! \brief Resolves the actual value if this state is copied from a variable
     VariableState Resolve(const VariableValueProvider& otherVariables) const;
 
     //! \brief Compares this variable to another with an operator
+    //! \returns False also when the result depends on which value of an interval is used
     bool CompareTo(COMPARISON op, const VariableState& other) const;
 
+    //! \returns A state that has the values of both this and other. Different numbers become
+    //! an interval, other differing states become unknown
+    //! \note This and other should be resolved
+    VariableState Join(const VariableState& other) const;
+
+    //! \brief Like Join but uses IntervalInfo::Widen
+    VariableState Widen(const VariableState& next) const;
+
     //! \brief Returns a new state that is either a fully computed one or which will compute a
     //! value when resolving
     //! \todo If this contains calculations that all use known values this could be resolved
@@ -220,9 +406,48 @@ public:
 
     STATE State = STATE::Unknown;
 
-    std::variant<std::monostate, BufferInfo, PrimitiveInfo, VarCopyInfo, ComputeInfo> Value;
+    std::variant<std::monostate, BufferInfo, PrimitiveInfo, VarCopyInfo, ComputeInfo,
+        IntervalInfo>
+        Value;
+};
+
+//! \brief Hash-consed data of a ComputeInfo
+//!
+//! These are only created by ComputeInfo, which makes sure that only one node exists for each
+//! structurally different computation
+struct ComputeNode {
+    ComputeNode(OPERATOR op, const VariableState& lhs, const VariableState& rhs, size_t hash) :
+        Operation(op), LHS(lhs), RHS(rhs), Hash(hash)
+    {}
+
+    const OPERATOR Operation;
+    const VariableState LHS;
+    const VariableState RHS;
+
+    //! Computed once when interning to make hashing deep computations O(1)
+    const size_t Hash;
 };
 
+OPERATOR ComputeInfo::GetOperation() const
+{
+    return Node->Operation;
+}
+
+const VariableState& ComputeInfo::GetLHS() const
+{
+    return Node->LHS;
+}
+
+const VariableState& ComputeInfo::GetRHS() const
+{
+    return Node->RHS;
+}
+
+size_t ComputeInfo::GetHash() const
+{
+    return Node->Hash;
+}
+
 struct ValueRange {
 public:
     enum class RANGE_CLASS { NotZero, Zero, Comparison, Constant };
@@ -245,6 +470,25 @@ public:
 
     std::string Dump() const;
 
+    bool operator==(const ValueRange& other) const
+    {
+        if(Type != other.Type)
+            return false;
+
+        // Comparison is not set for the other types
+        switch(Type) {
+        case RANGE_CLASS::NotZero:
+        case RANGE_CLASS::Zero: return true;
+        case RANGE_CLASS::Comparison:
+            return Comparison == other.Comparison && ComparedTo == other.ComparedTo;
+        case RANGE_CLASS::Constant:
+            return Comparison == other.Comparison &&
+                   ComparedConstant == other.ComparedConstant;
+        }
+
+        return false;
+    }
+
     RANGE_CLASS Type;
     COMPARISON Comparison;
     std::optional<VariableIdentifier> ComparedTo;
@@ -295,7 +539,7 @@ template<>
 struct hash<smacpp::VariableIdentifier> {
     std::size_t operator()(const smacpp::VariableIdentifier& k) const
     {
-        return hash<std::string>()(k.Name);
+        return hash<smacpp::VariableNameTable::ID>()(k.ID);
     }
 };
 
@@ -315,6 +559,15 @@ struct hash<smacpp::PrimitiveInfo> {
     }
 };
 
+template<>
+struct hash<smacpp::IntervalInfo> {
+    std::size_t operator()(const smacpp::IntervalInfo& k) const
+    {
+        return hash<smacpp::IntervalInfo::Integer>()(k.Min) ^
+               ::rotateLeft(hash<smacpp::IntervalInfo::Integer>()(k.Max), 1);
+    }
+};
+
 template<>
 struct hash<smacpp::VarCopyInfo> {
     std::size_t operator()(const smacpp::VarCopyInfo& k) const
@@ -325,7 +578,10 @@ struct hash<smacpp::VarCopyInfo> {
 
 template<>
 struct hash<smacpp::ComputeInfo> {
-    std::size_t operator()(const smacpp::ComputeInfo& k) const;
+    std::size_t operator()(const smacpp::ComputeInfo& k) const
+    {
+        return k.GetHash();
+    }
 };
 
 template<>
@@ -333,18 +589,12 @@ struct hash<smacpp::VariableState> {
     std::size_t operator()(const smacpp::VariableState& k) const
     {
         return hash<std::variant<std::monostate, smacpp::BufferInfo, smacpp::PrimitiveInfo,
-                   smacpp::VarCopyInfo, smacpp::ComputeInfo>>()(k.Value) ^
+                   smacpp::VarCopyInfo, smacpp::ComputeInfo, smacpp::IntervalInfo>>()(
+                   k.Value) ^
                (hash<smacpp::VariableState::STATE>()(k.State) << 1);
     }
 };
 
-inline std::size_t hash<smacpp::ComputeInfo>::operator()(const smacpp::ComputeInfo& k) const
-{
-    return hash<smacpp::VariableState>()(*k.LHS) ^
-           (hash<smacpp::VariableState>()(*k.LHS) << 1) ^
-           (hash<smacpp::OPERATOR>()(k.Operation) << 2);
-}
-
 // For variable lists to work with hashing
 template<>
 struct hash<std::vector<smacpp::VariableState>> {
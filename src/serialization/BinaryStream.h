@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace smacpp {
+
+//! \brief Thrown when reading malformed serialized data
+class SerializationError : public std::runtime_error {
+public:
+    SerializationError(const std::string& what) : std::runtime_error(what) {}
+};
+
+//! \brief Appends little endian binary data to a buffer
+//!
+//! Integers are stored as variable length (LEB128) to keep the summaries compact
+class BinaryWriter {
+public:
+    void WriteU8(uint8_t value)
+    {
+        Buffer.push_back(static_cast<char>(value));
+    }
+
+    void WriteVarUInt(uint64_t value)
+    {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+
+            if(value != 0)
+                byte |= 0x80;
+
+            WriteU8(byte);
+        } while(value != 0);
+    }
+
+    //! Zigzag encoded to keep small negative numbers small
+    void WriteVarInt(int64_t value)
+    {
+        WriteVarUInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void WriteDouble(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        WriteFixedU64(bits);
+    }
+
+    void WriteFixedU32(uint32_t value)
+    {
+        for(int i = 0; i < 4; ++i)
+            WriteU8((value >> (i * 8)) & 0xff);
+    }
+
+    void WriteFixedU64(uint64_t value)
+    {
+        for(int i = 0; i < 8; ++i)
+            WriteU8((value >> (i * 8)) & 0xff);
+    }
+
+    void WriteString(const std::string& value)
+    {
+        WriteVarUInt(value.size());
+        WriteRaw(value.data(), value.size());
+    }
+
+    void WriteRaw(const char* data, size_t length)
+    {
+        Buffer.append(data, length);
+    }
+
+    const std::string& GetBuffer() const
+    {
+        return Buffer;
+    }
+
+    std::string& GetBuffer()
+    {
+        return Buffer;
+    }
+
+private:
+    std::string Buffer;
+};
+
+//! \brief Reads data written by BinaryWriter
+//! \note This doesn't own the data. Throws SerializationError when reading past the end
+class BinaryReader {
+public:
+    BinaryReader(const char* data, size_t length) : Current(data), End(data + length) {}
+
+    uint8_t ReadU8()
+    {
+        Require(1);
+        return static_cast<uint8_t>(*Current++);
+    }
+
+    uint64_t ReadVarUInt()
+    {
+        uint64_t result = 0;
+
+        for(int shift = 0; shift < 64; shift += 7) {
+            const auto byte = ReadU8();
+            result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+            if((byte & 0x80) == 0)
+                return result;
+        }
+
+        throw SerializationError("too long variable length integer");
+    }
+
+    int64_t ReadVarInt()
+    {
+        const auto value = ReadVarUInt();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    double ReadDouble()
+    {
+        const auto bits = ReadFixedU64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint32_t ReadFixedU32()
+    {
+        uint32_t result = 0;
+
+        for(int i = 0; i < 4; ++i)
+            result |= static_cast<uint32_t>(ReadU8()) << (i * 8);
+
+        return result;
+    }
+
+    uint64_t ReadFixedU64()
+    {
+        uint64_t result = 0;
+
+        for(int i = 0; i < 8; ++i)
+            result |= static_cast<uint64_t>(ReadU8()) << (i * 8);
+
+        return result;
+    }
+
+    std::string ReadString()
+    {
+        const auto length = ReadVarUInt();
+        Require(length);
+
+        std::string result(Current, length);
+        Current += length;
+        return result;
+    }
+
+    bool IsAtEnd() const
+    {
+        return Current == End;
+    }
+
+private:
+    void Require(uint64_t bytes) const
+    {
+        if(static_cast<uint64_t>(End - Current) < bytes)
+            throw SerializationError("unexpected end of serialized data");
+    }
+
+private:
+    const char* Current;
+    const char* End;
+};
+
+} // namespace smacpp
@@ -0,0 +1,669 @@
+// ------------------------------------ //
+#include "CodeBlockSerializer.h"
+
+#include "analysis/BlockRegistry.h"
+
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <algorithm>
+
+using namespace smacpp;
+// ------------------------------------ //
+namespace {
+
+constexpr char SUMMARY_MAGIC[] = "SMACPPB";
+constexpr uint32_t SUMMARY_VERSION = 4;
+
+// Header: magic, version, string count, block count, padding, string table offset, index
+// offset. The string table is (string count + 1) offsets followed by the string bytes and
+// the index has three u64 fields per block (name, offset, size)
+constexpr size_t SUMMARY_HEADER_SIZE = sizeof(SUMMARY_MAGIC) + 4 * 4 + 2 * 8;
+constexpr size_t INDEX_ENTRY_FIELDS = 3;
+constexpr size_t INDEX_ENTRY_SIZE = INDEX_ENTRY_FIELDS * 8;
+
+// Condition parts and variable states nested deeper than this are rejected
+constexpr unsigned MAX_NESTING_DEPTH = 1024;
+
+enum class ACTION_TAG : uint8_t { VarDeclared, VarAssigned, ArrayIndexAccess, FunctionCall };
+
+enum class PART_TAG : uint8_t { VariableValue, VariableState, Combined };
+
+enum class PRIMITIVE_TAG : uint8_t { Bool, Integer, Double };
+
+enum CONDITION_FLAGS : uint8_t { CONDITION_TAUTOLOGY = 1, CONDITION_HAS_PARTS = 2 };
+
+//! \brief Reads an enum stored as a byte and makes sure it is in range
+template<class T>
+T ReadEnum(BinaryReader& reader, T last)
+{
+    const auto value = reader.ReadU8();
+
+    if(value > static_cast<uint8_t>(last))
+        throw SerializationError("enum value out of range");
+
+    return static_cast<T>(value);
+}
+
+uint64_t ReadFixedU64At(const char* data, uint64_t offset)
+{
+    return BinaryReader(data + offset, 8).ReadFixedU64();
+}
+
+uint32_t ReadFixedU32At(const char* data, uint64_t offset)
+{
+    return BinaryReader(data + offset, 4).ReadFixedU32();
+}
+
+} // namespace
+// ------------------------------------ //
+// CodeBlockWriter
+CodeBlockWriter::CodeBlockWriter(PositionResolver resolver) : Resolver(std::move(resolver)) {}
+// ------------------------------------ //
+void CodeBlockWriter::WriteBlock(const CodeBlock& block)
+{
+    const auto start = Blocks.GetBuffer().size();
+
+    WriteStringReference(block.GetName());
+    WritePosition(block.GetLocation(), block.GetPosition());
+
+    Blocks.WriteVarUInt(block.GetParameters().size());
+
+    for(const auto& param : block.GetParameters())
+        WriteVariable(param);
+
+    Blocks.WriteVarUInt(block.GetConditions().size());
+
+    for(const auto& condition : block.GetConditions())
+        WriteCondition(condition);
+
+    Blocks.WriteVarUInt(block.GetActions().size());
+
+    for(size_t i = 0; i < block.GetActions().size(); ++i)
+        WriteAction(block.GetActions()[i], block.GetActionPosition(i));
+
+    Index.push_back(
+        IndexEntry{GetStringIndex(block.GetName()), start, Blocks.GetBuffer().size() - start});
+}
+
+std::string CodeBlockWriter::Finish()
+{
+    // MappedSummary::FindBlock binary searches this
+    std::stable_sort(Index.begin(), Index.end(), [this](const auto& lhs, const auto& rhs) {
+        return Strings[lhs.Name] < Strings[rhs.Name];
+    });
+
+    uint64_t stringBytes = 0;
+
+    for(const auto& str : Strings)
+        stringBytes += str.size();
+
+    const uint64_t stringTableOffset = SUMMARY_HEADER_SIZE;
+    const uint64_t indexOffset = stringTableOffset + (Strings.size() + 1) * 8 + stringBytes;
+    const uint64_t blocksOffset = indexOffset + Index.size() * INDEX_ENTRY_SIZE;
+
+    BinaryWriter result;
+    result.GetBuffer().reserve(blocksOffset + Blocks.GetBuffer().size());
+
+    result.WriteRaw(SUMMARY_MAGIC, sizeof(SUMMARY_MAGIC));
+    result.WriteFixedU32(SUMMARY_VERSION);
+    result.WriteFixedU32(Strings.size());
+    result.WriteFixedU32(Index.size());
+    result.WriteFixedU32(0);
+    result.WriteFixedU64(stringTableOffset);
+    result.WriteFixedU64(indexOffset);
+
+    uint64_t stringOffset = indexOffset - stringBytes;
+
+    for(const auto& str : Strings) {
+        result.WriteFixedU64(stringOffset);
+        stringOffset += str.size();
+    }
+
+    result.WriteFixedU64(stringOffset);
+
+    for(const auto& str : Strings)
+        result.WriteRaw(str.data(), str.size());
+
+    for(const auto& entry : Index) {
+        result.WriteFixedU64(entry.Name);
+        result.WriteFixedU64(blocksOffset + entry.Offset);
+        result.WriteFixedU64(entry.Size);
+    }
+
+    result.WriteRaw(Blocks.GetBuffer().data(), Blocks.GetBuffer().size());
+
+    return std::move(result.GetBuffer());
+}
+// ------------------------------------ //
+void CodeBlockWriter::WriteAction(
+    const ProcessedAction& action, const SourcePosition& position)
+{
+    Blocks.WriteVarUInt(action.If);
+    WritePosition(action.Location, position);
+
+    if(const auto* declared = std::get_if<action::VarDeclared>(&action.Value); declared) {
+
+        Blocks.WriteU8(static_cast<uint8_t>(ACTION_TAG::VarDeclared));
+        WriteVariable(declared->Variable);
+        WriteState(declared->State);
+
+    } else if(const auto* assigned = std::get_if<action::VarAssigned>(&action.Value);
+              assigned) {
+
+        Blocks.WriteU8(static_cast<uint8_t>(ACTION_TAG::VarAssigned));
+        WriteVariable(assigned->Variable);
+        WriteState(assigned->State);
+
+    } else if(const auto* index = std::get_if<action::ArrayIndexAccess>(&action.Value);
+              index) {
+
+        Blocks.WriteU8(static_cast<uint8_t>(ACTION_TAG::ArrayIndexAccess));
+        WriteVariable(index->Array);
+        WriteState(index->Index);
+
+    } else if(const auto* call = std::get_if<action::FunctionCall>(&action.Value); call) {
+
+        Blocks.WriteU8(static_cast<uint8_t>(ACTION_TAG::FunctionCall));
+        WriteStringReference(call->Function);
+
+        Blocks.WriteVarUInt(call->Params.size());
+
+        for(const auto& param : call->Params)
+            WriteState(param);
+
+    } else {
+        throw std::runtime_error("CodeBlockWriter: unknown ProcessedAction type");
+    }
+}
+
+void CodeBlockWriter::WriteCondition(const Condition& condition)
+{
+    uint8_t flags = 0;
+
+    if(condition.IsAlwaysTrue())
+        flags |= CONDITION_TAUTOLOGY;
+
+    if(condition.GetParts())
+        flags |= CONDITION_HAS_PARTS;
+
+    Blocks.WriteU8(flags);
+
+    if(condition.GetParts())
+        WritePart(*condition.GetParts());
+}
+
+void CodeBlockWriter::WritePart(const Condition::Part& part)
+{
+    if(auto value = std::get_if<VariableValueCondition>(&part.Value); value) {
+
+        Blocks.WriteU8(static_cast<uint8_t>(PART_TAG::VariableValue));
+        WriteVariable(value->Variable);
+        WriteRange(value->Value);
+
+    } else if(auto value = std::get_if<VariableStateCondition>(&part.Value); value) {
+
+        Blocks.WriteU8(static_cast<uint8_t>(PART_TAG::VariableState));
+        WriteState(value->State);
+        WriteRange(value->Value);
+
+    } else if(auto combined = std::get_if<Condition::Part::CombinedParts>(&part.Value);
+              combined) {
+
+        Blocks.WriteU8(static_cast<uint8_t>(PART_TAG::Combined));
+        WritePart(*std::get<0>(*combined));
+        Blocks.WriteU8(static_cast<uint8_t>(std::get<1>(*combined)));
+        WritePart(*std::get<2>(*combined));
+
+    } else {
+        throw std::runtime_error("CodeBlockWriter: unknown Condition::Part type");
+    }
+}
+
+void CodeBlockWriter::WriteRange(const ValueRange& range)
+{
+    Blocks.WriteU8(static_cast<uint8_t>(range.Type));
+
+    // Comparison is not set for the other types
+    switch(range.Type) {
+    case ValueRange::RANGE_CLASS::NotZero:
+    case ValueRange::RANGE_CLASS::Zero: break;
+    case ValueRange::RANGE_CLASS::Comparison:
+        Blocks.WriteU8(static_cast<uint8_t>(range.Comparison));
+        WriteVariable(*range.ComparedTo);
+        break;
+    case ValueRange::RANGE_CLASS::Constant:
+        Blocks.WriteU8(static_cast<uint8_t>(range.Comparison));
+        WriteState(*range.ComparedConstant);
+        break;
+    }
+}
+
+void CodeBlockWriter::WriteState(const VariableState& state)
+{
+    Blocks.WriteU8(static_cast<uint8_t>(state.State));
+
+    switch(state.State) {
+    case VariableState::STATE::Unknown: break;
+    case VariableState::STATE::Primitive: {
+        const auto& primitive = std::get<PrimitiveInfo>(state.Value);
+
+        if(auto value = std::get_if<bool>(&primitive.Value); value) {
+            Blocks.WriteU8(static_cast<uint8_t>(PRIMITIVE_TAG::Bool));
+            Blocks.WriteU8(*value ? 1 : 0);
+        } else if(auto value = std::get_if<PrimitiveInfo::Integer>(&primitive.Value); value) {
+            Blocks.WriteU8(static_cast<uint8_t>(PRIMITIVE_TAG::Integer));
+            Blocks.WriteVarInt(*value);
+        } else if(auto value = std::get_if<double>(&primitive.Value); value) {
+            Blocks.WriteU8(static_cast<uint8_t>(PRIMITIVE_TAG::Double));
+            Blocks.WriteDouble(*value);
+        }
+        break;
+    }
+    case VariableState::STATE::Buffer: {
+        const auto& buffer = std::get<BufferInfo>(state.Value);
+        Blocks.WriteU8(buffer.NullPtr ? 1 : 0);
+        Blocks.WriteVarUInt(buffer.AllocatedSize);
+        break;
+    }
+    case VariableState::STATE::CopyVar:
+        WriteVariable(std::get<VarCopyInfo>(state.Value).Source);
+        break;
+    case VariableState::STATE::Compute: {
+        const auto& compute = std::get<ComputeInfo>(state.Value);
+        Blocks.WriteU8(static_cast<uint8_t>(compute.GetOperation()));
+        WriteState(compute.GetLHS());
+        WriteState(compute.GetRHS());
+        break;
+    }
+    case VariableState::STATE::Interval: {
+        // Only created during analysis but handled for completeness
+        const auto& interval = std::get<IntervalInfo>(state.Value);
+        Blocks.WriteVarInt(interval.Min);
+        Blocks.WriteVarInt(interval.Max);
+        break;
+    }
+    }
+}
+
+void CodeBlockWriter::WritePosition(
+    clang::SourceLocation location, const SourcePosition& existing)
+{
+    SourcePosition position = existing;
+
+    if(location.isValid() && Resolver)
+        position = Resolver(location);
+
+    if(!position.IsValid()) {
+        Blocks.WriteVarUInt(0);
+        return;
+    }
+
+    Blocks.WriteVarUInt(position.Line);
+    Blocks.WriteVarUInt(position.Column);
+    WriteStringReference(position.File);
+}
+
+void CodeBlockWriter::WriteStringReference(const std::string& value)
+{
+    Blocks.WriteVarUInt(GetStringIndex(value));
+}
+
+void CodeBlockWriter::WriteVariable(const VariableIdentifier& variable)
+{
+    // The lowest bit is the global flag so the reader doesn't depend on the variable
+    // declarations that set it while parsing
+    Blocks.WriteVarUInt(
+        (GetStringIndex(variable.GetName()) << 1) | (variable.IsGlobal() ? 1 : 0));
+}
+
+uint64_t CodeBlockWriter::GetStringIndex(const std::string& value)
+{
+    const auto [iter, inserted] = StringIndices.emplace(value, Strings.size());
+
+    if(inserted)
+        Strings.push_back(value);
+
+    return iter->second;
+}
+// ------------------------------------ //
+// MappedSummary
+MappedSummary::MappedSummary(const char* data, size_t length) : Data(data), Length(length)
+{
+    if(Length < SUMMARY_HEADER_SIZE ||
+        std::memcmp(Data, SUMMARY_MAGIC, sizeof(SUMMARY_MAGIC)) != 0)
+        throw SerializationError("data is not a smacpp summary");
+
+    BinaryReader header(
+        Data + sizeof(SUMMARY_MAGIC), SUMMARY_HEADER_SIZE - sizeof(SUMMARY_MAGIC));
+
+    if(header.ReadFixedU32() != SUMMARY_VERSION)
+        throw SerializationError("unsupported smacpp summary version");
+
+    StringCount = header.ReadFixedU32();
+    BlockCount = header.ReadFixedU32();
+    header.ReadFixedU32();
+    StringTableOffset = header.ReadFixedU64();
+    IndexOffset = header.ReadFixedU64();
+
+    // The tables need to fit, their contents are checked when they are used
+    if(StringTableOffset > Length || (Length - StringTableOffset) / 8 < StringCount + 1 ||
+        IndexOffset > Length || (Length - IndexOffset) / INDEX_ENTRY_SIZE < BlockCount)
+        throw SerializationError("summary tables are out of range");
+}
+
+MappedSummary::~MappedSummary() = default;
+// ------------------------------------ //
+std::unique_ptr<MappedSummary> MappedSummary::OpenFile(const std::string& path)
+{
+    // Large enough files are memory mapped by MemoryBuffer
+    auto buffer = llvm::MemoryBuffer::getFile(path, false, false);
+
+    if(!buffer)
+        throw SerializationError(
+            "could not open " + path + ": " + buffer.getError().message());
+
+    auto summary = std::make_unique<MappedSummary>(
+        (*buffer)->getBufferStart(), (*buffer)->getBufferSize());
+    summary->Buffer = std::move(*buffer);
+    return summary;
+}
+// ------------------------------------ //
+std::string_view MappedSummary::GetString(uint64_t index) const
+{
+    if(index >= StringCount)
+        throw SerializationError("string reference out of range");
+
+    const auto start = ReadFixedU64At(Data, StringTableOffset + index * 8);
+    const auto end = ReadFixedU64At(Data, StringTableOffset + (index + 1) * 8);
+
+    if(start > end || end > Length)
+        throw SerializationError("string data out of range");
+
+    return std::string_view(Data + start, end - start);
+}
+
+std::string_view MappedSummary::GetBlockName(size_t index) const
+{
+    return GetString(ReadIndexField(index, 0));
+}
+
+std::optional<size_t> MappedSummary::FindBlock(std::string_view name) const
+{
+    size_t low = 0;
+    size_t high = BlockCount;
+
+    while(low < high) {
+        const auto middle = low + (high - low) / 2;
+
+        if(GetBlockName(middle) < name) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if(low < BlockCount && GetBlockName(low) == name)
+        return low;
+
+    return std::nullopt;
+}
+
+CodeBlock MappedSummary::DecodeBlock(size_t index) const
+{
+    const auto offset = ReadIndexField(index, 1);
+    const auto size = ReadIndexField(index, 2);
+
+    if(offset > Length || Length - offset < size)
+        throw SerializationError("block data out of range");
+
+    return CodeBlockReader(*this, Data + offset, size).ReadBlock();
+}
+// ------------------------------------ //
+uint64_t MappedSummary::ReadIndexField(size_t index, size_t field) const
+{
+    if(index >= BlockCount)
+        throw SerializationError("block index out of range");
+
+    return ReadFixedU64At(Data, IndexOffset + index * INDEX_ENTRY_SIZE + field * 8);
+}
+// ------------------------------------ //
+// CodeBlockReader
+CodeBlockReader::CodeBlockReader(
+    const MappedSummary& summary, const char* data, size_t length) :
+    Summary(summary),
+    Reader(data, length)
+{}
+// ------------------------------------ //
+CodeBlock CodeBlockReader::ReadBlock()
+{
+    const auto name = ReadStringReference();
+    const auto position = ReadPosition();
+
+    CodeBlock block(name, clang::SourceLocation{});
+    block.SetPosition(position);
+
+    const auto paramCount = Reader.ReadVarUInt();
+
+    for(uint64_t i = 0; i < paramCount; ++i)
+        block.AddFunctionParameter(ReadVariable());
+
+    const auto conditionCount = Reader.ReadVarUInt();
+
+    for(uint64_t i = 0; i < conditionCount; ++i)
+        block.AddCondition(ReadCondition());
+
+    const auto actionCount = Reader.ReadVarUInt();
+
+    for(uint64_t i = 0; i < actionCount; ++i)
+        ReadAction(block);
+
+    return block;
+}
+// ------------------------------------ //
+void CodeBlockReader::ReadAction(CodeBlock& block)
+{
+    const auto condition = Reader.ReadVarUInt();
+
+    if(condition >= block.GetConditions().size())
+        throw SerializationError("action condition out of range");
+
+    const auto position = ReadPosition();
+
+    block.AddProcessedAction(static_cast<uint32_t>(condition), ReadActionData(),
+        clang::SourceLocation{}, position);
+}
+
+ProcessedAction::Data CodeBlockReader::ReadActionData()
+{
+    switch(ReadEnum(Reader, ACTION_TAG::FunctionCall)) {
+    case ACTION_TAG::VarDeclared: {
+        const auto variable = ReadVariable();
+        return action::VarDeclared{variable, ReadState(0)};
+    }
+    case ACTION_TAG::VarAssigned: {
+        const auto variable = ReadVariable();
+        return action::VarAssigned{variable, ReadState(0)};
+    }
+    case ACTION_TAG::ArrayIndexAccess: {
+        const auto array = ReadVariable();
+        return action::ArrayIndexAccess{array, ReadState(0)};
+    }
+    case ACTION_TAG::FunctionCall: {
+        action::FunctionCall call{ReadStringReference(), {}};
+        const auto paramCount = Reader.ReadVarUInt();
+
+        for(uint64_t i = 0; i < paramCount; ++i)
+            call.Params.push_back(ReadState(0));
+
+        return call;
+    }
+    }
+
+    throw SerializationError("invalid action");
+}
+
+Condition CodeBlockReader::ReadCondition()
+{
+    const auto flags = Reader.ReadU8();
+
+    if(flags & CONDITION_HAS_PARTS)
+        return Condition(ReadPart(0));
+
+    Condition condition;
+    condition.SetTautology(flags & CONDITION_TAUTOLOGY);
+    return condition;
+}
+
+Condition::Part CodeBlockReader::ReadPart(unsigned depth)
+{
+    if(depth > MAX_NESTING_DEPTH)
+        throw SerializationError("condition nested too deeply");
+
+    switch(ReadEnum(Reader, PART_TAG::Combined)) {
+    case PART_TAG::VariableValue: {
+        const auto variable = ReadVariable();
+        return Condition::Part(VariableValueCondition(variable, ReadRange(depth + 1)));
+    }
+    case PART_TAG::VariableState: {
+        const auto state = ReadState(depth + 1);
+        return Condition::Part(VariableStateCondition(state, ReadRange(depth + 1)));
+    }
+    case PART_TAG::Combined: {
+        auto lhs = Condition::Part::MakeShared(ReadPart(depth + 1));
+        const auto op = ReadEnum(Reader, COMBINE_OPERATOR::Or);
+        auto rhs = Condition::Part::MakeShared(ReadPart(depth + 1));
+        return Condition::Part(lhs, op, rhs);
+    }
+    }
+
+    throw SerializationError("invalid condition part");
+}
+
+ValueRange CodeBlockReader::ReadRange(unsigned depth)
+{
+    const auto type = ReadEnum(Reader, ValueRange::RANGE_CLASS::Constant);
+
+    switch(type) {
+    case ValueRange::RANGE_CLASS::NotZero:
+    case ValueRange::RANGE_CLASS::Zero: return ValueRange(type);
+    case ValueRange::RANGE_CLASS::Comparison: {
+        const auto comparison = ReadEnum(Reader, COMPARISON::EQUAL);
+        return ValueRange(comparison, ReadVariable());
+    }
+    case ValueRange::RANGE_CLASS::Constant: {
+        const auto comparison = ReadEnum(Reader, COMPARISON::EQUAL);
+        return ValueRange(comparison, ReadState(depth));
+    }
+    }
+
+    throw SerializationError("invalid value range");
+}
+
+VariableState CodeBlockReader::ReadState(unsigned depth)
+{
+    if(depth > MAX_NESTING_DEPTH)
+        throw SerializationError("variable state nested too deeply");
+
+    switch(ReadEnum(Reader, VariableState::STATE::Interval)) {
+    case VariableState::STATE::Unknown: return VariableState();
+    case VariableState::STATE::Primitive: {
+        PrimitiveInfo primitive(0);
+
+        switch(ReadEnum(Reader, PRIMITIVE_TAG::Double)) {
+        case PRIMITIVE_TAG::Bool: primitive.Value = Reader.ReadU8() != 0; break;
+        case PRIMITIVE_TAG::Integer:
+            primitive.Value = static_cast<PrimitiveInfo::Integer>(Reader.ReadVarInt());
+            break;
+        case PRIMITIVE_TAG::Double: primitive.Value = Reader.ReadDouble(); break;
+        }
+
+        return VariableState(primitive);
+    }
+    case VariableState::STATE::Buffer: {
+        const bool nullPtr = Reader.ReadU8() != 0;
+        const auto size = Reader.ReadVarUInt();
+
+        if(nullPtr)
+            return VariableState(BufferInfo(nullptr));
+        return VariableState(BufferInfo(static_cast<size_t>(size)));
+    }
+    case VariableState::STATE::CopyVar:
+        return VariableState(VarCopyInfo(ReadVariable()));
+    case VariableState::STATE::Compute: {
+        const auto op = ReadEnum(Reader, OPERATOR::Subtract);
+        const auto lhs = ReadState(depth + 1);
+        const auto rhs = ReadState(depth + 1);
+        return VariableState(ComputeInfo(lhs, op, rhs));
+    }
+    case VariableState::STATE::Interval: {
+        const auto min = static_cast<IntervalInfo::Integer>(Reader.ReadVarInt());
+        const auto max = static_cast<IntervalInfo::Integer>(Reader.ReadVarInt());
+
+        if(min > max)
+            throw SerializationError("invalid interval");
+
+        return VariableState::FromInterval(IntervalInfo(min, max));
+    }
+    }
+
+    throw SerializationError("invalid variable state");
+}
+
+SourcePosition CodeBlockReader::ReadPosition()
+{
+    SourcePosition position;
+    position.Line = Reader.ReadVarUInt();
+
+    if(position.Line == 0)
+        return position;
+
+    position.Column = Reader.ReadVarUInt();
+    position.File = ReadStringReference();
+    return position;
+}
+
+std::string CodeBlockReader::ReadStringReference()
+{
+    return std::string(Summary.GetString(Reader.ReadVarUInt()));
+}
+
+VariableIdentifier CodeBlockReader::ReadVariable()
+{
+    const auto value = Reader.ReadVarUInt();
+
+    const VariableIdentifier variable(std::string(Summary.GetString(value >> 1)));
+
+    if(value & 1)
+        VariableNameTable::Get().MarkGlobal(variable.ID);
+
+    return variable;
+}
+// ------------------------------------ //
+std::string smacpp::SerializeBlockRegistry(
+    const BlockRegistry& registry, PositionResolver resolver)
+{
+    CodeBlockWriter writer(std::move(resolver));
+
+    // Sorted to make the output the same for the same input
+    std::vector<const CodeBlock*> blocks;
+
+    for(const auto& [name, block] : registry.GetBlocks())
+        blocks.push_back(&block);
+
+    std::sort(blocks.begin(), blocks.end(), [](const CodeBlock* lhs, const CodeBlock* rhs) {
+        return lhs->GetName() < rhs->GetName();
+    });
+
+    for(const auto* block : blocks)
+        writer.WriteBlock(*block);
+
+    return writer.Finish();
+}
+
+void smacpp::LoadBlockRegistry(BlockRegistry& registry, const char* data, size_t length)
+{
+    MappedSummary summary(data, length);
+
+    for(size_t i = 0; i < summary.GetBlockCount(); ++i)
+        registry.AddBlock(summary.DecodeBlock(i));
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "BinaryStream.h"
+#include "parse/CodeBlock.h"
+
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace smacpp {
+
+class BlockRegistry;
+
+//! \brief Writes CodeBlocks in the binary summary format
+//!
+//! The file starts with a fixed size header containing the offsets of the string table,
+//! the function index and the block data. All strings (function, variable and file names)
+//! are stored only once in the string table. The function index is sorted by name so
+//! that single blocks can be found and decoded straight from a memory mapped file, see
+//! MappedSummary.
+class CodeBlockWriter {
+public:
+    //! \param resolver Used to convert the action locations, if null only the already
+    //! existing SourcePositions are written
+    CodeBlockWriter(PositionResolver resolver);
+
+    void WriteBlock(const CodeBlock& block);
+
+    //! \returns The complete summary file contents
+    std::string Finish();
+
+private:
+    void WriteAction(const ProcessedAction& action, const SourcePosition& position);
+    void WriteCondition(const Condition& condition);
+    void WritePart(const Condition::Part& part);
+    void WriteRange(const ValueRange& range);
+    void WriteState(const VariableState& state);
+    void WritePosition(clang::SourceLocation location, const SourcePosition& existing);
+    void WriteStringReference(const std::string& value);
+    void WriteVariable(const VariableIdentifier& variable);
+    uint64_t GetStringIndex(const std::string& value);
+
+private:
+    struct IndexEntry {
+        uint64_t Name;
+        uint64_t Offset;
+        uint64_t Size;
+    };
+
+    PositionResolver Resolver;
+
+    BinaryWriter Blocks;
+    std::vector<IndexEntry> Index;
+
+    std::unordered_map<std::string, uint64_t> StringIndices;
+    std::vector<std::string> Strings;
+};
+
+//! \brief Read only view of summary data written by CodeBlockWriter
+//!
+//! Only the header is validated when opening, strings are returned as views into the data
+//! and blocks are decoded only when requested. So opening a summary costs about as much as
+//! mapping the file no matter how many functions it contains. Reading a block is not
+//! zero-copy though, DecodeBlock copies all of its actions into a new CodeBlock.
+//! \note All methods are const and safe to call from multiple threads
+class MappedSummary {
+public:
+    //! \brief Uses data without copying, data needs to stay alive while this is used
+    //! \exception SerializationError if data doesn't start with a valid summary header
+    MappedSummary(const char* data, size_t length);
+    ~MappedSummary();
+
+    MappedSummary(const MappedSummary& other) = delete;
+    MappedSummary& operator=(const MappedSummary& other) = delete;
+
+    //! \brief Memory maps a summary file
+    //! \exception SerializationError if the file can't be read or is not a summary
+    static std::unique_ptr<MappedSummary> OpenFile(const std::string& path);
+
+    size_t GetStringCount() const
+    {
+        return StringCount;
+    }
+
+    size_t GetBlockCount() const
+    {
+        return BlockCount;
+    }
+
+    //! \exception SerializationError if index is out of range
+    std::string_view GetString(uint64_t index) const;
+
+    //! \returns The name of the block at index (in the sorted order)
+    std::string_view GetBlockName(size_t index) const;
+
+    //! \brief Binary searches the function index
+    //! \returns The index of the block called name
+    std::optional<size_t> FindBlock(std::string_view name) const;
+
+    //! \brief Decodes the whole block at index into a new CodeBlock
+    //! \exception SerializationError if the block data is malformed
+    CodeBlock DecodeBlock(size_t index) const;
+
+private:
+    uint64_t ReadIndexField(size_t index, size_t field) const;
+
+private:
+    //! Set when the data is owned by this
+    std::unique_ptr<llvm::MemoryBuffer> Buffer;
+
+    const char* Data;
+    size_t Length;
+
+    size_t StringCount = 0;
+    size_t BlockCount = 0;
+    uint64_t StringTableOffset = 0;
+    uint64_t IndexOffset = 0;
+};
+
+//! \brief Decodes a single block from a MappedSummary
+class CodeBlockReader {
+public:
+    CodeBlockReader(const MappedSummary& summary, const char* data, size_t length);
+
+    //! \exception SerializationError if the data is malformed
+    CodeBlock ReadBlock();
+
+private:
+    void ReadAction(CodeBlock& block);
+    ProcessedAction::Data ReadActionData();
+    Condition ReadCondition();
+
+    //! \param depth How many parts and states this is nested in, limited to not overflow
+    //! the stack on malformed data
+    Condition::Part ReadPart(unsigned depth);
+    ValueRange ReadRange(unsigned depth);
+    VariableState ReadState(unsigned depth);
+    SourcePosition ReadPosition();
+    std::string ReadStringReference();
+    VariableIdentifier ReadVariable();
+
+private:
+    const MappedSummary& Summary;
+    BinaryReader Reader;
+};
+
+//! \brief Serializes all blocks in registry
+std::string SerializeBlockRegistry(const BlockRegistry& registry, PositionResolver resolver);
+
+//! \brief Decodes and adds all blocks from summary data to registry
+//!
+//! For large summaries prefer BlockRegistry::AddSummary which decodes blocks lazily
+//! \exception SerializationError if the data is malformed
+void LoadBlockRegistry(BlockRegistry& registry, const char* data, size_t length);
+
+} // namespace smacpp
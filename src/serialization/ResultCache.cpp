@@ -0,0 +1,266 @@
+// ------------------------------------ //
+#include "ResultCache.h"
+
+#include "BinaryStream.h"
+#include "CodeBlockSerializer.h"
+#include "analysis/BlockRegistry.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace smacpp;
+// ------------------------------------ //
+namespace {
+
+constexpr char RESULT_CACHE_MAGIC[] = "SMACPPR";
+
+//! Needs to be increased when the analysis changes in a way that changes the results for the
+//! same code
+constexpr uint64_t RESULT_CACHE_VERSION = 5;
+
+} // namespace
+// ------------------------------------ //
+uint64_t smacpp::HashCodeBlock(const CodeBlock& block, const PositionResolver& resolver)
+{
+    // The summary encoding already contains exactly the information the analysis uses
+    CodeBlockWriter writer(resolver);
+    writer.WriteBlock(block);
+
+    return llvm::xxHash64(writer.Finish());
+}
+
+uint64_t smacpp::HashReachableBlocks(
+    const BlockRegistry& registry, const CodeBlock& entry, const PositionResolver& resolver)
+{
+    // Missing functions have 0 as their hash
+    std::vector<std::tuple<std::string, uint64_t>> hashes;
+
+    std::unordered_set<std::string> seen{entry.GetName()};
+    std::vector<const CodeBlock*> toHash{&entry};
+
+    while(!toHash.empty()) {
+
+        const auto* block = toHash.back();
+        toHash.pop_back();
+
+        hashes.emplace_back(block->GetName(), HashCodeBlock(*block, resolver));
+
+        for(const auto& action : block->GetActions()) {
+
+            const auto* call = std::get_if<action::FunctionCall>(&action.Value);
+
+            if(!call || !seen.insert(call->Function).second)
+                continue;
+
+            if(const auto* called = registry.FindFunction(call->Function); called) {
+                toHash.push_back(called);
+            } else {
+                hashes.emplace_back(call->Function, 0);
+            }
+        }
+    }
+
+    // Sorted to not depend on the traversal order
+    std::sort(hashes.begin(), hashes.end());
+
+    BinaryWriter combined;
+
+    for(const auto& [name, hash] : hashes) {
+        combined.WriteString(name);
+        combined.WriteFixedU64(hash);
+    }
+
+    return llvm::xxHash64(combined.GetBuffer());
+}
+
+uint64_t smacpp::HashAnalysisSettings(const AnalysisSettings& settings)
+{
+    // The entry point budget isn't included as results that ran out of it are not cached
+    BinaryWriter writer;
+    writer.WriteVarUInt(settings.MaxPaths);
+    writer.WriteVarUInt(settings.MaxCallContexts);
+    writer.WriteU8(settings.BottomUpSummaries ? 1 : 0);
+    writer.WriteVarUInt(settings.FunctionBudget.TimeLimit);
+    writer.WriteVarUInt(settings.FunctionBudget.MaxOperations);
+    writer.WriteVarUInt(settings.FunctionBudget.MaxMemory);
+
+    return llvm::xxHash64(writer.GetBuffer());
+}
+// ------------------------------------ //
+// AnalysisResultCache
+void AnalysisResultCache::Load(const std::string& file)
+{
+    Entries.clear();
+
+    auto buffer = llvm::MemoryBuffer::getFile(file, false, false);
+
+    if(!buffer)
+        return;
+
+    BinaryReader reader((*buffer)->getBufferStart(), (*buffer)->getBufferSize());
+
+    try {
+        for(size_t i = 0; i < sizeof(RESULT_CACHE_MAGIC); ++i) {
+            if(reader.ReadU8() != static_cast<uint8_t>(RESULT_CACHE_MAGIC[i]))
+                return;
+        }
+
+        if(reader.ReadVarUInt() != RESULT_CACHE_VERSION)
+            return;
+
+        std::unordered_map<std::string, Entry> entries;
+        const auto entryCount = reader.ReadVarUInt();
+
+        for(uint64_t i = 0; i < entryCount; ++i) {
+
+            const auto key = reader.ReadString();
+
+            Entry entry;
+            entry.ReachableHash = reader.ReadFixedU64();
+            entry.SettingsHash = reader.ReadFixedU64();
+
+            const auto problemCount = reader.ReadVarUInt();
+
+            for(uint64_t j = 0; j < problemCount; ++j) {
+
+                const auto severity = reader.ReadU8();
+
+                if(severity > static_cast<uint8_t>(FoundProblem::SEVERITY::Error))
+                    return;
+
+                const auto message = reader.ReadString();
+
+                SourcePosition position;
+                position.Line = reader.ReadVarUInt();
+
+                if(position.Line != 0) {
+                    position.Column = reader.ReadVarUInt();
+                    position.File = reader.ReadString();
+                }
+
+                entry.Problems.push_back(
+                    FoundProblem(static_cast<FoundProblem::SEVERITY>(severity), message,
+                        clang::SourceLocation{}, position));
+            }
+
+            entries[key] = std::move(entry);
+        }
+
+        Entries = std::move(entries);
+
+    } catch(const SerializationError&) {
+        // Damaged cache files are treated as empty
+    }
+}
+
+bool AnalysisResultCache::Save(const std::string& file) const
+{
+    BinaryWriter writer;
+    writer.WriteRaw(RESULT_CACHE_MAGIC, sizeof(RESULT_CACHE_MAGIC));
+    writer.WriteVarUInt(RESULT_CACHE_VERSION);
+    writer.WriteVarUInt(Entries.size());
+
+    for(const auto& [key, entry] : Entries) {
+        writer.WriteString(key);
+        writer.WriteFixedU64(entry.ReachableHash);
+        writer.WriteFixedU64(entry.SettingsHash);
+        writer.WriteVarUInt(entry.Problems.size());
+
+        for(const auto& problem : entry.Problems) {
+            writer.WriteU8(static_cast<uint8_t>(problem.Severity));
+            writer.WriteString(problem.Message);
+            writer.WriteVarUInt(problem.Position.Line);
+
+            if(problem.Position.IsValid()) {
+                writer.WriteVarUInt(problem.Position.Column);
+                writer.WriteString(problem.Position.File);
+            }
+        }
+    }
+
+    // Written to a temporary file first so that concurrently running compiler invocations
+    // can't see partially written caches
+    int fd = -1;
+    llvm::SmallString<128> temporary;
+
+    if(llvm::sys::fs::createUniqueFile(file + "-%%%%%%.tmp", fd, temporary))
+        return false;
+
+    {
+        llvm::raw_fd_ostream output(fd, true);
+        output.write(writer.GetBuffer().data(), writer.GetBuffer().size());
+        output.close();
+
+        if(output.has_error()) {
+            output.clear_error();
+            llvm::sys::fs::remove(temporary);
+            return false;
+        }
+    }
+
+    if(llvm::sys::fs::rename(temporary, file)) {
+        llvm::sys::fs::remove(temporary);
+        return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+bool AnalysisResultCache::Update(const std::string& file, const std::string& key,
+    uint64_t reachableHash, uint64_t settingsHash, std::vector<FoundProblem> problems)
+{
+    // The cache file itself is replaced when saving so a separate file is locked
+    int lockFD = -1;
+
+    if(llvm::sys::fs::openFileForWrite(
+           file + ".lock", lockFD, llvm::sys::fs::CD_OpenAlways, llvm::sys::fs::OF_None))
+        return false;
+
+    if(llvm::sys::fs::lockFile(lockFD)) {
+        llvm::sys::Process::SafelyCloseFileDescriptor(lockFD);
+        return false;
+    }
+
+    Load(file);
+    Store(key, reachableHash, settingsHash, std::move(problems));
+    const auto saved = Save(file);
+
+    llvm::sys::fs::unlockFile(lockFD);
+    llvm::sys::Process::SafelyCloseFileDescriptor(lockFD);
+
+    return saved;
+}
+// ------------------------------------ //
+const std::vector<FoundProblem>* AnalysisResultCache::Find(
+    const std::string& key, uint64_t reachableHash, uint64_t settingsHash) const
+{
+    const auto found = Entries.find(key);
+
+    if(found == Entries.end() || found->second.ReachableHash != reachableHash ||
+        found->second.SettingsHash != settingsHash)
+        return nullptr;
+
+    return &found->second.Problems;
+}
+
+void AnalysisResultCache::Store(const std::string& key, uint64_t reachableHash,
+    uint64_t settingsHash, std::vector<FoundProblem> problems)
+{
+    for(auto& problem : problems)
+        problem.Location = clang::SourceLocation{};
+
+    Entries[key] = Entry{reachableHash, settingsHash, std::move(problems)};
+}
+
+std::string AnalysisResultCache::MakeKey(
+    const std::string& program, const std::string& entryPoint)
+{
+    // Names can't contain a newline
+    return program + "\n" + entryPoint;
+}
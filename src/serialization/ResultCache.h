@@ -0,0 +1,71 @@
+#pragma once
+
+#include "analysis/Analyzer.h"
+#include "parse/SourcePosition.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace smacpp {
+
+class BlockRegistry;
+
+//! \brief Hashes everything in block that affects the analysis results (actions, conditions,
+//! positions and called function names)
+uint64_t HashCodeBlock(const CodeBlock& block, const PositionResolver& resolver);
+
+//! \brief Hashes entry and all the blocks it can reach through function calls
+//!
+//! Called functions that aren't in the registry are also included as adding them changes
+//! the results
+uint64_t HashReachableBlocks(
+    const BlockRegistry& registry, const CodeBlock& entry, const PositionResolver& resolver);
+
+//! \brief Hashes the settings that change the results of a complete analysis
+uint64_t HashAnalysisSettings(const AnalysisSettings& settings);
+
+//! \brief Problems found from the previous analysis runs keyed by the program and entry
+//! point, checked against the hashes of the blocks reachable from it and the settings
+class AnalysisResultCache {
+public:
+    //! \brief Loads a cache file, a missing or invalid file results in an empty cache
+    void Load(const std::string& file);
+
+    //! \returns False if the file couldn't be written
+    bool Save(const std::string& file) const;
+
+    //! \brief Stores problems in file, keeping the entries other processes have saved since
+    //! it was loaded
+    //!
+    //! The file is locked while it is reloaded and saved so concurrent updates can't lose
+    //! each other's entries
+    //! \returns False if the file couldn't be locked or written
+    bool Update(const std::string& file, const std::string& key, uint64_t reachableHash,
+        uint64_t settingsHash, std::vector<FoundProblem> problems);
+
+    //! \returns The stored problems or null if key has not been analysed with the same
+    //! reachable blocks and settings
+    const std::vector<FoundProblem>* Find(
+        const std::string& key, uint64_t reachableHash, uint64_t settingsHash) const;
+
+    //! \brief Stores problems replacing any earlier results for key
+    //! \note Only FoundProblem::Position is stored, not Location
+    void Store(const std::string& key, uint64_t reachableHash, uint64_t settingsHash,
+        std::vector<FoundProblem> problems);
+
+    //! \returns The key for the results of entryPoint in program
+    static std::string MakeKey(const std::string& program, const std::string& entryPoint);
+
+private:
+    struct Entry {
+        uint64_t ReachableHash;
+        uint64_t SettingsHash;
+        std::vector<FoundProblem> Problems;
+    };
+
+    std::unordered_map<std::string, Entry> Entries;
+};
+
+} // namespace smacpp
@@ -0,0 +1,1053 @@
+// Tests for the analysis running on manually built CodeBlocks
+#include "catch.hpp"
+
+#include "Statistics.h"
+#include "analysis/BlockRegistry.h"
+#include "analysis/CallGraph.h"
+#include "parse/CodeBlock.h"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace smacpp;
+
+namespace {
+//! Builds a program where main calls a function that overflows with some of the parameters
+void AddOverflowingProgram(BlockRegistry& registry, llvm::BumpPtrAllocator* arena = nullptr)
+{
+    CodeBlock main("main", clang::SourceLocation{}, arena);
+    main.AddProcessedAction(Condition(),
+        action::VarDeclared{VariableIdentifier("buf"), VariableState(BufferInfo(5))});
+    main.AddProcessedAction(Condition(),
+        action::ArrayIndexAccess{VariableIdentifier("buf"), VariableState(PrimitiveInfo(10))});
+
+    for(int i = 0; i < 20; ++i) {
+        main.AddProcessedAction(Condition(), action::FunctionCall{"func", {PrimitiveInfo(i)}});
+    }
+
+    registry.AddBlock(std::move(main));
+
+    CodeBlock func("func", clang::SourceLocation{}, arena);
+    func.AddFunctionParameter(VariableIdentifier("index"));
+    func.AddProcessedAction(Condition(),
+        action::VarDeclared{VariableIdentifier("local"), VariableState(BufferInfo(8))});
+    func.AddProcessedAction(Condition(),
+        action::ArrayIndexAccess{VariableIdentifier("local"),
+            VariableState(VarCopyInfo(VariableIdentifier("index")))});
+
+    registry.AddBlock(std::move(func));
+}
+
+std::vector<std::string> FormatProblems(const std::vector<FoundProblem>& problems)
+{
+    std::vector<std::string> result;
+
+    for(const auto& problem : problems)
+        result.push_back(problem.FormatAsString());
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+} // namespace
+
+TEST_CASE("Overflows are found in called functions", "[analysis]")
+{
+    BlockRegistry registry;
+    AddOverflowingProgram(registry);
+
+    AnalysisSettings settings;
+    settings.MaxCallContexts = 0;
+
+    // 1 in main and index values 8-19 in func
+    CHECK(registry.PerformAnalysis(settings).size() == 13);
+
+    // The calls after the first 16 are made with [0, 16] and then [0, inf], which can
+    // overflow but don't always
+    const auto problems = FormatProblems(registry.PerformAnalysis(AnalysisSettings{}));
+    REQUIRE(problems.size() == 11);
+    CHECK(problems[9] ==
+          "warning: Possible buffer overflow: buffer size: 8 used index range: [0, 16]");
+    CHECK(problems[10] ==
+          "warning: Possible buffer overflow: buffer size: 8 used index range: [0, inf]");
+}
+
+TEST_CASE("Statistics count the analysis work", "[analysis]")
+{
+    BlockRegistry registry;
+    AddOverflowingProgram(registry);
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    registry.PerformAnalysis(AnalysisSettings{});
+    Statistics::Enable(false);
+
+    // main and func with 16 different parameters and 2 widened ones, plus the summary of
+    // func for an unknown parameter that is computed first
+    CHECK(Statistics::Get(STAT_COUNTER::OperationsEnqueued) == 19);
+    CHECK(Statistics::Get(STAT_COUNTER::WidenedCalls) == 4);
+    CHECK(Statistics::Get(STAT_COUNTER::ConditionsEvaluated) == 22 + 18 * 2 + 2);
+    CHECK(Statistics::Get(STAT_COUNTER::RegistryHits) == 21);
+    CHECK(Statistics::Get(STAT_COUNTER::PeakProgramStateSize) > 0);
+}
+
+TEST_CASE("Consecutive actions share equal conditions", "[analysis]")
+{
+    const ValueRange isOne(COMPARISON::EQUAL, VariableState(PrimitiveInfo(1)));
+    const Condition condition(
+        Condition::Part(VariableValueCondition(VariableIdentifier("flag"), isOne)));
+
+    CodeBlock block("block", clang::SourceLocation{});
+    block.AddProcessedAction(Condition(), action::FunctionCall{"a", {}});
+    block.AddProcessedAction(condition, action::FunctionCall{"b", {}});
+    block.AddProcessedAction(condition.Negate().Negate(), action::FunctionCall{"c", {}});
+    block.AddProcessedAction(Condition(), action::FunctionCall{"d", {}});
+
+    REQUIRE(block.GetConditions().size() == 3);
+    CHECK(block.GetActions()[1].If == block.GetActions()[2].If);
+    CHECK(block.GetCondition(block.GetActions()[3]).IsAlwaysTrue());
+}
+
+TEST_CASE("Compiled conditions use three valued logic", "[analysis]")
+{
+    const VariableIdentifier known("compiled_known");
+    const VariableIdentifier unknown("compiled_unknown");
+
+    ProgramState state;
+    state.Assign(known, PrimitiveInfo(5));
+
+    const auto isFive = std::make_shared<Condition::Part>(VariableValueCondition(
+        known, ValueRange(COMPARISON::EQUAL, VariableState(PrimitiveInfo(5)))));
+    const auto unknownNonZero = std::make_shared<Condition::Part>(
+        VariableValueCondition(unknown, ValueRange(ValueRange::RANGE_CLASS::NotZero)));
+
+    const Condition both(Condition::Part(isFive, COMBINE_OPERATOR::And, unknownNonZero));
+    const Condition either(Condition::Part(isFive, COMBINE_OPERATOR::Or, unknownNonZero));
+
+    CHECK(CompiledCondition(Condition()).Evaluate(state) == TRI_BOOL::True);
+    CHECK(CompiledCondition(Condition(*isFive)).Evaluate(state) == TRI_BOOL::True);
+    CHECK(CompiledCondition(Condition(*unknownNonZero)).Evaluate(state) == TRI_BOOL::Unknown);
+    CHECK(CompiledCondition(both).Evaluate(state) == TRI_BOOL::Unknown);
+    CHECK(CompiledCondition(both.Negate()).Evaluate(state) == TRI_BOOL::Unknown);
+    CHECK(CompiledCondition(either).Evaluate(state) == TRI_BOOL::True);
+    CHECK(CompiledCondition(either.Negate()).Evaluate(state) == TRI_BOOL::False);
+
+    state.Assign(unknown, PrimitiveInfo(0));
+    CHECK(CompiledCondition(both).Evaluate(state) == TRI_BOOL::False);
+    CHECK(CompiledCondition(both.Negate()).Evaluate(state) == TRI_BOOL::True);
+}
+
+TEST_CASE("Blocks allocated from the registry arena are analysed the same", "[analysis]")
+{
+    BlockRegistry heapRegistry;
+    AddOverflowingProgram(heapRegistry);
+
+    BlockRegistry registry;
+
+    {
+        ArenaScope scope(registry.GetArena());
+        AddOverflowingProgram(registry, &registry.GetArena());
+
+        const Condition condition(Condition::Part(VariableValueCondition(
+            VariableIdentifier("arena_flag"), ValueRange(ValueRange::RANGE_CLASS::NotZero))));
+
+        CodeBlock block("conditional", clang::SourceLocation{}, &registry.GetArena());
+        block.AddProcessedAction(
+            condition.And(condition.Negate()), action::FunctionCall{"func", {}});
+        registry.AddBlock(std::move(block));
+    }
+
+    CHECK(registry.GetArena().getBytesAllocated() > 0);
+    CHECK(registry.FindFunction("func")->GetArena() == &registry.GetArena());
+
+    AnalysisSettings settings;
+    CHECK(FormatProblems(registry.PerformAnalysis(settings)) ==
+          FormatProblems(heapRegistry.PerformAnalysis(settings)));
+}
+
+TEST_CASE("Parallel analysis finds the same problems as single threaded", "[analysis]")
+{
+    BlockRegistry registry;
+    AddOverflowingProgram(registry);
+
+    AnalysisSettings settings;
+    const auto single = registry.PerformAnalysis(settings);
+
+    settings.Threads = 4;
+    const auto parallel = registry.PerformAnalysis(settings);
+
+    CHECK(FormatProblems(single) == FormatProblems(parallel));
+}
+
+TEST_CASE("Forked program states don't affect each other", "[analysis]")
+{
+    ProgramState original;
+    original.Assign(VariableIdentifier("a"), PrimitiveInfo(1));
+    original.Assign(VariableIdentifier("b"), PrimitiveInfo(2));
+
+    const auto fork = original.Fork();
+    CHECK(fork->Variables.SharesStorage(original.Variables));
+
+    fork->Assign(VariableIdentifier("a"), PrimitiveInfo(3));
+    CHECK(!fork->Variables.SharesStorage(original.Variables));
+
+    CHECK(original.GetVariableValue(VariableIdentifier("a")) == PrimitiveInfo(1));
+    CHECK(fork->GetVariableValue(VariableIdentifier("a")) == PrimitiveInfo(3));
+    CHECK(fork->GetVariableValue(VariableIdentifier("b")) == PrimitiveInfo(2));
+    CHECK(fork->GetVariableValue(VariableIdentifier("c")).State ==
+          VariableState::STATE::Unknown);
+}
+
+TEST_CASE("Copy on write vectors grow and keep forks separate", "[analysis]")
+{
+    CopyOnWriteVector<int, 2, 2> original;
+    original.Set(1, 1);
+    original.Set(37, 37);
+
+    auto fork = original;
+    fork.Set(1, 2);
+    fork.Set(100, 100);
+
+    CHECK(*original.TryGet(1) == 1);
+    CHECK(*original.TryGet(37) == 37);
+    CHECK(original.TryGet(100) == nullptr);
+    CHECK(*fork.TryGet(1) == 2);
+    CHECK(*fork.TryGet(37) == 37);
+    CHECK(*fork.TryGet(100) == 100);
+
+    std::vector<std::tuple<size_t, int>> values;
+    fork.ForEach([&](size_t index, int value) {
+        if(value != 0)
+            values.emplace_back(index, value);
+    });
+
+    CHECK(values == std::vector<std::tuple<size_t, int>>{{1, 2}, {37, 37}, {100, 100}});
+    CHECK(fork.GetAllocatedSize() == 6);
+
+    fork.Clear();
+    CHECK(fork.TryGet(37) == nullptr);
+    CHECK(*fork.TryGet(100) == 0);
+    CHECK(*original.TryGet(37) == 37);
+}
+
+TEST_CASE("Identical computations share the same node", "[analysis]")
+{
+    const VariableState variable(VarCopyInfo(VariableIdentifier("a")));
+
+    const auto first = variable.CreateOperatorApplyingState(OPERATOR::Add, PrimitiveInfo(1))
+                           .CreateOperatorApplyingState(OPERATOR::Multiply, PrimitiveInfo(2));
+    const auto second = variable.CreateOperatorApplyingState(OPERATOR::Add, PrimitiveInfo(1))
+                            .CreateOperatorApplyingState(OPERATOR::Multiply, PrimitiveInfo(2));
+    const auto different =
+        variable.CreateOperatorApplyingState(OPERATOR::Add, PrimitiveInfo(2))
+            .CreateOperatorApplyingState(OPERATOR::Multiply, PrimitiveInfo(2));
+
+    CHECK(std::get<ComputeInfo>(first.Value).Node == std::get<ComputeInfo>(second.Value).Node);
+    CHECK(first == second);
+    CHECK(std::hash<VariableState>()(first) == std::hash<VariableState>()(second));
+    CHECK(!(first == different));
+
+    ProgramState state;
+    state.Assign(VariableIdentifier("a"), PrimitiveInfo(3));
+    CHECK(first.Resolve(state) == PrimitiveInfo(8));
+}
+
+TEST_CASE("Variable name tables are current only in their scope", "[analysis]")
+{
+    auto& defaultTable = VariableNameTable::Get();
+
+    VariableNameTable first;
+    VariableNameTable second;
+
+    {
+        const VariableNameTable::Scope firstScope(first);
+        const VariableIdentifier variable("scoped");
+        first.MarkGlobal(variable.ID);
+
+        {
+            const VariableNameTable::Scope secondScope(second);
+            CHECK(&VariableNameTable::Get() == &second);
+            CHECK(!VariableIdentifier("scoped").IsGlobal());
+        }
+
+        CHECK(&VariableNameTable::Get() == &first);
+        CHECK(VariableIdentifier("scoped").IsGlobal());
+    }
+
+    CHECK(&VariableNameTable::Get() == &defaultTable);
+    CHECK(first.GetCount() == 1);
+    CHECK(second.GetCount() == 1);
+}
+
+TEST_CASE("Function summaries apply global variable effects", "[analysis]")
+{
+    // Each test has its own table so the globals marked in it don't affect the others
+    VariableNameTable names;
+    const VariableNameTable::Scope nameScope(names);
+
+    const VariableIdentifier global("global");
+    names.MarkGlobal(global.ID);
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"setter", {}});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"reader", {}});
+    registry.AddBlock(std::move(main));
+
+    CodeBlock setter("setter", clang::SourceLocation{});
+    setter.AddProcessedAction(Condition(), action::VarAssigned{global, PrimitiveInfo(10)});
+    registry.AddBlock(std::move(setter));
+
+    // setter is finished by the time this is analysed so its summary is used
+    CodeBlock reader("reader", clang::SourceLocation{});
+    reader.AddProcessedAction(Condition(), action::FunctionCall{"setter", {}});
+    reader.AddProcessedAction(Condition(),
+        action::VarDeclared{VariableIdentifier("buf"), VariableState(BufferInfo(5))});
+    reader.AddProcessedAction(Condition(),
+        action::ArrayIndexAccess{
+            VariableIdentifier("buf"), VariableState(VarCopyInfo(global))});
+    registry.AddBlock(std::move(reader));
+
+    const auto problems = registry.PerformAnalysis(AnalysisSettings{});
+
+    REQUIRE(problems.size() == 1);
+    CHECK(problems[0].Message.find("used index: 10") != std::string::npos);
+}
+
+TEST_CASE("Callers forget globals the callee may have changed", "[analysis]")
+{
+    VariableNameTable names;
+    const VariableNameTable::Scope nameScope(names);
+
+    const VariableIdentifier global("global");
+    names.MarkGlobal(global.ID);
+
+    const VariableIdentifier flag("forget_flag");
+    const VariableIdentifier unknown("forget_unknown");
+    const VariableIdentifier buffer("forget_buffer");
+
+    BlockRegistry registry;
+
+    // Without the effects of the callees global would still be 10 and overflow the buffer
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+
+    for(const std::string callee : {"forget_maybe_reset", "forget_randomize"}) {
+        main.AddProcessedAction(Condition(), action::VarAssigned{global, PrimitiveInfo(10)});
+        main.AddProcessedAction(Condition(), action::FunctionCall{callee, {}});
+        main.AddProcessedAction(
+            Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(global))});
+    }
+
+    registry.AddBlock(std::move(main));
+
+    // Only one of the paths writes the global
+    CodeBlock maybeReset("forget_maybe_reset", clang::SourceLocation{});
+    maybeReset.AddProcessedAction(Condition(Condition::Part(VariableValueCondition(
+                                      flag, ValueRange(ValueRange::RANGE_CLASS::NotZero)))),
+        action::VarAssigned{global, PrimitiveInfo(0)});
+    registry.AddBlock(std::move(maybeReset));
+
+    CodeBlock randomize("forget_randomize", clang::SourceLocation{});
+    randomize.AddProcessedAction(
+        Condition(), action::VarAssigned{global, VariableState(VarCopyInfo(unknown))});
+    registry.AddBlock(std::move(randomize));
+
+    AnalysisSettings settings;
+
+    for(const bool bottomUp : {true, false}) {
+        for(const unsigned threads : {1, 4}) {
+            settings.BottomUpSummaries = bottomUp;
+            settings.Threads = threads;
+
+            CHECK(registry.PerformAnalysis(settings).empty());
+        }
+    }
+}
+
+TEST_CASE("Calls within a recursive component forget the globals it writes", "[analysis]")
+{
+    VariableNameTable names;
+    const VariableNameTable::Scope nameScope(names);
+
+    const VariableIdentifier global("global");
+    names.MarkGlobal(global.ID);
+
+    const VariableIdentifier flag("mutual_flag");
+    const VariableIdentifier buffer("mutual_buffer");
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"mutual_ping", {}});
+    registry.AddBlock(std::move(main));
+
+    // Without the effects of pong global would still be 10 and overflow the buffer
+    CodeBlock ping("mutual_ping", clang::SourceLocation{});
+    ping.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    ping.AddProcessedAction(Condition(), action::VarAssigned{global, PrimitiveInfo(10)});
+    ping.AddProcessedAction(Condition(), action::FunctionCall{"mutual_pong", {}});
+    ping.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(global))});
+    registry.AddBlock(std::move(ping));
+
+    CodeBlock pong("mutual_pong", clang::SourceLocation{});
+    pong.AddProcessedAction(Condition(), action::VarAssigned{global, PrimitiveInfo(0)});
+    pong.AddProcessedAction(Condition(Condition::Part(VariableValueCondition(
+                                flag, ValueRange(ValueRange::RANGE_CLASS::NotZero)))),
+        action::FunctionCall{"mutual_ping", {}});
+    registry.AddBlock(std::move(pong));
+
+    AnalysisSettings settings;
+
+    for(const bool bottomUp : {true, false}) {
+        for(const unsigned threads : {1, 4}) {
+            settings.BottomUpSummaries = bottomUp;
+            settings.Threads = threads;
+
+            CHECK(registry.PerformAnalysis(settings).empty());
+        }
+    }
+}
+
+TEST_CASE("Callers wait for the summaries of their callees", "[analysis]")
+{
+    VariableNameTable names;
+    const VariableNameTable::Scope nameScope(names);
+
+    const VariableIdentifier global("global");
+    names.MarkGlobal(global.ID);
+
+    const VariableIdentifier value("wait_value");
+    const VariableIdentifier buffer("wait_buffer");
+
+    BlockRegistry registry;
+
+    // The summary of setter depends on its parameter so it is never precomputed
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(
+        Condition(), action::FunctionCall{"wait_setter", {PrimitiveInfo(7)}});
+    main.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    main.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(global))});
+    registry.AddBlock(std::move(main));
+
+    CodeBlock setter("wait_setter", clang::SourceLocation{});
+    setter.AddFunctionParameter(value);
+    setter.AddProcessedAction(
+        Condition(), action::VarAssigned{global, VariableState(VarCopyInfo(value))});
+    registry.AddBlock(std::move(setter));
+
+    AnalysisSettings settings;
+
+    for(const bool bottomUp : {true, false}) {
+        for(const unsigned threads : {1, 4}) {
+            settings.BottomUpSummaries = bottomUp;
+            settings.Threads = threads;
+
+            Statistics::Reset();
+            Statistics::Enable(true);
+            const auto problems = FormatProblems(registry.PerformAnalysis(settings));
+            Statistics::Enable(false);
+
+            REQUIRE(problems.size() == 1);
+            CHECK(problems[0].find("used index: 7") != std::string::npos);
+
+            // With threads the summary can be done before main gets to wait for it
+            if(threads == 1)
+                CHECK(Statistics::Get(STAT_COUNTER::SummaryWaits) == 1);
+        }
+    }
+}
+
+TEST_CASE("The call graph is condensed into components callees first", "[analysis]")
+{
+    BlockRegistry registry;
+
+    const auto addBlock = [&](const std::string& name, std::vector<std::string> calls) {
+        CodeBlock block(name, clang::SourceLocation{});
+
+        for(const auto& call : calls)
+            block.AddProcessedAction(Condition(), action::FunctionCall{call, {}});
+
+        registry.AddBlock(std::move(block));
+    };
+
+    addBlock("main", {"first", "leaf", "missing"});
+    addBlock("first", {"second"});
+    addBlock("second", {"first", "leaf"});
+    addBlock("leaf", {"leaf"});
+    addBlock("unreachable", {"main"});
+
+    const auto* main = registry.FindFunction("main");
+    const auto* first = registry.FindFunction("first");
+    const auto* leaf = registry.FindFunction("leaf");
+
+    const auto graph = registry.BuildCallGraph(*main);
+
+    CHECK(graph.GetFunctionCount() == 4);
+    REQUIRE(graph.GetComponents().size() == 3);
+    CHECK(graph.GetComponent(registry.FindFunction("second")) == graph.GetComponent(first));
+    CHECK(graph.GetComponent(leaf) < graph.GetComponent(first));
+    CHECK(graph.GetComponent(main) == 2);
+    CHECK(graph.GetComponent(registry.FindFunction("unreachable")) == size_t(-1));
+
+    CHECK(graph.GetLevel(graph.GetComponent(leaf)) == 0);
+    CHECK(graph.GetLevel(graph.GetComponent(first)) == 1);
+    CHECK(graph.GetLevel(graph.GetComponent(main)) == 2);
+
+    CHECK(graph.IsRecursive(first));
+    CHECK(graph.IsRecursive(leaf));
+    CHECK(!graph.IsRecursive(main));
+}
+
+TEST_CASE("Functions without parameters are summarised bottom-up", "[analysis]")
+{
+    // Each test has its own table so the globals marked in it don't affect the others
+    VariableNameTable names;
+    const VariableNameTable::Scope nameScope(names);
+
+    const VariableIdentifier global("global");
+    names.MarkGlobal(global.ID);
+
+    const VariableIdentifier buffer("bottom_up_buffer");
+    const VariableIdentifier index("bottom_up_index");
+
+    BlockRegistry registry;
+
+    // Each checker is called after the setter so it sees the value of the global only if the
+    // summary of the setter is ready when the checker is analysed
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"bottom_up_setter", {}});
+
+    for(int i = 0; i < 4; ++i) {
+        main.AddProcessedAction(Condition(),
+            action::FunctionCall{"bottom_up_checker" + std::to_string(i), {}});
+    }
+
+    registry.AddBlock(std::move(main));
+
+    CodeBlock setter("bottom_up_setter", clang::SourceLocation{});
+    setter.AddProcessedAction(Condition(), action::VarAssigned{global, PrimitiveInfo(6)});
+    registry.AddBlock(std::move(setter));
+
+    for(int i = 0; i < 4; ++i) {
+        CodeBlock checker("bottom_up_checker" + std::to_string(i), clang::SourceLocation{});
+        checker.AddProcessedAction(Condition(), action::FunctionCall{"bottom_up_setter", {}});
+        checker.AddProcessedAction(
+            Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(i + 5))});
+        checker.AddProcessedAction(
+            Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(global))});
+        checker.AddProcessedAction(
+            Condition(), action::FunctionCall{"bottom_up_indexer", {PrimitiveInfo(i)}});
+        registry.AddBlock(std::move(checker));
+    }
+
+    CodeBlock indexer("bottom_up_indexer", clang::SourceLocation{});
+    indexer.AddFunctionParameter(index);
+    indexer.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(2))});
+    indexer.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(index))});
+    registry.AddBlock(std::move(indexer));
+
+    AnalysisSettings settings;
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    const auto problems = FormatProblems(registry.PerformAnalysis(settings));
+    Statistics::Enable(false);
+
+    // Index 6 overflows buffers of size 5 and 6, the indexer overflows with 2 and 3
+    CHECK(problems.size() == 4);
+
+    // The setter, the checkers and the indexer with unknown and each of the passed
+    // parameters
+    CHECK(Statistics::Get(STAT_COUNTER::SummariesPrecomputed) == 10);
+    CHECK(Statistics::Get(STAT_COUNTER::OperationsEnqueued) == 1);
+
+    settings.Threads = 4;
+    CHECK(FormatProblems(registry.PerformAnalysis(settings)) == problems);
+
+    // Without the summaries computed first the parallel results would depend on whether the
+    // setter finishes before the checkers
+    settings.Threads = 1;
+    settings.BottomUpSummaries = false;
+    CHECK(FormatProblems(registry.PerformAnalysis(settings)) == problems);
+}
+
+TEST_CASE("Functions with parameters are summarised for unknown values", "[analysis]")
+{
+    const VariableIdentifier unknown("unknown_param_source");
+    const VariableIdentifier param("unknown_param");
+    const VariableIdentifier buffer("unknown_param_buffer");
+
+    BlockRegistry registry;
+
+    // Both callers pass a variable with no known value
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(
+        Condition(), action::FunctionCall{"unknown_param_caller", {}});
+    main.AddProcessedAction(Condition(),
+        action::FunctionCall{"unknown_param_callee", {VariableState(VarCopyInfo(unknown))}});
+    registry.AddBlock(std::move(main));
+
+    CodeBlock caller("unknown_param_caller", clang::SourceLocation{});
+    caller.AddProcessedAction(Condition(),
+        action::FunctionCall{"unknown_param_callee", {VariableState(VarCopyInfo(unknown))}});
+    registry.AddBlock(std::move(caller));
+
+    CodeBlock callee("unknown_param_callee", clang::SourceLocation{});
+    callee.AddFunctionParameter(param);
+    callee.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    callee.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(PrimitiveInfo(7))});
+    registry.AddBlock(std::move(callee));
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    const auto problems = FormatProblems(registry.PerformAnalysis(AnalysisSettings{}));
+    Statistics::Enable(false);
+
+    // The callee is analysed once, before its callers, and reported once
+    REQUIRE(problems.size() == 1);
+    CHECK(problems[0].find("used index: 7") != std::string::npos);
+    CHECK(Statistics::Get(STAT_COUNTER::SummariesPrecomputed) == 2);
+    CHECK(Statistics::Get(STAT_COUNTER::OperationsEnqueued) == 1);
+    CHECK(Statistics::Get(STAT_COUNTER::SummaryWaits) == 0);
+}
+
+TEST_CASE("Unused bottom-up summaries don't use the entry point budget", "[analysis]")
+{
+    const VariableIdentifier flag("unused_summary_flag");
+
+    BlockRegistry registry;
+
+    // The helper is reachable in the call graph but never called
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(
+        Condition(), action::VarDeclared{flag, VariableState(PrimitiveInfo(0))});
+    main.AddProcessedAction(Condition(Condition::Part(VariableValueCondition(
+                                flag, ValueRange(ValueRange::RANGE_CLASS::NotZero)))),
+        action::FunctionCall{"unused_summary_helper", {}});
+    registry.AddBlock(std::move(main));
+
+    registry.AddBlock(CodeBlock("unused_summary_helper", clang::SourceLocation{}));
+
+    AnalysisSettings settings;
+    settings.EntryPointBudget.MaxOperations = 1;
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    const auto problems = registry.PerformAnalysis(settings);
+    Statistics::Enable(false);
+
+    CHECK(problems.empty());
+    CHECK(Statistics::Get(STAT_COUNTER::SummariesPrecomputed) == 1);
+}
+
+TEST_CASE("Undetermined conditions split the analysis into paths", "[analysis]")
+{
+    const VariableIdentifier argc("split_argc");
+    const VariableIdentifier buffer("split_buffer");
+    const VariableIdentifier index("split_index");
+
+    const Condition argcSet(Condition::Part(
+        VariableValueCondition(argc, ValueRange(ValueRange::RANGE_CLASS::NotZero))));
+
+    BlockRegistry registry;
+
+    // argc is unknown as main is analysed without knowing the program arguments
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddFunctionParameter(argc);
+    main.AddFunctionParameter(VariableIdentifier("split_argv"));
+    main.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    main.AddProcessedAction(argcSet, action::VarAssigned{index, PrimitiveInfo(10)});
+    main.AddProcessedAction(argcSet.Negate(), action::VarAssigned{index, PrimitiveInfo(2)});
+    main.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(index))});
+    main.AddProcessedAction(
+        argcSet, action::ArrayIndexAccess{buffer, VariableState(PrimitiveInfo(7))});
+    registry.AddBlock(std::move(main));
+
+    AnalysisSettings settings;
+
+    const auto problems = FormatProblems(registry.PerformAnalysis(settings));
+
+    REQUIRE(problems.size() == 2);
+    CHECK(problems[0].find("used index: 10") != std::string::npos);
+    CHECK(problems[1].find("used index: 7") != std::string::npos);
+
+    settings.MaxPaths = 1;
+    CHECK(registry.PerformAnalysis(settings).empty());
+}
+
+TEST_CASE("Paths are joined when they reach the same state", "[analysis]")
+{
+    const VariableIdentifier argc("join_argc");
+    const VariableIdentifier buffer("join_buffer");
+    const VariableIdentifier index("join_index");
+
+    const Condition argcSet(Condition::Part(
+        VariableValueCondition(argc, ValueRange(ValueRange::RANGE_CLASS::NotZero))));
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddFunctionParameter(argc);
+    main.AddFunctionParameter(VariableIdentifier("join_argv"));
+    main.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    main.AddProcessedAction(argcSet, action::VarAssigned{index, PrimitiveInfo(8)});
+    main.AddProcessedAction(argcSet.Negate(), action::VarAssigned{index, PrimitiveInfo(8)});
+    main.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(index))});
+    registry.AddBlock(std::move(main));
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    const auto problems = registry.PerformAnalysis(AnalysisSettings{});
+    Statistics::Enable(false);
+
+    // Reported once even though both paths run the access
+    CHECK(problems.size() == 1);
+    CHECK(Statistics::Get(STAT_COUNTER::PathsSplit) == 1);
+    CHECK(Statistics::Get(STAT_COUNTER::PathsJoined) == 1);
+}
+
+TEST_CASE("Intervals support join, meet and widening", "[analysis]")
+{
+    const IntervalInfo low(0, 4);
+    const IntervalInfo high(3, 10);
+
+    CHECK(low.Join(high) == IntervalInfo(0, 10));
+    CHECK(*low.Meet(high) == IntervalInfo(3, 4));
+    CHECK(!low.Meet(IntervalInfo(5, 6)));
+
+    CHECK(low.Widen(IntervalInfo(0, 5)) == IntervalInfo(0, IntervalInfo::Unbounded));
+    CHECK(low.Widen(low) == low);
+
+    CHECK(*low.Restrict(COMPARISON::LESS_THAN, 2) == IntervalInfo(0, 1));
+    CHECK(*low.Restrict(COMPARISON::NOT_EQUAL, 0) == IntervalInfo(1, 4));
+    CHECK(!low.Restrict(COMPARISON::GREATER_THAN, 4));
+
+    CHECK(*low.CompareTo(COMPARISON::LESS_THAN, IntervalInfo(5, 5)) == true);
+    CHECK(!low.CompareTo(COMPARISON::LESS_THAN, high));
+
+    CHECK(low.ApplyOperator(OPERATOR::Subtract, high) == IntervalInfo(-10, 1));
+    CHECK(IntervalInfo(1, IntervalInfo::Unbounded).ApplyOperator(OPERATOR::Add, low) ==
+          IntervalInfo(1, IntervalInfo::Unbounded));
+
+    // Different numbers join to a range, single values stay primitives
+    CHECK(VariableState(PrimitiveInfo(2)).Join(PrimitiveInfo(9)) ==
+          VariableState(IntervalInfo(2, 9)));
+    CHECK(VariableState(PrimitiveInfo(2)).Join(PrimitiveInfo(2)) ==
+          VariableState(PrimitiveInfo(2)));
+    CHECK(VariableState(PrimitiveInfo(2)).Join(BufferInfo(2)).State ==
+          VariableState::STATE::Unknown);
+}
+
+TEST_CASE("Joined paths keep the range of their values", "[analysis]")
+{
+    // Each test has its own table so the globals marked in it don't affect the others
+    VariableNameTable names;
+    const VariableNameTable::Scope nameScope(names);
+
+    const VariableIdentifier global("global");
+    names.MarkGlobal(global.ID);
+
+    const VariableIdentifier flag("range_flag");
+    const VariableIdentifier buffer("range_buffer");
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddFunctionParameter(flag);
+    main.AddFunctionParameter(VariableIdentifier("range_argv"));
+    main.AddProcessedAction(Condition(),
+        action::FunctionCall{"range_setter", {VariableState(VarCopyInfo(flag))}});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"range_reader", {}});
+    registry.AddBlock(std::move(main));
+
+    // The setter summary is used here so the global has the joined value of its paths
+    CodeBlock reader("range_reader", clang::SourceLocation{});
+    reader.AddProcessedAction(
+        Condition(), action::FunctionCall{"range_setter", {VariableState()}});
+    reader.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    reader.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(global))});
+
+    // Every value in the range satisfies this so it doesn't need to be split on
+    reader.AddProcessedAction(
+        Condition(Condition::Part(VariableValueCondition(global,
+            ValueRange(COMPARISON::LESS_THAN, VariableState(PrimitiveInfo(20)))))),
+        action::ArrayIndexAccess{buffer, VariableState(PrimitiveInfo(7))});
+    registry.AddBlock(std::move(reader));
+
+    const Condition flagSet(Condition::Part(VariableValueCondition(
+        VariableIdentifier("range_param"), ValueRange(ValueRange::RANGE_CLASS::NotZero))));
+
+    CodeBlock setter("range_setter", clang::SourceLocation{});
+    setter.AddFunctionParameter(VariableIdentifier("range_param"));
+    setter.AddProcessedAction(flagSet, action::VarAssigned{global, PrimitiveInfo(2)});
+    setter.AddProcessedAction(flagSet.Negate(), action::VarAssigned{global, PrimitiveInfo(9)});
+    registry.AddBlock(std::move(setter));
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    const auto problems = FormatProblems(registry.PerformAnalysis(AnalysisSettings{}));
+    Statistics::Enable(false);
+
+    REQUIRE(problems.size() == 2);
+    CHECK(problems[0].find("used index: 7") != std::string::npos);
+
+    // Only some of the values overflow
+    CHECK(problems[1] ==
+          "warning: Possible buffer overflow: buffer size: 5 used index range: [2, 9]");
+    CHECK(Statistics::Get(STAT_COUNTER::PathsSplit) == 1);
+}
+
+TEST_CASE("Index ranges are errors only when all values are out of bounds", "[analysis]")
+{
+    const VariableIdentifier buffer("bounds_buffer");
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(4))});
+
+    const auto access = [&](VariableState index) {
+        main.AddProcessedAction(Condition(), action::ArrayIndexAccess{buffer, index});
+    };
+
+    access(PrimitiveInfo(-1));
+    access(VariableState::FromInterval(IntervalInfo(4, 9)));
+    access(VariableState::FromInterval(IntervalInfo(-5, -1)));
+    access(VariableState::FromInterval(IntervalInfo(2, 6)));
+    access(VariableState::FromInterval(IntervalInfo(-2, 2)));
+    access(VariableState::FromInterval(IntervalInfo(0, 3)));
+    registry.AddBlock(std::move(main));
+
+    const auto problems = FormatProblems(registry.PerformAnalysis(AnalysisSettings{}));
+
+    REQUIRE(problems.size() == 5);
+    CHECK(problems[0] == "error: Buffer overflow: buffer size: 4 used index range: [4, 9]");
+    CHECK(problems[1] ==
+          "error: Buffer underflow: buffer size: 4 used index range: [-5, -1]");
+    CHECK(problems[2] == "error: Buffer underflow: buffer size: 4 used index: -1");
+    CHECK(problems[3] ==
+          "warning: Possible buffer overflow: buffer size: 4 used index range: [2, 6]");
+    CHECK(problems[4] ==
+          "warning: Possible buffer underflow: buffer size: 4 used index range: [-2, 2]");
+}
+
+TEST_CASE("Recursion with changing parameters is widened until it stops", "[analysis]")
+{
+    const VariableIdentifier count("countdown_count");
+    const VariableIdentifier buffer("countdown_buffer");
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(
+        Condition(), action::FunctionCall{"countdown", {VariableState(PrimitiveInfo(10))}});
+    registry.AddBlock(std::move(main));
+
+    const Condition countLeft(Condition::Part(
+        VariableValueCondition(count, ValueRange(ValueRange::RANGE_CLASS::NotZero))));
+
+    CodeBlock countdown("countdown", clang::SourceLocation{});
+    countdown.AddFunctionParameter(count);
+    countdown.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    countdown.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(count))});
+    countdown.AddProcessedAction(countLeft,
+        action::FunctionCall{"countdown",
+            {VariableState(VarCopyInfo(count))
+                    .CreateOperatorApplyingState(OPERATOR::Subtract, PrimitiveInfo(1))}});
+    registry.AddBlock(std::move(countdown));
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    const auto problems = FormatProblems(registry.PerformAnalysis(AnalysisSettings{}));
+    Statistics::Enable(false);
+
+    // The call from main and the one with the widened count that calls itself, which can go
+    // past both ends
+    REQUIRE(problems.size() == 3);
+    CHECK(problems[0].find("used index: 10") != std::string::npos);
+    CHECK(problems[1] == "warning: Possible buffer overflow: buffer size: 5 used index "
+                         "range: [-inf, 10]");
+    CHECK(problems[2] == "warning: Possible buffer underflow: buffer size: 5 used index "
+                         "range: [-inf, 10]");
+    CHECK(Statistics::Get(STAT_COUNTER::OperationsEnqueued) == 3);
+
+    // Once with 10 and in both rounds of the widened call, the second round checking that
+    // calling itself changes nothing. The summary for an unknown count, which nothing
+    // uses, takes two more rounds
+    CHECK(Statistics::Get(STAT_COUNTER::RecursiveCalls) == 3 + 2);
+    CHECK(Statistics::Get(STAT_COUNTER::FixpointRounds) == 1 + 1);
+}
+
+TEST_CASE("Effects of recursive calls are iterated to a fixpoint", "[analysis]")
+{
+    // Each test has its own table so the globals marked in it don't affect the others
+    VariableNameTable names;
+    const VariableNameTable::Scope nameScope(names);
+
+    const VariableIdentifier global("global");
+    names.MarkGlobal(global.ID);
+
+    const VariableIdentifier flag("fixpoint_flag");
+    const VariableIdentifier buffer("fixpoint_buffer");
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"fixpoint_grow", {}});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"fixpoint_reader", {}});
+    registry.AddBlock(std::move(main));
+
+    const Condition flagSet(Condition::Part(
+        VariableValueCondition(flag, ValueRange(ValueRange::RANGE_CLASS::NotZero))));
+
+    // Each level of recursion adds 2, which is only seen through the summary of the call
+    CodeBlock grow("fixpoint_grow", clang::SourceLocation{});
+    grow.AddProcessedAction(Condition(), action::VarAssigned{global, PrimitiveInfo(3)});
+    grow.AddProcessedAction(flagSet, action::FunctionCall{"fixpoint_grow", {}});
+    grow.AddProcessedAction(flagSet,
+        action::VarAssigned{global, VariableState(VarCopyInfo(global))
+                                        .CreateOperatorApplyingState(
+                                            OPERATOR::Add, PrimitiveInfo(2))});
+    registry.AddBlock(std::move(grow));
+
+    CodeBlock reader("fixpoint_reader", clang::SourceLocation{});
+    reader.AddProcessedAction(Condition(), action::FunctionCall{"fixpoint_grow", {}});
+    reader.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(10))});
+    reader.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(global))});
+    registry.AddBlock(std::move(reader));
+
+    AnalysisSettings settings;
+
+    for(const bool bottomUp : {true, false}) {
+        settings.BottomUpSummaries = bottomUp;
+
+        Statistics::Reset();
+        Statistics::Enable(true);
+        const auto problems = FormatProblems(registry.PerformAnalysis(settings));
+        Statistics::Enable(false);
+
+        // Without the fixpoint the summary would only have [3, 5]
+        REQUIRE(problems.size() == 1);
+        CHECK(problems[0] == "warning: Possible buffer overflow: buffer size: 10 used index "
+                             "range: [3, inf]");
+        CHECK(Statistics::Get(STAT_COUNTER::FixpointRounds) == 2);
+    }
+}
+
+TEST_CASE("Exhausted budgets return the problems found so far", "[analysis]")
+{
+    BlockRegistry registry;
+    AddOverflowingProgram(registry);
+
+    const auto isIncomplete = [](const FoundProblem& problem) {
+        return problem.Severity == FoundProblem::SEVERITY::Warning &&
+               problem.Message.find("incomplete") != std::string::npos;
+    };
+
+    AnalysisSettings settings;
+
+    const auto unlimited = registry.PerformAnalysis(settings);
+    CHECK(std::none_of(unlimited.begin(), unlimited.end(), isIncomplete));
+
+    SECTION("Entry point operations")
+    {
+        settings.EntryPointBudget.MaxOperations = 3;
+        const auto problems = registry.PerformAnalysis(settings);
+
+        // main and the first two func calls, which don't overflow
+        CHECK(std::count_if(problems.begin(), problems.end(), isIncomplete) == 1);
+        CHECK(problems.size() == 2);
+        CHECK(problems.back().Message.find("operation budget") != std::string::npos);
+    }
+
+    SECTION("Function operations")
+    {
+        settings.FunctionBudget.MaxOperations = 1;
+        const auto problems = registry.PerformAnalysis(settings);
+
+        // main stops after declaring its buffer so func is never called
+        REQUIRE(problems.size() == 1);
+        CHECK(isIncomplete(problems[0]));
+        CHECK(problems[0].Message.find("analysis of main") != std::string::npos);
+    }
+
+    SECTION("Cancellation")
+    {
+        std::atomic<bool> cancel{true};
+        settings.Cancel = &cancel;
+        settings.Threads = 4;
+
+        const auto problems = registry.PerformAnalysis(settings);
+
+        REQUIRE(problems.size() == 1);
+        CHECK(problems[0].Message.find("cancelled") != std::string::npos);
+    }
+}
+
+TEST_CASE("Finished operations are recycled for new calls", "[analysis]")
+{
+    const VariableIdentifier outer("recycle_outer");
+    const VariableIdentifier inner("recycle_inner");
+    const VariableIdentifier buffer("recycle_buffer");
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+
+    for(int i = 0; i < 10; ++i) {
+        main.AddProcessedAction(
+            Condition(), action::FunctionCall{"outer", {PrimitiveInfo(i)}});
+    }
+
+    registry.AddBlock(std::move(main));
+
+    CodeBlock outerBlock("outer", clang::SourceLocation{});
+    outerBlock.AddFunctionParameter(outer);
+    outerBlock.AddProcessedAction(
+        Condition(), action::FunctionCall{"inner", {VariableState(VarCopyInfo(outer))}});
+    registry.AddBlock(std::move(outerBlock));
+
+    CodeBlock innerBlock("inner", clang::SourceLocation{});
+    innerBlock.AddFunctionParameter(inner);
+    innerBlock.AddProcessedAction(
+        Condition(), action::VarDeclared{buffer, VariableState(BufferInfo(5))});
+    innerBlock.AddProcessedAction(
+        Condition(), action::ArrayIndexAccess{buffer, VariableState(VarCopyInfo(inner))});
+    registry.AddBlock(std::move(innerBlock));
+
+    Statistics::Reset();
+    Statistics::Enable(true);
+    const auto problems = FormatProblems(registry.PerformAnalysis(AnalysisSettings{}));
+    Statistics::Enable(false);
+
+    // main waits for each outer call, which waits for its inner call, so only the first
+    // outer and inner calls need new operations. The summaries for unknown parameters are
+    // computed first and leave one operation in the pool
+    CHECK(Statistics::Get(STAT_COUNTER::OperationsRecycled) == 19);
+    CHECK(problems.size() == 5);
+
+    AnalysisSettings parallel;
+    parallel.Threads = 4;
+    CHECK(FormatProblems(registry.PerformAnalysis(parallel)) == problems);
+}
@@ -3,9 +3,12 @@
 
 #include <boost/asio/io_service.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <boost/process.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 constexpr auto SMACPP_PATH = "src/smacpp";
 constexpr auto SMACPP_PLUGIN_PATH = "src/libsmacpp-clang-plugin.so";
@@ -13,6 +16,18 @@ constexpr auto SMACPP_ANALYZER_PLUGIN = "src/libsmacpp-clang-analyzer.so";
 
 namespace bp = boost::process;
 
+//! Writes a small program with an overflow on line 4, column 5
+void WriteOverflowSource(const boost::filesystem::path& path)
+{
+    boost::filesystem::ofstream source(path);
+    source << "int main(int argc, char* argv[])\n"
+           << "{\n"
+           << "    char buffer[] = \"abc\";\n"
+           << "    buffer[5] = 'd';\n"
+           << "    return 0;\n"
+           << "}\n";
+}
+
 TEST_CASE("Normal clang help print works", "[plugin]")
 {
     boost::asio::io_service ios;
@@ -132,3 +147,94 @@ TEST_CASE("Loading static analyzer plugin doesn't error", "[plugin]")
     CHECK(result == 0);
     CHECK(output.find("CHECKERS") != std::string::npos);
 }
+
+TEST_CASE("Batch mode analyses all files in compile_commands.json", "[plugin]")
+{
+    REQUIRE(boost::filesystem::exists(SMACPP_PATH));
+
+    const auto folder =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+
+    WriteOverflowSource(folder / "overflow.c");
+
+    {
+        boost::filesystem::ofstream commands(folder / "compile_commands.json");
+        commands << "[{\"directory\": \"" << folder.string()
+                 << "\", \"command\": \"clang -c overflow.c\", \"file\": \"overflow.c\"}]\n";
+    }
+
+    boost::asio::io_service ios;
+
+    std::future<std::string> data;
+
+    bp::child c(boost::filesystem::absolute(SMACPP_PATH), "--batch", folder.string(), "-j",
+        "2", bp::std_out > data, ios);
+
+    ios.run();
+
+    auto output = data.get();
+
+    c.wait();
+    int result = c.exit_code();
+
+    boost::filesystem::remove_all(folder);
+
+    INFO(output);
+    CHECK(result == 1);
+    CHECK(output.find("overflow.c:4:5: error: Buffer overflow") != std::string::npos);
+    CHECK(output.find("analysed 1 files") != std::string::npos);
+}
+
+TEST_CASE("Analysis server answers forwarded requests", "[plugin]")
+{
+    REQUIRE(boost::filesystem::exists(SMACPP_PATH));
+
+    const auto folder =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+
+    WriteOverflowSource(folder / "overflow.c");
+
+    const auto socket = (folder / "server.sock").string();
+    const auto smacpp = boost::filesystem::absolute(SMACPP_PATH);
+
+    bp::child server(smacpp, "--server", socket);
+
+    for(int i = 0; i < 100 && !boost::filesystem::exists(socket); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    REQUIRE(boost::filesystem::exists(socket));
+
+    auto environment = boost::this_process::environment();
+    environment["SMACPP_SERVER"] = socket;
+
+    // The second request is answered from the cache
+    for(int i = 0; i < 2; ++i) {
+        boost::asio::io_service ios;
+
+        std::future<std::string> data;
+
+        bp::child c(smacpp, "-fsyntax-only", "overflow.c", bp::std_err > data,
+            bp::start_dir = folder, environment, ios);
+
+        ios.run();
+
+        auto output = data.get();
+
+        c.wait();
+        int result = c.exit_code();
+
+        INFO(output);
+        CHECK(result == 1);
+        CHECK(output.find("overflow.c:4:5: error: Buffer overflow") != std::string::npos);
+    }
+
+    CHECK(bp::system(smacpp, "--server", socket, "--stop") == 0);
+    server.wait();
+
+    CHECK(server.exit_code() == 0);
+    CHECK(!boost::filesystem::exists(socket));
+
+    boost::filesystem::remove_all(folder);
+}
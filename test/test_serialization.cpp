@@ -0,0 +1,235 @@
+// Tests for writing and reading the CodeBlock summary files
+#include "catch.hpp"
+
+#include "analysis/BlockRegistry.h"
+#include "parse/CodeBlock.h"
+#include "serialization/CodeBlockSerializer.h"
+#include "serialization/ResultCache.h"
+
+#include <filesystem>
+
+using namespace smacpp;
+
+TEST_CASE("Binary stream integers round trip", "[serialization]")
+{
+    BinaryWriter writer;
+    writer.WriteVarUInt(0);
+    writer.WriteVarUInt(300);
+    writer.WriteVarInt(-5);
+    writer.WriteVarInt(INT64_MIN);
+    writer.WriteDouble(1.5);
+    writer.WriteString("text");
+
+    BinaryReader reader(writer.GetBuffer().data(), writer.GetBuffer().size());
+    CHECK(reader.ReadVarUInt() == 0);
+    CHECK(reader.ReadVarUInt() == 300);
+    CHECK(reader.ReadVarInt() == -5);
+    CHECK(reader.ReadVarInt() == INT64_MIN);
+    CHECK(reader.ReadDouble() == 1.5);
+    CHECK(reader.ReadString() == "text");
+    CHECK(reader.IsAtEnd());
+    CHECK_THROWS_AS(reader.ReadU8(), SerializationError);
+}
+
+TEST_CASE("CodeBlocks survive serialization", "[serialization]")
+{
+    BlockRegistry original;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"func", {PrimitiveInfo(6)}});
+    original.AddBlock(std::move(main));
+
+    CodeBlock func("func", clang::SourceLocation{});
+    func.AddFunctionParameter(VariableIdentifier("param"));
+    func.AddProcessedAction(Condition(),
+        action::VarDeclared{VariableIdentifier("buf"), VariableState(BufferInfo(4))});
+
+    const auto index = VariableState(VarCopyInfo(VariableIdentifier("param")))
+                           .CreateOperatorApplyingState(OPERATOR::Subtract, PrimitiveInfo(1));
+    const Condition condition(Condition::Part(VariableValueCondition(
+        VariableIdentifier("param"), ValueRange(COMPARISON::GREATER_THAN, PrimitiveInfo(2)))));
+
+    func.AddProcessedAction(condition,
+        action::ArrayIndexAccess{VariableIdentifier("buf"), index}, clang::SourceLocation{},
+        SourcePosition{"func.c", 12, 5});
+    original.AddBlock(std::move(func));
+
+    const auto data = SerializeBlockRegistry(original, nullptr);
+
+    BlockRegistry loaded;
+    LoadBlockRegistry(loaded, data.data(), data.size());
+
+    REQUIRE(loaded.FindFunction("func"));
+    CHECK(loaded.FindFunction("func")->Dump() == original.FindFunction("func")->Dump());
+    CHECK(loaded.FindFunction("main")->Dump() == original.FindFunction("main")->Dump());
+
+    // Serializing again needs to give the same data
+    CHECK(SerializeBlockRegistry(loaded, nullptr) == data);
+
+    const auto problems = loaded.PerformAnalysis(AnalysisSettings{});
+    REQUIRE(problems.size() == 1);
+    CHECK(problems[0].FormatAsString() ==
+          "func.c:12:5: error: Buffer overflow: buffer size: 4 used index: 5");
+
+    CHECK_THROWS_AS(
+        LoadBlockRegistry(loaded, data.data(), data.size() / 2), SerializationError);
+}
+
+TEST_CASE("Too deeply nested states are rejected", "[serialization]")
+{
+    auto state = VariableState(VarCopyInfo(VariableIdentifier("param")));
+
+    for(int i = 0; i < 2000; ++i)
+        state = state.CreateOperatorApplyingState(OPERATOR::Subtract, PrimitiveInfo(1));
+
+    BlockRegistry original;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(
+        Condition(), action::VarAssigned{VariableIdentifier("value"), state});
+    original.AddBlock(std::move(main));
+
+    const auto data = SerializeBlockRegistry(original, nullptr);
+
+    BlockRegistry loaded;
+    CHECK_THROWS_AS(LoadBlockRegistry(loaded, data.data(), data.size()), SerializationError);
+}
+
+TEST_CASE("Mapped summaries find blocks by name", "[serialization]")
+{
+    BlockRegistry original;
+
+    for(const auto& name : {"c", "a", "main", "b"}) {
+        CodeBlock block(name, clang::SourceLocation{});
+
+        if(std::string(name) != "main") {
+            block.AddProcessedAction(Condition(),
+                action::VarDeclared{
+                    VariableIdentifier("local"), VariableState(BufferInfo(2))});
+        }
+
+        original.AddBlock(std::move(block));
+    }
+
+    const auto data = SerializeBlockRegistry(original, nullptr);
+    auto summary = std::make_unique<MappedSummary>(data.data(), data.size());
+
+    REQUIRE(summary->GetBlockCount() == 4);
+    CHECK(summary->GetBlockName(0) == "a");
+    CHECK(summary->GetBlockName(3) == "main");
+    CHECK(summary->FindBlock("b") == 1);
+    CHECK(!summary->FindBlock("d"));
+
+    BlockRegistry loaded;
+    loaded.AddSummary(std::move(summary));
+
+    CHECK(loaded.GetBlocks().empty());
+    REQUIRE(loaded.FindFunction("c"));
+    CHECK(loaded.FindFunction("c")->Dump() == original.FindFunction("c")->Dump());
+    CHECK(loaded.FindFunction("c") == loaded.FindFunction("c"));
+    CHECK(!loaded.FindFunction("missing"));
+    CHECK(loaded.PerformAnalysis(AnalysisSettings{}).empty());
+
+    // A later summary only replaces the blocks it has, earlier lookups stay valid
+    BlockRegistry replacement;
+    replacement.AddBlock(CodeBlock("c", clang::SourceLocation{}));
+
+    const auto replacementData = SerializeBlockRegistry(replacement, nullptr);
+
+    const auto* oldC = loaded.FindFunction("c");
+    const auto* a = loaded.FindFunction("a");
+    loaded.AddSummary(
+        std::make_unique<MappedSummary>(replacementData.data(), replacementData.size()));
+
+    REQUIRE(loaded.FindFunction("c"));
+    CHECK(loaded.FindFunction("c") != oldC);
+    CHECK(loaded.FindFunction("c")->GetActions().empty());
+    CHECK(oldC->GetActions().size() == 1);
+    CHECK(loaded.FindFunction("a") == a);
+}
+
+TEST_CASE("Reachable hashes only change with the reachable code", "[serialization]")
+{
+    const auto makeFunc = [](PrimitiveInfo::Integer size) {
+        CodeBlock func("func", clang::SourceLocation{});
+        func.AddProcessedAction(Condition(),
+            action::VarDeclared{VariableIdentifier("buf"), VariableState(BufferInfo(size))});
+
+        func.AddProcessedAction(Condition(),
+            action::ArrayIndexAccess{
+                VariableIdentifier("buf"), VariableState(PrimitiveInfo(3))},
+            clang::SourceLocation{}, SourcePosition{"func.c", 4, 1});
+        return func;
+    };
+
+    BlockRegistry registry;
+
+    CodeBlock main("main", clang::SourceLocation{});
+    main.AddProcessedAction(Condition(), action::FunctionCall{"func", {}});
+    registry.AddBlock(std::move(main));
+    registry.AddBlock(makeFunc(2));
+
+    const auto& entry = *registry.FindFunction("main");
+    const auto original = HashReachableBlocks(registry, entry, nullptr);
+
+    CHECK(HashReachableBlocks(registry, entry, nullptr) == original);
+
+    registry.AddBlock(CodeBlock("unrelated", clang::SourceLocation{}));
+    CHECK(HashReachableBlocks(registry, entry, nullptr) == original);
+
+    registry.AddBlock(makeFunc(8));
+    CHECK(HashReachableBlocks(registry, entry, nullptr) != original);
+
+    // Whether a variable is global changes the analysis so it changes the hash
+    const VariableIdentifier later("serialization_later_global");
+    CodeBlock usesLater("func", clang::SourceLocation{});
+    usesLater.AddProcessedAction(
+        Condition(), action::VarAssigned{later, VariableState(PrimitiveInfo(1))});
+
+    const auto localHash = HashCodeBlock(usesLater, nullptr);
+    VariableNameTable::Get().MarkGlobal(later.ID);
+    CHECK(HashCodeBlock(usesLater, nullptr) != localHash);
+
+    registry.AddBlock(makeFunc(2));
+
+    AnalysisSettings settings;
+    settings.ResultCacheFile =
+        (std::filesystem::temp_directory_path() / "smacpp-test-result-cache").string();
+    settings.ProgramName = "first";
+    std::filesystem::remove(settings.ResultCacheFile);
+
+    const auto problems = registry.PerformAnalysis(settings);
+    REQUIRE(problems.size() == 1);
+
+    const auto key = AnalysisResultCache::MakeKey("first", "main");
+    const auto settingsHash = HashAnalysisSettings(settings);
+
+    AnalysisResultCache cache;
+    cache.Load(settings.ResultCacheFile);
+    REQUIRE(cache.Find(key, original, settingsHash));
+    CHECK(cache.Find(key, original, settingsHash)->at(0).FormatAsString() ==
+          problems[0].FormatAsString());
+    CHECK(!cache.Find(key, original + 1, settingsHash));
+
+    // Results depend on the settings
+    auto otherSettings = settings;
+    otherSettings.MaxPaths = 1;
+    CHECK(!cache.Find(key, original, HashAnalysisSettings(otherSettings)));
+
+    const auto cached = registry.PerformAnalysis(settings);
+    REQUIRE(cached.size() == 1);
+    CHECK(cached[0].FormatAsString() == "func.c:4:1: error: Buffer overflow: buffer size: 2 "
+                                        "used index: 3");
+
+    // Another program sharing the cache doesn't replace the results of the first
+    otherSettings = settings;
+    otherSettings.ProgramName = "second";
+    CHECK(registry.PerformAnalysis(otherSettings).size() == 1);
+
+    cache.Load(settings.ResultCacheFile);
+    CHECK(cache.Find(key, original, settingsHash));
+    CHECK(cache.Find(AnalysisResultCache::MakeKey("second", "main"), original, settingsHash));
+
+    std::filesystem::remove(settings.ResultCacheFile);
+    std::filesystem::remove(settings.ResultCacheFile + ".lock");
+}